@@ -0,0 +1,44 @@
+#pragma once
+
+// Timing and argument helpers shared by the benchmark programs
+
+#include "Util/StopWatch.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+
+namespace bench {
+
+// The size given as the first command line argument, or def without one
+inline std::size_t sizeArg(int argc, char** argv, std::size_t def) {
+    return argc > 1 ? std::strtoull(argv[1], nullptr, 10) : def;
+}
+
+// Nanoseconds per operation of f(), which performs ops operations and
+// returns a result to add to sink
+template <typename F, typename Sink>
+double nsPerOp(std::size_t ops, F&& f, Sink& sink) {
+    util::StopWatch<std::chrono::nanoseconds> watch;
+    sink += f();
+    return double(watch.elapsed().count()) / ops;
+}
+
+// Nanoseconds per call of f(i), for i in [0, ops), adding every result to
+// sink
+template <typename F, typename Sink>
+double nsPerCall(std::size_t ops, F&& f, Sink& sink) {
+    util::StopWatch<std::chrono::nanoseconds> watch;
+    for (std::size_t i = 0; i < ops; ++i)
+        sink += f(i);
+    return double(watch.elapsed().count()) / ops;
+}
+
+// The exit status of main: it depends on the sink, so that the compiler
+// cannot optimize away the loops whose results went into it
+template <typename Sink>
+int keepAlive(const Sink& sink) {
+    return sink == Sink(42) ? 1 : 0;
+}
+
+} // namespace bench
@@ -0,0 +1,104 @@
+// bloom_filter and counting_bloom_filter at several false positive rates,
+// against the std::unordered_set and flat_hash_set they would sit in front
+// of. For each filter it reports the memory per key, the predicted and
+// measured false positive rates, and the time per insert, per query for a
+// key that is present, and per query for one that is not. The number of keys
+// is given on the command line (10M by default).
+
+#include "Util/BloomFilter.h"
+#include "Util/FlatHashMap.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <unordered_set>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+template <typename Set>
+void run(const char* name, Set& set, std::size_t memory, double predicted,
+         const std::vector<std::uint64_t>& keys,
+         const std::vector<std::uint64_t>& missing, std::size_t& sink) {
+    auto insert = bench::nsPerOp(keys.size(), [&] {
+        for (auto k : keys)
+            set.insert(k);
+        return std::size_t(0);
+    }, sink);
+    auto hit = bench::nsPerOp(keys.size(), [&] {
+        std::size_t found = 0;
+        for (auto k : keys)
+            found += set.count(k);
+        return found;
+    }, sink);
+    std::size_t falsePositives = 0;
+    auto miss = bench::nsPerOp(missing.size(), [&] {
+        for (auto k : missing)
+            falsePositives += set.count(k);
+        return falsePositives;
+    }, sink);
+    std::printf("  %-28s %6.2f bytes/key  fpr %.5f (predicted %.5f)  "
+                "insert %6.2f  hit %6.2f  miss %6.2f ns/op\n",
+                name, double(memory) / keys.size(),
+                double(falsePositives) / missing.size(), predicted, insert,
+                hit, miss);
+}
+
+// count() on top of contains(), to share run() with the sets
+template <typename Filter>
+struct Counted : Filter {
+    using Filter::Filter;
+    std::size_t count(std::uint64_t k) const { return this->contains(k); }
+};
+
+template <typename Filter>
+void runFilter(const char* name, double rate,
+               const std::vector<std::uint64_t>& keys,
+               const std::vector<std::uint64_t>& missing, std::size_t& sink) {
+    Counted<Filter> filter(keys.size(), rate);
+    char label[64];
+    std::snprintf(label, sizeof(label), "%s %g", name, rate);
+    run(label, filter, filter.memory_usage(),
+        filter.false_positive_rate(keys.size()), keys, missing, sink);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 10000000);
+    std::size_t sink = 0;
+
+    // Present keys are odd and missing ones even
+    std::mt19937_64 rng(1);
+    std::vector<std::uint64_t> keys(n), missing(n);
+    for (auto& k : keys)
+        k = rng() | 1;
+    for (auto& k : missing)
+        k = rng() & ~std::uint64_t(1);
+
+    std::printf("%zu keys\n", n);
+    for (double rate : {0.05, 0.01, 0.001, 0.0001})
+        runFilter<bloom_filter<std::uint64_t>>("bloom_filter", rate, keys,
+                                               missing, sink);
+    for (double rate : {0.01, 0.001})
+        runFilter<counting_bloom_filter<std::uint64_t>>(
+            "counting_bloom_filter", rate, keys, missing, sink);
+
+    {
+        std::unordered_set<std::uint64_t> set;
+        // Nodes, plus one bucket pointer per element at load factor 1
+        auto memory = n * (3 * sizeof(void*) + sizeof(void*));
+        run("unordered_set", set, memory, 0, keys, missing, sink);
+    }
+    {
+        flat_hash_set<std::uint64_t> set;
+        set.reserve(n);
+        auto memory = set.capacity() * (sizeof(std::uint64_t) + 1);
+        run("flat_hash_set", set, memory, 0, keys, missing, sink);
+    }
+
+    return bench::keepAlive(sink);
+}
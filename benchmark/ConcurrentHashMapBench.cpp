@@ -0,0 +1,126 @@
+// Scaling of concurrent_hash_map against one std::unordered_map behind a
+// global mutex, for pair<int, int> keys, from 1 to 64 threads and for
+// several ratios of lookups to writes. The maps are prefilled with the
+// number of keys given on the command line (1M by default); every thread
+// then draws random keys from twice that range, so half of the lookups
+// miss, and a write is an insert_or_assign or, one time in four, an erase.
+// The total number of operations is the same whatever the number of
+// threads, and results are in millions of operations per second.
+
+#include "Util/ConcurrentHashMap.h"
+#include "Util/StopWatch.h"
+
+#include "BenchUtil.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+using IntPair = std::pair<int, int>;
+
+IntPair makeKey(std::uint64_t i) { return {int(i), int(i >> 8)}; }
+
+// The baseline: what the map replaces
+class LockedMap {
+private:
+    std::unordered_map<IntPair, int, PairHasher<IntPair>> map;
+    mutable std::mutex mutex;
+
+public:
+    void insert_or_assign(const IntPair& k, int v) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map[k] = v;
+    }
+    bool contains(const IntPair& k) const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return map.count(k) != 0;
+    }
+    void erase(const IntPair& k) {
+        std::lock_guard<std::mutex> lock(mutex);
+        map.erase(k);
+    }
+    void reserve(std::size_t n) { map.reserve(n); }
+};
+
+using ShardedMap = concurrent_hash_map<IntPair, int, PairHasher<IntPair>>;
+
+template <typename Map>
+double mopsPerSecond(Map& map, std::size_t keys, std::size_t threads,
+                     unsigned readPercent, std::size_t totalOps,
+                     std::size_t& sink) {
+    std::atomic<bool> go(false);
+    std::atomic<std::size_t> found(0);
+    std::vector<std::thread> workers;
+    for (std::size_t t = 0; t < threads; ++t)
+        workers.emplace_back([&, t] {
+            std::mt19937_64 rng(t + 1);
+            std::size_t hits = 0;
+            auto ops = totalOps / threads;
+            while (!go)
+                std::this_thread::yield();
+            for (std::size_t i = 0; i < ops; ++i) {
+                auto r = rng();
+                auto key = makeKey((r >> 8) % (2 * keys));
+                if (r % 100 < readPercent)
+                    hits += map.contains(key);
+                else if ((r >> 7) % 4 != 0)
+                    map.insert_or_assign(key, int(i));
+                else
+                    map.erase(key);
+            }
+            found += hits;
+        });
+    StopWatch<std::chrono::nanoseconds> watch;
+    go = true;
+    for (auto& w : workers)
+        w.join();
+    auto ns = double(watch.elapsed().count());
+    sink += found;
+    return 1000.0 * (totalOps / threads * threads) / ns;
+}
+
+template <typename Map>
+void prefill(Map& map, std::size_t keys) {
+    map.reserve(2 * keys);
+    for (std::size_t i = 0; i < keys; ++i)
+        map.insert_or_assign(makeKey(2 * i), int(i));
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t keys = bench::sizeArg(argc, argv, 1000000);
+    const std::size_t totalOps = 4000000;
+    std::size_t sink = 0;
+
+    std::printf("%zu keys, %zu operations, %u hardware threads\n", keys,
+                totalOps, std::thread::hardware_concurrency());
+    for (unsigned readPercent : {100u, 95u, 80u, 50u}) {
+        std::printf("%u%% lookups (Mops/s)\n", readPercent);
+        std::printf("  %-8s %14s %20s\n", "threads", "mutex + std",
+                    "concurrent_hash_map");
+        for (std::size_t threads = 1; threads <= 64; threads *= 2) {
+            LockedMap locked;
+            prefill(locked, keys);
+            ShardedMap sharded;
+            prefill(sharded, keys);
+            auto a = mopsPerSecond(locked, keys, threads, readPercent,
+                                   totalOps, sink);
+            auto b = mopsPerSecond(sharded, keys, threads, readPercent,
+                                   totalOps, sink);
+            std::printf("  %-8zu %14.2f %20.2f\n", threads, a, b);
+        }
+    }
+
+    return bench::keepAlive(sink);
+}
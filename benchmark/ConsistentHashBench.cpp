@@ -0,0 +1,56 @@
+// Lookup cost of jump_hash, rendezvous_hash and hash_ring for 8 to 1024
+// nodes, plus rendezvous_hash's score loop without SIMD, to show what the
+// vectorized loop buys. Keys are random 64-bit integers hashed with
+// std::hash. The number of lookups per configuration is given on the
+// command line (1M by default).
+
+#include "Util/ConsistentHash.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace util;
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 1000000);
+    std::mt19937_64 rng(1);
+    std::vector<std::uint64_t> keys(n);
+    for (auto& k : keys)
+        k = rng();
+    std::uint64_t sink = 0;
+
+    std::printf("%6s %10s %12s %12s %10s  (ns/lookup)\n", "nodes", "jump",
+                "rendezvous", "hrw scalar", "ring");
+    for (std::uint32_t nodes : {8u, 32u, 128u, 512u, 1024u}) {
+        jump_hash<std::uint64_t> jump(nodes);
+        rendezvous_hash<std::uint64_t> hrw;
+        hash_ring<std::uint64_t> ring;
+        std::vector<std::uint32_t> seeds;
+        for (std::uint64_t id = 0; id < nodes; ++id) {
+            hrw.add_node(id);
+            ring.add_node(id);
+            seeds.push_back(consistent_hash_detail::nodeSeed(id));
+        }
+
+        auto jumpNs = bench::nsPerCall(n, [&](std::size_t i) {
+            return jump(keys[i]);
+        }, sink);
+        auto hrwNs = bench::nsPerCall(n, [&](std::size_t i) {
+            return hrw.node_for(keys[i]);
+        }, sink);
+        auto scalarNs = bench::nsPerCall(n, [&](std::size_t i) {
+            return consistent_hash_detail::bestScoreScalar(
+                consistent_hash_detail::keyHash(keys[i]), seeds.data(), nodes);
+        }, sink);
+        auto ringNs = bench::nsPerCall(n, [&](std::size_t i) {
+            return ring.node_for(keys[i]);
+        }, sink);
+        std::printf("%6u %10.2f %12.2f %12.2f %10.2f\n", nodes, jumpNs, hrwNs,
+                    scalarNs, ringNs);
+    }
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,99 @@
+// Compares error propagation through util::expected against throw/catch for
+// a small integer parser, at several rates of malformed input.
+
+#include "Util/Expected.h"
+
+#include "BenchUtil.h"
+
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+enum class ParseError { Empty, BadDigit };
+
+struct ParseException {
+    ParseError error;
+};
+
+__attribute__((noinline)) expected<int, ParseError>
+parseExpected(const std::string& s) {
+    if (s.empty())
+        return make_unexpected(ParseError::Empty);
+    int ret = 0;
+    for (auto c : s) {
+        if (c < '0' || c > '9')
+            return make_unexpected(ParseError::BadDigit);
+        ret = ret * 10 + (c - '0');
+    }
+    return ret;
+}
+
+__attribute__((noinline)) int parseThrow(const std::string& s) {
+    if (s.empty())
+        throw ParseException{ParseError::Empty};
+    int ret = 0;
+    for (auto c : s) {
+        if (c < '0' || c > '9')
+            throw ParseException{ParseError::BadDigit};
+        ret = ret * 10 + (c - '0');
+    }
+    return ret;
+}
+
+std::vector<std::string> makeInput(std::size_t n, double errorRate) {
+    std::mt19937_64 rng(42);
+    std::uniform_int_distribution<int> num(0, 999999);
+    std::bernoulli_distribution bad(errorRate);
+
+    std::vector<std::string> ret;
+    ret.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        auto s = std::to_string(num(rng));
+        if (bad(rng))
+            s[s.size() / 2] = 'x';
+        ret.push_back(std::move(s));
+    }
+    return ret;
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 1000000);
+    long sink = 0;
+
+    std::printf("%-12s %16s %16s\n", "error rate", "expected ns/op",
+                "throw ns/op");
+    for (auto rate : {0.001, 0.05, 0.5}) {
+        auto input = makeInput(n, rate);
+
+        auto byExpected = bench::nsPerOp(input.size(), [&] {
+            long sum = 0;
+            for (auto& s : input) {
+                auto r = parseExpected(s);
+                sum += r ? *r : -static_cast<long>(r.error());
+            }
+            return sum;
+        }, sink);
+
+        auto byThrow = bench::nsPerOp(input.size(), [&] {
+            long sum = 0;
+            for (auto& s : input) {
+                try {
+                    sum += parseThrow(s);
+                } catch (const ParseException& e) {
+                    sum -= static_cast<long>(e.error);
+                }
+            }
+            return sum;
+        }, sink);
+
+        std::printf("%-12g %16.2f %16.2f\n", rate, byExpected, byThrow);
+    }
+
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,102 @@
+// flat_hash_map against std::unordered_map for int, pair<int, int> and string
+// keys, from 1K entries up to the size given on the command line (10M by
+// default, pass 100000000 for the full range). Lookups are done in random
+// order, for keys that are present and keys that are not.
+
+#include "Util/FlatHashMap.h"
+
+#include "BenchUtil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+using IntPair = std::pair<int, int>;
+
+int makeKey(std::size_t i, int) { return int(i * 2654435761u); }
+
+IntPair makeKey(std::size_t i, IntPair) { return {int(i), int(i >> 10)}; }
+
+std::string makeKey(std::size_t i, std::string) {
+    return "key:" + std::to_string(i * 2654435761u);
+}
+
+template <typename Map, typename Key>
+void run(const char* name, const std::vector<Key>& keys,
+         const std::vector<Key>& missing, std::size_t& sink) {
+    // Small tables are measured over many rounds to get stable numbers
+    auto rounds = std::max<std::size_t>(1, 10000000 / keys.size());
+    Map map;
+    auto insert = bench::nsPerOp(keys.size(), [&] {
+        for (const auto& k : keys)
+            map.emplace(k, 1);
+        return map.size();
+    }, sink);
+    auto hit = bench::nsPerOp(keys.size() * rounds, [&] {
+        std::size_t found = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            for (const auto& k : keys)
+                found += map.find(k)->second;
+        return found;
+    }, sink);
+    auto miss = bench::nsPerOp(missing.size() * rounds, [&] {
+        std::size_t found = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            for (const auto& k : missing)
+                found += map.count(k);
+        return found;
+    }, sink);
+    auto erase = bench::nsPerOp(keys.size(), [&] {
+        std::size_t erased = 0;
+        for (const auto& k : keys)
+            erased += map.erase(k);
+        return erased;
+    }, sink);
+    std::printf("  %-16s insert %7.2f  hit %7.2f  miss %7.2f  erase %7.2f "
+                "ns/op\n",
+                name, insert, hit, miss, erase);
+}
+
+template <typename Key, typename StdHash, typename FlatHash>
+void benchKey(const char* keyName, std::size_t n, std::size_t& sink) {
+    std::vector<Key> keys, missing;
+    keys.reserve(n);
+    missing.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        keys.push_back(makeKey(2 * i, Key()));
+        missing.push_back(makeKey(2 * i + 1, Key()));
+    }
+    std::mt19937 rng(1);
+    std::shuffle(keys.begin(), keys.end(), rng);
+
+    std::printf("%s, %zu entries\n", keyName, n);
+    run<std::unordered_map<Key, int, StdHash>>("unordered_map", keys, missing,
+                                               sink);
+    run<flat_hash_map<Key, int, FlatHash>>("flat_hash_map", keys, missing,
+                                           sink);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t maxSize = bench::sizeArg(argc, argv, 10000000);
+    std::size_t sink = 0;
+
+    for (std::size_t n = 1000; n <= maxSize; n *= 10) {
+        benchKey<int, std::hash<int>, std::hash<int>>("int", n, sink);
+        benchKey<IntPair, PairHasher<IntPair>, PairHasher<IntPair>>(
+            "pair<int, int>", n, sink);
+        benchKey<std::string, std::hash<std::string>, StringHasher<>>(
+            "string", n, sink);
+    }
+
+    return bench::keepAlive(sink);
+}
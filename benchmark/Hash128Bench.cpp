@@ -0,0 +1,62 @@
+// The cost of 128-bit fingerprints against 64-bit hashes: hashBytes128
+// against hashBytes for keys of 8 bytes to 64KB, and hashContainer128 against
+// hashContainer for documents of 1 to 1000 words. The total number of bytes
+// hashed per row is given on the command line (256MB by default).
+
+#include "Util/Hash128.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace util;
+
+int main(int argc, char** argv) {
+    std::size_t total = bench::sizeArg(argc, argv, std::size_t(1) << 28);
+    std::uint64_t sink = 0;
+    std::mt19937_64 rng(1);
+
+    std::printf("%8s %12s %12s %8s  (ns/key)\n", "bytes", "hashBytes",
+                "hashBytes128", "ratio");
+    std::string data(1 << 20, '\0');
+    for (auto& c : data)
+        c = char(rng());
+    for (std::size_t len : {8u, 16u, 32u, 64u, 256u, 1024u, 4096u, 65536u}) {
+        auto ops = total / len;
+        // Keys start at varying offsets of a 1MB buffer, so stay in cache
+        auto offset = [&](std::size_t i) {
+            return (i * 64) % (data.size() - len);
+        };
+        auto ns64 = bench::nsPerCall(ops, [&](std::size_t i) {
+            return hashBytes(data.data() + offset(i), len);
+        }, sink);
+        auto ns128 = bench::nsPerCall(ops, [&](std::size_t i) {
+            return hashBytes128(data.data() + offset(i), len).hi;
+        }, sink);
+        std::printf("%8zu %12.2f %12.2f %8.2f\n", len, ns64, ns128,
+                    ns128 / ns64);
+    }
+
+    std::printf("\n%8s %12s %12s %8s  (ns/document)\n", "words",
+                "Container", "Container128", "ratio");
+    for (std::size_t words : {1u, 10u, 100u, 1000u}) {
+        std::vector<std::vector<std::string>> docs(64);
+        for (auto& doc : docs)
+            for (std::size_t w = 0; w < words; ++w)
+                doc.push_back(std::to_string(rng() % 100000));
+        auto ops = total / (words * 8);
+        auto ns64 = bench::nsPerCall(ops, [&](std::size_t i) {
+            return hashContainer(docs[i % docs.size()]);
+        }, sink);
+        auto ns128 = bench::nsPerCall(ops, [&](std::size_t i) {
+            return hashContainer128(docs[i % docs.size()]).hi;
+        }, sink);
+        std::printf("%8zu %12.2f %12.2f %8.2f\n", words, ns64, ns128,
+                    ns128 / ns64);
+    }
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,89 @@
+// hash_batch against hashing one key at a time, for columns of int64,
+// pair<int32, int32> and fixed-width strings of 5, 8, 16 and 40 bytes. Every
+// variant writes its hashes to an output column, as a hash join's build or
+// probe phase would. The number of keys is given on the command line (10M
+// by default).
+
+#include "Util/HashBatch.h"
+#include "Util/StopWatch.h"
+
+#include "BenchUtil.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+template <typename F>
+void report(const char* name, std::size_t n, std::size_t bytesPerKey,
+            const std::vector<std::uint64_t>& out, F&& f,
+            std::size_t& sink) {
+    f(); // warm up the output column
+    StopWatch<std::chrono::nanoseconds> watch;
+    f();
+    auto ns = double(watch.elapsed().count()) / n;
+    sink += out[n / 2];
+    std::printf("  %-24s %6.2f ns/key %6.2f GB/s\n", name, ns,
+                bytesPerKey / ns);
+}
+
+using IntPair = std::pair<std::int32_t, std::int32_t>;
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 10000000);
+    std::size_t sink = 0;
+    std::mt19937_64 rng(1);
+    std::vector<std::uint64_t> out(n);
+    std::printf("%zu keys\n", n);
+
+    {
+        std::vector<std::int64_t> keys(n);
+        for (auto& k : keys)
+            k = static_cast<std::int64_t>(rng());
+        std::printf("int64\n");
+        report("hashValues per key", n, 8, out, [&] {
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] = hashValues(keys[i]);
+        }, sink);
+        report("hash_batch", n, 8, out,
+               [&] { hash_batch(keys.data(), n, out.data()); }, sink);
+    }
+
+    {
+        std::vector<IntPair> keys(n);
+        for (auto& k : keys)
+            k = {std::int32_t(rng()), std::int32_t(rng())};
+        std::printf("pair<int32, int32>\n");
+        report("PairHasher per key", n, 8, out, [&] {
+            PairHasher<IntPair> hasher;
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] = hasher(keys[i]);
+        }, sink);
+        report("hash_batch", n, 8, out,
+               [&] { hash_batch(keys.data(), n, out.data()); }, sink);
+    }
+
+    for (std::size_t width : {5u, 8u, 16u, 40u}) {
+        std::string data(n * width, '\0');
+        for (auto& c : data)
+            c = static_cast<char>('a' + rng() % 26);
+        std::printf("strings of %zu bytes\n", width);
+        // What StringHasher does for each key, without building strings
+        report("hashBytes per key", n, width, out, [&] {
+            for (std::size_t i = 0; i < n; ++i)
+                out[i] = hashBytes(data.data() + i * width, width);
+        }, sink);
+        report("hash_batch", n, width, out,
+               [&] { hash_batch(data.data(), width, n, out.data()); }, sink);
+    }
+
+    return bench::keepAlive(sink);
+}
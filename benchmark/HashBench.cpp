@@ -0,0 +1,111 @@
+// Throughput of the Hashing.h API, and the behaviour of PairHasher in an
+// unordered_map keyed by dense integer pairs, compared against the previous
+// boost-style hash_combine.
+
+#include "Util/Hashing.h"
+#include "Util/ParallelHash.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+struct BoostStylePairHasher {
+    std::size_t operator()(const std::pair<int, int>& p) const {
+        std::size_t seed = 0;
+        seed ^= std::hash<int>()(p.first) + 0x9e3779b9 + (seed << 6) +
+                (seed >> 2);
+        seed ^= std::hash<int>()(p.second) + 0x9e3779b9 + (seed << 6) +
+                (seed >> 2);
+        return seed;
+    }
+};
+
+template <typename Hasher>
+void mapBench(const char* name, int side, std::size_t& sink) {
+    std::unordered_map<std::pair<int, int>, int, Hasher> map;
+    auto n = std::size_t(side) * side;
+    auto insert = bench::nsPerOp(n, [&] {
+        for (int i = 0; i < side; ++i)
+            for (int j = 0; j < side; ++j)
+                map.emplace(std::make_pair(i, j), i ^ j);
+        return map.size();
+    }, sink);
+    auto lookup = bench::nsPerOp(n, [&] {
+        std::size_t found = 0;
+        for (int j = 0; j < side; ++j)
+            for (int i = 0; i < side; ++i)
+                found += map.count(std::make_pair(i, j));
+        return found;
+    }, sink);
+
+    std::size_t longest = 0;
+    for (std::size_t b = 0; b < map.bucket_count(); ++b)
+        longest = std::max(longest, map.bucket_size(b));
+    std::printf("%-22s insert %8.2f ns  lookup %8.2f ns  longest chain %zu\n",
+                name, insert, lookup, longest);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 10000000);
+    std::size_t sink = 0;
+
+    auto pair = bench::nsPerOp(n, [&] {
+        std::size_t acc = 0;
+        for (std::size_t i = 0; i < n; ++i)
+            acc += hashPair(int(i), int(i >> 3));
+        return acc;
+    }, sink);
+    std::printf("hashPair(int, int)     %8.2f ns/key\n", pair);
+
+    std::vector<std::uint32_t> words(1 << 20);
+    for (std::size_t i = 0; i < words.size(); ++i)
+        words[i] = std::uint32_t(i * 2654435761u);
+    auto rounds = std::max<std::size_t>(1, n / words.size());
+    auto container = bench::nsPerOp(rounds, [&] {
+        std::size_t acc = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            acc += hashContainer(words);
+        return acc;
+    }, sink);
+    std::printf("hashContainer(1M u32)  %8.2f GB/s\n",
+                words.size() * sizeof(std::uint32_t) / container);
+    auto perElement = bench::nsPerOp(rounds, [&] {
+        std::size_t acc = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            acc += hashRange(words.begin(), words.end(),
+                             [](std::uint32_t w) { return w; });
+        return acc;
+    }, sink);
+    std::printf("per-element (1M u32)   %8.2f GB/s\n",
+                words.size() * sizeof(std::uint32_t) / perElement);
+
+    // A 256 MB buffer hashed in 1 MB chunks, on one thread and on all of them
+    std::vector<std::uint64_t> big(std::size_t(1) << 25);
+    for (std::size_t i = 0; i < big.size(); ++i)
+        big[i] = i * 0x9e3779b97f4a7c15ULL;
+    auto bigBytes = big.size() * sizeof(std::uint64_t);
+    ThreadPool single(0), all;
+    auto serialTree = bench::nsPerOp(1, [&] {
+        return parallelHashContainer(single, big, 1 << 17);
+    }, sink);
+    auto parallelTree = bench::nsPerOp(1, [&] {
+        return parallelHashContainer(all, big, 1 << 17);
+    }, sink);
+    std::printf("tree hash, 1 thread    %8.2f GB/s\n", bigBytes / serialTree);
+    std::printf("tree hash, %2zu threads  %8.2f GB/s\n", all.size() + 1,
+                bigBytes / parallelTree);
+
+    mapBench<BoostStylePairHasher>("boost-style combine", 1000, sink);
+    mapBench<PairHasher<std::pair<int, int>>>("util::PairHasher", 1000, sink);
+
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,314 @@
+// Speed and quality of the Hashing.h hashers on typical key distributions:
+// sequential ids, strided pointers, a small enum range, short strings, dense
+// integer pairs and 4 KB buffers. For every hasher and key set it reports:
+//  - ns per key and GB/s over the key bytes
+//  - avalanche: for 2000 of the keys and every input bit, the probability
+//    that flipping it flips each output bit, as the worst and the mean
+//    deviation from 1/2. 0.5 means some output bit never or always flips;
+//    sampling alone puts the floor at about 0.045 worst and 0.009 mean.
+//  - the chi-square of the bucket loads of n / 4 buckets, both for a power
+//    of two table indexed by the low bits and for a prime table indexed
+//    modulo the prime, as a z-score (|z| below 3 is what a random function
+//    gives; large positive values mean clustering)
+//  - collisions of the full hashes and of their low 32 bits, with the number
+//    expected from a random function for the latter
+// The number of keys per set is given on the command line (1M by default).
+// It has to be at least 32, enough for the 8 buckets of the smallest tables
+// to expect 4 keys each.
+
+#include "Util/Hashing.h"
+#include "Util/StopWatch.h"
+
+#include "BenchUtil.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+enum class Color : std::uint8_t {};
+
+using IntPair = std::pair<int, int>;
+using Buffer = std::vector<std::uint8_t>;
+
+// Flips bit b of a key, for the avalanche test
+std::size_t keyBits(std::uint64_t) { return 64; }
+std::uint64_t flip(std::uint64_t k, std::size_t b) {
+    return k ^ (std::uint64_t(1) << b);
+}
+
+std::size_t keyBits(const void*) { return 8 * sizeof(void*); }
+const void* flip(const void* p, std::size_t b) {
+    return reinterpret_cast<const void*>(reinterpret_cast<std::uintptr_t>(p) ^
+                                         (std::uintptr_t(1) << b));
+}
+
+std::size_t keyBits(Color) { return 8; }
+Color flip(Color c, std::size_t b) {
+    return static_cast<Color>(static_cast<std::uint8_t>(c) ^ (1u << b));
+}
+
+std::size_t keyBits(const IntPair&) { return 64; }
+IntPair flip(IntPair p, std::size_t b) {
+    if (b < 32)
+        p.first = int(unsigned(p.first) ^ (1u << b));
+    else
+        p.second = int(unsigned(p.second) ^ (1u << (b - 32)));
+    return p;
+}
+
+std::size_t keyBits(const std::string& s) { return 8 * s.size(); }
+std::string flip(std::string s, std::size_t b) {
+    s[b / 8] = char(s[b / 8] ^ (1 << (b % 8)));
+    return s;
+}
+
+// Buffers are only flipped in their first and last 64 bits, which is enough
+// to catch a tail or a head that is mixed poorly
+std::size_t keyBits(const Buffer&) { return 128; }
+Buffer flip(Buffer v, std::size_t b) {
+    auto byte = b < 64 ? b / 8 : v.size() - 8 + (b - 64) / 8;
+    v[byte] ^= std::uint8_t(1u << (b % 8));
+    return v;
+}
+
+// The chi-square tables have at least 8 buckets, and n / 4 of them
+constexpr std::size_t kMinKeys = 32;
+
+bool isPrime(std::size_t n) {
+    if (n < 2)
+        return false;
+    for (std::size_t d = 2; d * d <= n; ++d)
+        if (n % d == 0)
+            return false;
+    return true;
+}
+
+template <typename F>
+double chiSquareZ(const std::vector<std::size_t>& hashes, std::size_t buckets,
+                  F&& bucketOf) {
+    std::vector<std::size_t> load(buckets, 0);
+    for (auto h : hashes)
+        ++load[bucketOf(h)];
+    double expected = double(hashes.size()) / buckets;
+    double chi2 = 0;
+    for (auto l : load)
+        chi2 += (l - expected) * (l - expected) / expected;
+    return (chi2 - (buckets - 1)) / std::sqrt(2.0 * (buckets - 1));
+}
+
+std::size_t duplicates(std::vector<std::size_t> hashes) {
+    std::sort(hashes.begin(), hashes.end());
+    return hashes.size() -
+           std::size_t(std::unique(hashes.begin(), hashes.end()) -
+                       hashes.begin());
+}
+
+template <typename Key, typename Hash>
+void report(const char* name, const std::vector<Key>& keys,
+            std::size_t bytesPerKey, Hash&& hash, std::size_t& sink) {
+    // Speed, over several rounds for small key sets
+    auto rounds = std::max<std::size_t>(
+        1, std::min<std::size_t>((1 << 22) / keys.size(),
+                                 (1 << 28) / (keys.size() * bytesPerKey)));
+    StopWatch<std::chrono::nanoseconds> watch;
+    std::size_t acc = 0;
+    for (std::size_t r = 0; r < rounds; ++r)
+        for (const auto& k : keys)
+            acc += hash(k);
+    double ns = double(watch.elapsed().count()) / (rounds * keys.size());
+    sink += acc;
+
+    // Avalanche, on a sample of the keys
+    std::size_t samples = std::min<std::size_t>(keys.size(), 2000);
+    auto bits = keyBits(keys[0]);
+    std::vector<std::size_t> flips(bits * 64, 0);
+    for (std::size_t s = 0; s < samples; ++s) {
+        const auto& k = keys[s * keys.size() / samples];
+        auto h = std::uint64_t(hash(k));
+        for (std::size_t b = 0; b < bits; ++b) {
+            auto diff = h ^ std::uint64_t(hash(flip(k, b)));
+            for (std::size_t o = 0; o < 64; ++o)
+                flips[b * 64 + o] += (diff >> o) & 1;
+        }
+    }
+    double worst = 0, mean = 0;
+    for (auto f : flips) {
+        auto bias = std::fabs(double(f) / samples - 0.5);
+        worst = std::max(worst, bias);
+        mean += bias;
+    }
+    mean /= flips.size();
+
+    std::vector<std::size_t> hashes;
+    hashes.reserve(keys.size());
+    for (const auto& k : keys)
+        hashes.push_back(hash(k));
+
+    std::size_t pow2 = 8;
+    while (pow2 * 2 <= keys.size() / 4)
+        pow2 *= 2;
+    auto prime = pow2 - 1;
+    while (!isPrime(prime))
+        --prime;
+    auto zPow2 = chiSquareZ(hashes, pow2,
+                            [&](std::size_t h) { return h & (pow2 - 1); });
+    auto zPrime =
+        chiSquareZ(hashes, prime, [&](std::size_t h) { return h % prime; });
+
+    auto collisions = duplicates(hashes);
+    for (auto& h : hashes)
+        h = std::uint32_t(h);
+    auto collisions32 = duplicates(hashes);
+    double n = double(keys.size());
+    double expected32 = n * n / (2.0 * 4294967296.0);
+
+    std::printf("  %-24s %7.2f ns %7.2f GB/s  avalanche %.3f/%.3f  "
+                "chi2 z %9.1f/%9.1f  collisions %zu, low 32 %zu (%.1f)\n",
+                name, ns, bytesPerKey / ns, worst, mean, zPow2, zPrime,
+                collisions, collisions32, expected32);
+}
+
+template <typename T>
+std::size_t stdHash(const T& v) {
+    return std::hash<T>()(v);
+}
+
+template <typename T>
+std::size_t combined(const T& v) {
+    std::size_t seed = 0;
+    hash_combine(seed, v);
+    return seed;
+}
+
+void header(const char* keys, std::size_t n) {
+    std::printf("%s, %zu keys (avalanche worst/mean, chi2 z pow2/prime)\n",
+                keys, n);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 1000000);
+    if (n < kMinKeys) {
+        std::fprintf(stderr, "HashQualityBench: need at least %zu keys\n",
+                     kMinKeys);
+        return 1;
+    }
+    std::size_t sink = 0;
+    std::mt19937_64 rng(1);
+
+    {
+        std::vector<std::uint64_t> ids(n);
+        for (std::size_t i = 0; i < n; ++i)
+            ids[i] = i;
+        header("sequential ids", n);
+        report("std::hash", ids, 8, stdHash<std::uint64_t>, sink);
+        report("hash_mix", ids, 8, hash_mix, sink);
+        report("hash_combine", ids, 8, combined<std::uint64_t>, sink);
+        report("hashValues", ids, 8,
+               [](std::uint64_t v) { return hashValues(v); }, sink);
+    }
+
+    {
+        // Addresses of 64-byte objects, as from an allocator
+        std::vector<const void*> pointers(n);
+        for (std::size_t i = 0; i < n; ++i)
+            pointers[i] = reinterpret_cast<const void*>(
+                std::uintptr_t(0x7f0000000000ULL + 64 * i));
+        header("pointers with a 64 byte stride", n);
+        report("std::hash", pointers, sizeof(void*), stdHash<const void*>,
+               sink);
+        report("hash_combine", pointers, sizeof(void*),
+               combined<const void*>, sink);
+        report("hashValues", pointers, sizeof(void*),
+               [](const void* p) { return hashValues(p); }, sink);
+    }
+
+    {
+        std::vector<Color> colors(256);
+        for (std::size_t i = 0; i < colors.size(); ++i)
+            colors[i] = static_cast<Color>(i);
+        header("enum range", colors.size());
+        report("hashEnumClass", colors, 1, hashEnumClass<Color>, sink);
+        report("EnumClassHasher", colors, 1, EnumClassHasher<Color>(), sink);
+        report("hashValues", colors, 1,
+               [](Color c) { return hashValues(static_cast<std::uint8_t>(c)); },
+               sink);
+    }
+
+    {
+        std::vector<std::string> strings(n);
+        std::size_t bytes = 0;
+        // Distinct keys of 4 to 16 bytes
+        for (std::size_t i = 0; i < n; ++i) {
+            strings[i] = "u" + std::to_string(i);
+            strings[i].resize(std::max(strings[i].size(), 4 + i % 13), 'x');
+            bytes += strings[i].size();
+        }
+        header("short strings", n);
+        report("std::hash", strings, bytes / n, stdHash<std::string>, sink);
+        report("StringHasher", strings, bytes / n, StringHasher<>(), sink);
+        report("hashRange(pointers)", strings, bytes / n,
+               [](const std::string& s) {
+                   return hashRange(s.data(), s.data() + s.size());
+               },
+               sink);
+        report("hashRange(per element)", strings, bytes / n,
+               [](const std::string& s) {
+                   return hashRange(s.begin(), s.end(),
+                                    [](char c) { return c; });
+               },
+               sink);
+    }
+
+    {
+        std::vector<IntPair> pairs;
+        std::size_t side = 1;
+        while (side * side < n)
+            ++side;
+        for (std::size_t i = 0; i < side; ++i)
+            for (std::size_t j = 0; j < side && pairs.size() < n; ++j)
+                pairs.emplace_back(int(i), int(j));
+        header("dense integer pairs", pairs.size());
+        report("hashPair", pairs, 8,
+               [](const IntPair& p) { return hashPair(p.first, p.second); },
+               sink);
+        report("PairHasher", pairs, 8, PairHasher<IntPair>(), sink);
+        report("hash_combine x2", pairs, 8,
+               [](const IntPair& p) {
+                   std::size_t seed = 0;
+                   hash_combine(seed, p.first);
+                   hash_combine(seed, p.second);
+                   return seed;
+               },
+               sink);
+    }
+
+    {
+        std::size_t count = std::max<std::size_t>(64, n / 256);
+        std::vector<Buffer> buffers(count, Buffer(4096));
+        for (auto& b : buffers)
+            for (auto& x : b)
+                x = std::uint8_t(rng());
+        header("4 KB buffers", count);
+        report("hashContainer", buffers, 4096,
+               [](const Buffer& b) { return hashContainer(b); }, sink);
+        report("hashRange(per element)", buffers, 4096,
+               [](const Buffer& b) {
+                   return hashRange(b.begin(), b.end(),
+                                    [](std::uint8_t x) { return x; });
+               },
+               sink);
+    }
+
+    return bench::keepAlive(sink);
+}
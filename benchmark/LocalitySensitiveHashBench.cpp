@@ -0,0 +1,60 @@
+// The cost of MinHash signatures of 128 values for sets of 10 to 10000
+// integers: minhasher with the vectorized kernel, the same kernel as a plain
+// loop, and one_permutation_minhasher; then SimHash over the same sets. The
+// number of elements hashed per row is given on the command line (10M by
+// default).
+
+#include "Util/LocalitySensitiveHash.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+using namespace util;
+
+int main(int argc, char** argv) {
+    std::size_t total = bench::sizeArg(argc, argv, 10000000);
+    constexpr std::size_t kHashes = 128;
+    std::uint64_t sink = 0;
+    minhasher minhash(kHashes);
+    one_permutation_minhasher oph(kHashes);
+    std::vector<std::uint32_t> seeds(kHashes);
+    for (std::size_t i = 0; i < kHashes; ++i)
+        seeds[i] = std::uint32_t(hash_mix(i));
+
+    std::printf("%8s %10s %10s %10s %10s  (ns/element)\n", "elements",
+                "minhash", "scalar", "oph", "simhash");
+    for (std::size_t n : {10u, 100u, 1000u, 10000u}) {
+        std::vector<std::uint64_t> set(n);
+        for (std::size_t i = 0; i < n; ++i)
+            set[i] = i * 7919;
+        std::vector<std::uint32_t> keys(n), sig(kHashes);
+        for (std::size_t i = 0; i < n; ++i)
+            keys[i] = std::uint32_t(hash_mix(set[i]));
+        auto ops = std::max<std::size_t>(total / n, 1);
+
+        auto minhashNs = bench::nsPerCall(ops, [&](std::size_t i) {
+            set[0] = i;
+            return minhash.signature(set.begin(), set.end())[0];
+        }, sink) / n;
+        auto scalarNs = bench::nsPerCall(ops, [&](std::size_t i) {
+            keys[0] = std::uint32_t(i);
+            lsh_detail::minHashesScalar(keys.data(), n, seeds.data(), kHashes,
+                                        sig.data());
+            return sig[0];
+        }, sink) / n;
+        auto ophNs = bench::nsPerCall(ops, [&](std::size_t i) {
+            set[0] = i;
+            return oph.signature(set.begin(), set.end())[0];
+        }, sink) / n;
+        auto simhashNs = bench::nsPerCall(ops, [&](std::size_t i) {
+            set[0] = i;
+            return simhash(set.begin(), set.end());
+        }, sink) / n;
+        std::printf("%8zu %10.2f %10.2f %10.2f %10.2f\n", n, minhashNs,
+                    scalarNs, ophNs, simhashNs);
+    }
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,78 @@
+// Sums and filters a column of optional<double> at several null densities,
+// comparing a plain branchy loop with the algorithms of OptionalAlgorithm.h.
+
+#include "Util/OptionalAlgorithm.h"
+
+#include "BenchUtil.h"
+
+#include <cstdio>
+#include <random>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+std::vector<optional<double>> makeColumn(std::size_t n, double nullRate) {
+    std::mt19937_64 rng(7);
+    std::bernoulli_distribution isNull(nullRate);
+    std::uniform_real_distribution<double> val(-100.0, 100.0);
+
+    std::vector<optional<double>> ret;
+    ret.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (isNull(rng))
+            ret.emplace_back();
+        else
+            ret.emplace_back(val(rng));
+    }
+    return ret;
+}
+
+template <typename F>
+double msOf(F&& f, double& sink) {
+    return bench::nsPerOp(1, f, sink) / 1e6;
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 20000000);
+    ThreadPool pool;
+    double sink = 0;
+
+    std::printf("%zu elements, %zu threads\n", n, pool.size());
+    std::printf("%-10s %12s %12s %12s %12s %12s\n", "null rate", "loop ms",
+                "sum ms", "par sum ms", "filter ms", "par filt ms");
+    for (auto rate : {0.1, 0.5, 0.9}) {
+        auto column = makeColumn(n, rate);
+        std::vector<double> out(n);
+
+        auto loop = msOf([&] {
+            double sum = 0;
+            for (auto& o : column)
+                if (o)
+                    sum += *o;
+            return sum;
+        }, sink);
+        auto seq = msOf([&] { return sum_engaged(column.begin(), column.end()); },
+                        sink);
+        auto par = msOf(
+            [&] { return sum_engaged(pool, column.begin(), column.end()); },
+            sink);
+        auto filter = msOf([&] {
+            return double(filter_engaged(column.begin(), column.end(),
+                                         out.begin()) -
+                          out.begin());
+        }, sink);
+        auto parFilter = msOf([&] {
+            return double(filter_engaged(pool, column.begin(), column.end(),
+                                         out.begin()) -
+                          out.begin());
+        }, sink);
+
+        std::printf("%-10g %12.2f %12.2f %12.2f %12.2f %12.2f\n", rate, loop, seq,
+                    par, filter, parFilter);
+    }
+
+    return bench::keepAlive(sink);
+}
@@ -0,0 +1,124 @@
+// perfect_hash_map against std::unordered_map, flat_hash_map and binary
+// search in a sorted vector, for static sets of int and string keys from 10
+// entries up to the size given on the command line (100K by default). The
+// build time is reported per key; lookups are done in random order, for keys
+// that are present and keys that are not.
+
+#include "Util/FlatHashMap.h"
+#include "Util/PerfectHashMap.h"
+
+#include "BenchUtil.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+int makeKey(std::size_t i, int) { return int(i * 2654435761u); }
+
+std::string makeKey(std::size_t i, std::string) {
+    return "config.section" + std::to_string(i % 37) + ".key" +
+           std::to_string(i);
+}
+
+// The interface the benchmark needs, over a sorted vector of pairs
+template <typename Key>
+class SortedVectorMap {
+private:
+    std::vector<std::pair<Key, int>> entries;
+
+    typename std::vector<std::pair<Key, int>>::const_iterator
+    lowerBound(const Key& k) const {
+        return std::lower_bound(
+            entries.begin(), entries.end(), k,
+            [](const std::pair<Key, int>& e, const Key& k) {
+                return e.first < k;
+            });
+    }
+
+public:
+    template <typename It>
+    SortedVectorMap(It first, It last) : entries(first, last) {
+        std::sort(entries.begin(), entries.end());
+    }
+
+    int at(const Key& k) const { return lowerBound(k)->second; }
+
+    std::size_t count(const Key& k) const {
+        auto it = lowerBound(k);
+        return it != entries.end() && it->first == k;
+    }
+};
+
+template <typename Map, typename Key>
+void run(const char* name, const std::vector<std::pair<Key, int>>& entries,
+         const std::vector<Key>& hits, const std::vector<Key>& missing,
+         std::size_t& sink) {
+    auto rounds = std::max<std::size_t>(1, 10000000 / hits.size());
+    std::unique_ptr<Map> map;
+    auto build = bench::nsPerOp(entries.size(), [&] {
+        map.reset(new Map(entries.begin(), entries.end()));
+        return std::size_t(1);
+    }, sink);
+    auto hit = bench::nsPerOp(hits.size() * rounds, [&] {
+        std::size_t found = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            for (const auto& k : hits)
+                found += map->at(k);
+        return found;
+    }, sink);
+    auto miss = bench::nsPerOp(missing.size() * rounds, [&] {
+        std::size_t found = 0;
+        for (std::size_t r = 0; r < rounds; ++r)
+            for (const auto& k : missing)
+                found += map->count(k);
+        return found;
+    }, sink);
+    std::printf("  %-18s build %8.2f  hit %7.2f  miss %7.2f ns/op\n", name,
+                build, hit, miss);
+}
+
+template <typename Key, typename Hash>
+void benchKey(const char* keyName, std::size_t n, std::size_t& sink) {
+    std::vector<std::pair<Key, int>> entries;
+    std::vector<Key> hits, missing;
+    for (std::size_t i = 0; i < n; ++i) {
+        entries.emplace_back(makeKey(2 * i, Key()), int(i));
+        hits.push_back(makeKey(2 * i, Key()));
+        missing.push_back(makeKey(2 * i + 1, Key()));
+    }
+    std::mt19937 rng(1);
+    std::shuffle(hits.begin(), hits.end(), rng);
+
+    std::printf("%s, %zu entries\n", keyName, n);
+    run<std::unordered_map<Key, int, Hash>>("unordered_map", entries, hits,
+                                            missing, sink);
+    run<flat_hash_map<Key, int, Hash>>("flat_hash_map", entries, hits,
+                                       missing, sink);
+    run<SortedVectorMap<Key>>("sorted vector", entries, hits, missing, sink);
+    run<perfect_hash_map<Key, int, Hash>>("perfect_hash_map", entries, hits,
+                                          missing, sink);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t maxSize = bench::sizeArg(argc, argv, 100000);
+    std::size_t sink = 0;
+
+    for (std::size_t n = 10; n <= maxSize; n *= 10) {
+        benchKey<int, std::hash<int>>("int", n, sink);
+        benchKey<std::string, StringHasher<>>("string", n, sink);
+    }
+
+    return bench::keepAlive(sink);
+}
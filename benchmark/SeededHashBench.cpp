@@ -0,0 +1,83 @@
+// Cost of the keyed SeededHashPolicy compared to the default unseeded hashers,
+// on short strings, integer pairs, and an unordered_map keyed by strings.
+
+#include "Util/SeededHash.h"
+
+#include "BenchUtil.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+template <typename Hash, typename Key>
+double hashKeys(const std::vector<Key>& keys, std::size_t& sink) {
+    Hash hash;
+    return bench::nsPerOp(keys.size(), [&] {
+        std::size_t acc = 0;
+        for (const auto& k : keys)
+            acc += hash(k);
+        return acc;
+    }, sink);
+}
+
+template <typename Hash>
+void mapBench(const char* name, const std::vector<std::string>& keys,
+              std::size_t& sink) {
+    std::unordered_map<std::string, std::size_t, Hash> map;
+    auto insert = bench::nsPerOp(keys.size(), [&] {
+        for (std::size_t i = 0; i < keys.size(); ++i)
+            map.emplace(keys[i], i);
+        return map.size();
+    }, sink);
+    auto lookup = bench::nsPerOp(keys.size(), [&] {
+        std::size_t found = 0;
+        for (const auto& k : keys)
+            found += map.count(k);
+        return found;
+    }, sink);
+    std::printf("%-30s insert %8.2f ns  lookup %8.2f ns\n", name, insert,
+                lookup);
+}
+}
+
+int main(int argc, char** argv) {
+    std::size_t n = bench::sizeArg(argc, argv, 1000000);
+    std::size_t sink = 0;
+
+    std::vector<std::string> shortKeys, longKeys;
+    std::vector<std::pair<int, int>> pairs;
+    for (std::size_t i = 0; i < n; ++i) {
+        shortKeys.push_back("user:" + std::to_string(i * 7919));
+        longKeys.push_back(std::string(100, 'x') + std::to_string(i));
+        pairs.emplace_back(int(i), int(i >> 3));
+    }
+
+    std::printf("%-30s %8.2f ns/key\n", "std::hash<string> (short)",
+                hashKeys<std::hash<std::string>>(shortKeys, sink));
+    std::printf("%-30s %8.2f ns/key\n", "SeededHasher<string> (short)",
+                hashKeys<SeededHasher<std::string>>(shortKeys, sink));
+    std::printf("%-30s %8.2f ns/key\n", "std::hash<string> (108B)",
+                hashKeys<std::hash<std::string>>(longKeys, sink));
+    std::printf("%-30s %8.2f ns/key\n", "SeededHasher<string> (108B)",
+                hashKeys<SeededHasher<std::string>>(longKeys, sink));
+
+    using Pair = std::pair<int, int>;
+    std::printf("%-30s %8.2f ns/key\n", "PairHasher",
+                hashKeys<PairHasher<Pair>>(pairs, sink));
+    std::printf("%-30s %8.2f ns/key\n", "PairHasher<SeededHashPolicy>",
+                hashKeys<PairHasher<Pair, SeededHashPolicy>>(pairs, sink));
+
+    mapBench<std::hash<std::string>>("map<string>, std::hash", shortKeys,
+                                     sink);
+    mapBench<SeededHasher<std::string>>("map<string>, SeededHasher",
+                                        shortKeys, sink);
+
+    return bench::keepAlive(sink);
+}
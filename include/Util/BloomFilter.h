@@ -0,0 +1,294 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+#include <immintrin.h>
+#endif
+
+namespace util {
+
+// Approximate membership: bloom_filter<T, Hash> answers "was v inserted?"
+// with no false negatives and a tunable rate of false positives, in far less
+// memory than a hash set and with a single cache miss per query.
+//
+// Both filters are split block Bloom filters, as in Impala and Parquet: the
+// filter is an array of 256-bit blocks, each made of eight 32-bit lanes. A
+// key picks one block and sets one bit in each of its eight lanes, so a
+// query only touches 32 contiguous bytes. With AVX2, the eight bit positions
+// are computed and tested with a handful of vector instructions.
+//
+// The key is hashed once with Hash, and that hash is widened into two
+// independent words: 64 bits pick the block and 32 bits the eight lane bits.
+// Hash may be any of the util hashers, or std::hash; when it defines
+// is_transparent (e.g. StringHasher<>), insert and contains accept any key
+// type it accepts.
+//
+// counting_bloom_filter has the same layout with a 4-bit counter in place of
+// every bit, so that keys can be erased again. It takes four times the
+// memory for the same false positive rate. Counters stick at 15, so a
+// counter that overflowed is never decremented again.
+//
+// Example:
+//
+//  bloom_filter<std::string, StringHasher<>> seen(expectedUsers, 0.01);
+//  seen.insert(name);
+//  if (!seen.contains(name)) // no need to look in the big set
+//      return false;
+
+namespace bloom_detail {
+
+constexpr std::size_t kLanes = 8;
+constexpr std::size_t kLaneBits = 32;
+
+// Odd multipliers from which each lane derives its bit from the same 32-bit
+// hash, taken from the Parquet specification
+alignas(32) constexpr std::uint32_t kSalt[kLanes] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+// The two words a key hash is widened into
+struct KeyHash {
+    std::uint64_t block;
+    std::uint32_t bits;
+};
+
+inline KeyHash widen(std::size_t h) noexcept {
+    auto w = hash_detail::mum(h ^ hash_detail::kPrime0, hash_detail::kPrime1);
+    return {hash_mix(h ^ hash_detail::kPrime2), static_cast<std::uint32_t>(w)};
+}
+
+// The bit of lane i set for the given hash
+inline std::uint32_t laneBit(std::uint32_t bits, std::size_t i) noexcept {
+    return std::uint32_t(1) << ((bits * kSalt[i]) >> 27);
+}
+
+// The probability that a block holding the given number of keys reports a
+// key it does not hold
+inline double blockFalsePositiveRate(std::size_t keys) noexcept {
+    double laneSet = 1 - std::pow(1 - 1.0 / kLaneBits, double(keys));
+    return std::pow(laneSet, double(kLanes));
+}
+
+// Expected false positive rate with keysPerBlock keys per block on average,
+// the actual loads following a Poisson distribution
+inline double falsePositiveRate(double keysPerBlock) noexcept {
+    if (keysPerBlock <= 0)
+        return 0;
+    double pmf = std::exp(-keysPerBlock), ret = 0;
+    auto last = keysPerBlock + 10 * std::sqrt(keysPerBlock) + 20;
+    for (std::size_t j = 0; j <= last; ++j) {
+        ret += pmf * blockFalsePositiveRate(j);
+        pmf *= keysPerBlock / (j + 1);
+    }
+    return ret;
+}
+
+// The fewest blocks giving at most the target rate for n keys
+inline std::size_t blocksFor(std::size_t n, double rate) {
+    if (!(rate > 0 && rate < 1))
+        throw std::invalid_argument(
+            "bloom_filter: the false positive rate must be in (0, 1)");
+    double lo = 0, hi = 64;
+    for (int i = 0; i < 60; ++i) {
+        auto mid = (lo + hi) / 2;
+        (falsePositiveRate(mid) <= rate ? lo : hi) = mid;
+    }
+    auto blocks = lo > 0 ? std::ceil(n / lo) : double(n);
+    return blocks < 1 ? 1 : static_cast<std::size_t>(blocks);
+}
+
+} // namespace bloom_detail
+
+template <typename T, typename Hash = std::hash<T>>
+class bloom_filter
+{
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, T, Hash>;
+
+    std::vector<std::uint32_t> lanes;
+    std::size_t numBlocks;
+    Hash hash;
+
+    // The offset in lanes of the block of key
+    template <typename K>
+    std::size_t blockOf(const K& key, std::uint32_t& bits) const {
+        auto h = bloom_detail::widen(hash(key));
+        bits = h.bits;
+        return bloom_detail::kLanes * hash_detail::mulHigh(h.block, numBlocks);
+    }
+
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+    static __m256i mask(std::uint32_t bits) noexcept {
+        auto salt = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(bloom_detail::kSalt));
+        auto shifts = _mm256_srli_epi32(
+            _mm256_mullo_epi32(_mm256_set1_epi32(int(bits)), salt), 27);
+        return _mm256_sllv_epi32(_mm256_set1_epi32(1), shifts);
+    }
+#endif
+
+public:
+    using key_type = T;
+    using hasher = Hash;
+
+    // Sized for expectedItems keys at the given false positive rate
+    explicit bloom_filter(std::size_t expectedItems,
+                          double falsePositiveRate = 0.01,
+                          const Hash& hash = Hash())
+        : numBlocks(bloom_detail::blocksFor(expectedItems, falsePositiveRate)),
+          hash(hash) {
+        lanes.assign(numBlocks * bloom_detail::kLanes, 0);
+    }
+
+    template <typename K = T>
+    void insert(const key_arg<K>& key) {
+        std::uint32_t bits;
+        auto block = lanes.data() + blockOf(key, bits);
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+        auto p = reinterpret_cast<__m256i*>(block);
+        _mm256_storeu_si256(p, _mm256_or_si256(_mm256_loadu_si256(p),
+                                               mask(bits)));
+#else
+        for (std::size_t i = 0; i < bloom_detail::kLanes; ++i)
+            block[i] |= bloom_detail::laneBit(bits, i);
+#endif
+    }
+
+    // False if key was never inserted; true if it was, and for a small
+    // fraction of the other keys
+    template <typename K = T>
+    bool contains(const key_arg<K>& key) const {
+        std::uint32_t bits;
+        auto block = lanes.data() + blockOf(key, bits);
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+        auto b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+        return _mm256_testc_si256(b, mask(bits));
+#else
+        for (std::size_t i = 0; i < bloom_detail::kLanes; ++i)
+            if (!(block[i] & bloom_detail::laneBit(bits, i)))
+                return false;
+        return true;
+#endif
+    }
+
+    // Adds the keys of other, which must have the same number of blocks
+    void merge(const bloom_filter& other) {
+        if (other.numBlocks != numBlocks)
+            throw std::invalid_argument(
+                "bloom_filter::merge: the filters have different sizes");
+        for (std::size_t i = 0; i < lanes.size(); ++i)
+            lanes[i] |= other.lanes[i];
+    }
+
+    void clear() noexcept { std::fill(lanes.begin(), lanes.end(), 0); }
+
+    std::size_t block_count() const noexcept { return numBlocks; }
+    std::size_t memory_usage() const noexcept {
+        return lanes.size() * sizeof(std::uint32_t);
+    }
+
+    // The expected false positive rate after inserting n distinct keys
+    double false_positive_rate(std::size_t n) const noexcept {
+        return bloom_detail::falsePositiveRate(double(n) / numBlocks);
+    }
+};
+
+template <typename T, typename Hash = std::hash<T>>
+class counting_bloom_filter
+{
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, T, Hash>;
+
+    // Each lane holds 32 counters of 4 bits, in two 64-bit words
+    static constexpr std::size_t kWordsPerLane = 2;
+    static constexpr std::size_t kWordsPerBlock =
+        bloom_detail::kLanes * kWordsPerLane;
+
+    std::vector<std::uint64_t> counters;
+    std::size_t numBlocks;
+    Hash hash;
+
+    // Calls fn(word, shift) for the counter of every lane the key maps to
+    template <typename K, typename F>
+    void forEachCounter(const K& key, F&& fn) const {
+        auto h = bloom_detail::widen(hash(key));
+        auto block = kWordsPerBlock * hash_detail::mulHigh(h.block, numBlocks);
+        for (std::size_t i = 0; i < bloom_detail::kLanes; ++i) {
+            auto index = (h.bits * bloom_detail::kSalt[i]) >> 27;
+            fn(block + i * kWordsPerLane + index / 16, (index % 16) * 4);
+        }
+    }
+
+    std::uint64_t counter(std::size_t word, unsigned shift) const noexcept {
+        return (counters[word] >> shift) & 0xf;
+    }
+
+public:
+    using key_type = T;
+    using hasher = Hash;
+
+    explicit counting_bloom_filter(std::size_t expectedItems,
+                                   double falsePositiveRate = 0.01,
+                                   const Hash& hash = Hash())
+        : numBlocks(bloom_detail::blocksFor(expectedItems, falsePositiveRate)),
+          hash(hash) {
+        counters.assign(numBlocks * kWordsPerBlock, 0);
+    }
+
+    template <typename K = T>
+    void insert(const key_arg<K>& key) {
+        forEachCounter(key, [this](std::size_t word, unsigned shift) {
+            if (counter(word, shift) != 0xf)
+                counters[word] += std::uint64_t(1) << shift;
+        });
+    }
+
+    template <typename K = T>
+    bool contains(const key_arg<K>& key) const {
+        bool ret = true;
+        forEachCounter(key, [&](std::size_t word, unsigned shift) {
+            ret = ret && counter(word, shift) != 0;
+        });
+        return ret;
+    }
+
+    // Removes one insertion of key. Keys the filter does not contain are
+    // ignored, and false is returned. Only erase keys that were inserted:
+    // erasing a false positive decrements the counters of other keys, which
+    // may then be reported missing.
+    template <typename K = T>
+    bool erase(const key_arg<K>& key) {
+        if (!contains<K>(key))
+            return false;
+        forEachCounter(key, [this](std::size_t word, unsigned shift) {
+            if (counter(word, shift) != 0xf)
+                counters[word] -= std::uint64_t(1) << shift;
+        });
+        return true;
+    }
+
+    void clear() noexcept { std::fill(counters.begin(), counters.end(), 0); }
+
+    std::size_t block_count() const noexcept { return numBlocks; }
+    std::size_t memory_usage() const noexcept {
+        return counters.size() * sizeof(std::uint64_t);
+    }
+
+    double false_positive_rate(std::size_t n) const noexcept {
+        return bloom_detail::falsePositiveRate(double(n) / numBlocks);
+    }
+};
+
+} // namespace util
@@ -0,0 +1,270 @@
+#pragma once
+
+#include "Util/FlatHashMap.h"
+#include "Util/Hashing.h"
+#include "Util/Optional.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// concurrent_hash_map<K, V, Hash, Eq> is a hash map that any number of
+// threads may read and write at the same time. It is split into a power of
+// two number of shards, each a flat_hash_map behind its own reader-writer
+// lock:
+//  - the key is hashed once, outside of any lock, and the high bits of the
+//    mixed hash pick the shard
+//  - find, contains and for_each take the shard lock shared, so readers only
+//    wait for writers to the same shard
+//  - insert_or_assign, modify and erase take it exclusively
+// With the default 64 shards, threads working on different keys rarely wait
+// for each other, where a single map behind one mutex serializes them all.
+//
+// Elements can't be reached by reference, since another thread could erase
+// them at any time: find returns a copy of the value, and modify runs a
+// function on it under the shard lock, for updates that must be atomic.
+//
+// As in flat_hash_map, find, contains, modify and erase accept any key type
+// Hash and Eq accept when both define is_transparent.
+//
+// Example:
+//
+//  using Edge = std::pair<int, int>;
+//  concurrent_hash_map<Edge, double, PairHasher<Edge>> weights;
+//  // in any thread:
+//  weights.insert_or_assign({1, 2}, 0.5);
+//  weights.modify(Edge{1, 2}, [](double& w) { w *= 2; });
+//  if (auto w = weights.find(Edge{1, 2}))
+//      use(*w);
+
+namespace concurrent_hash_detail {
+
+// A key to look up, along with its hash
+template <typename K>
+struct Probe {
+    const K& key;
+    std::size_t hash;
+};
+
+// The hasher of the shards. Lookups go through a Probe, and insertions
+// through flat_hash_map::try_emplace_with_hash, reusing the hash the shard
+// was picked with; only rehashing the shard calls Hash again.
+template <typename Hash>
+struct ShardHash {
+    using is_transparent = void;
+
+    Hash hash;
+
+    template <typename K>
+    std::size_t operator()(const K& key) const {
+        return hash(key);
+    }
+    template <typename K>
+    std::size_t operator()(const Probe<K>& p) const noexcept {
+        return p.hash;
+    }
+};
+
+template <typename Eq>
+struct ShardEq {
+    using is_transparent = void;
+
+    Eq eq;
+
+    template <typename A, typename B>
+    bool operator()(const A& a, const B& b) const {
+        return eq(a, b);
+    }
+    template <typename A, typename K>
+    bool operator()(const A& a, const Probe<K>& p) const {
+        return eq(a, p.key);
+    }
+};
+
+} // namespace concurrent_hash_detail
+
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Eq = std::equal_to<K>>
+class concurrent_hash_map
+{
+public:
+    using key_type = K;
+    using mapped_type = V;
+    using value_type = std::pair<const K, V>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+
+private:
+    template <typename Q>
+    using key_arg = hash_detail::key_arg_t<Q, K, Hash, Eq>;
+
+    template <typename Q>
+    using ProbeFor = concurrent_hash_detail::Probe<key_arg<Q>>;
+
+    using ShardMap =
+        flat_hash_map<K, V, concurrent_hash_detail::ShardHash<Hash>,
+                      concurrent_hash_detail::ShardEq<Eq>>;
+
+    struct Shard {
+        std::shared_timed_mutex mutex;
+        ShardMap map;
+        // Keeps the locks of neighbouring shards off each other's cache line
+        char padding[64];
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    unsigned shardBits;
+    Hash hash;
+
+    using SharedLock = std::shared_lock<std::shared_timed_mutex>;
+    using UniqueLock = std::unique_lock<std::shared_timed_mutex>;
+
+    Shard& shardOf(std::size_t h) const {
+        auto i = shardBits == 0 ? 0 : hash_mix(h) >> (64 - shardBits);
+        return shards[static_cast<std::size_t>(i)];
+    }
+
+    template <typename Key, typename M>
+    bool insertOrAssign(Key&& key, M&& obj) {
+        auto h = static_cast<std::size_t>(hash(key));
+        auto& shard = shardOf(h);
+        UniqueLock lock(shard.mutex);
+        // obj is only moved from if the key is inserted
+        auto res = shard.map.try_emplace_with_hash(h, std::forward<Key>(key),
+                                                   std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res.second;
+    }
+
+public:
+    // The number of shards is rounded up to a power of two
+    explicit concurrent_hash_map(std::size_t numShards = 64,
+                                 const Hash& hash = Hash(),
+                                 const Eq& eq = Eq())
+        : shardBits(0), hash(hash) {
+        while ((std::size_t(1) << shardBits) < numShards && shardBits < 16)
+            ++shardBits;
+        shards.reset(new Shard[std::size_t(1) << shardBits]);
+        for (std::size_t i = 0; i < shard_count(); ++i)
+            shards[i].map = ShardMap(0, {hash}, {eq});
+    }
+
+    concurrent_hash_map(const concurrent_hash_map&) = delete;
+    concurrent_hash_map& operator=(const concurrent_hash_map&) = delete;
+
+    // Inserts key or assigns obj to its value. Returns true if the key was
+    // inserted.
+    template <typename M>
+    bool insert_or_assign(const K& key, M&& obj) {
+        return insertOrAssign(key, std::forward<M>(obj));
+    }
+
+    template <typename M>
+    bool insert_or_assign(K&& key, M&& obj) {
+        return insertOrAssign(std::move(key), std::forward<M>(obj));
+    }
+
+    // A copy of the value of key, if present
+    template <typename Q = K>
+    optional<V> find(const key_arg<Q>& key) const {
+        auto h = static_cast<std::size_t>(hash(key));
+        auto& shard = shardOf(h);
+        SharedLock lock(shard.mutex);
+        auto it = shard.map.template find<ProbeFor<Q>>(ProbeFor<Q>{key, h});
+        if (it == shard.map.end())
+            return nullopt;
+        return it->second;
+    }
+
+    template <typename Q = K>
+    bool contains(const key_arg<Q>& key) const {
+        auto h = static_cast<std::size_t>(hash(key));
+        auto& shard = shardOf(h);
+        SharedLock lock(shard.mutex);
+        return shard.map.template contains<ProbeFor<Q>>(ProbeFor<Q>{key, h});
+    }
+
+    // Calls fn(value) under the shard lock, if key is present. Returns
+    // whether it was.
+    template <typename Q = K, typename F>
+    bool modify(const key_arg<Q>& key, F&& fn) {
+        auto h = static_cast<std::size_t>(hash(key));
+        auto& shard = shardOf(h);
+        UniqueLock lock(shard.mutex);
+        auto it = shard.map.template find<ProbeFor<Q>>(ProbeFor<Q>{key, h});
+        if (it == shard.map.end())
+            return false;
+        std::forward<F>(fn)(it->second);
+        return true;
+    }
+
+    template <typename Q = K>
+    size_type erase(const key_arg<Q>& key) {
+        auto h = static_cast<std::size_t>(hash(key));
+        auto& shard = shardOf(h);
+        UniqueLock lock(shard.mutex);
+        return shard.map.template erase<ProbeFor<Q>>(ProbeFor<Q>{key, h});
+    }
+
+    // Calls fn(key, value) for every element, one shard at a time, with the
+    // shard locked shared: each shard is seen in a consistent state, but
+    // elements inserted or erased meanwhile in the other shards may or may
+    // not be seen. fn must not write to the map.
+    template <typename F>
+    void for_each(F&& fn) const {
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            SharedLock lock(shards[i].mutex);
+            for (const auto& kv : shards[i].map)
+                fn(kv.first, kv.second);
+        }
+    }
+
+    // Makes room for n elements in total, so that inserting them never
+    // rehashes a shard while holding its lock
+    void reserve(size_type n) {
+        // Leave room for the shards that get more than their share
+        auto perShard = n / shard_count();
+        perShard += perShard / 8 + 16;
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            UniqueLock lock(shards[i].mutex);
+            shards[i].map.reserve(perShard);
+        }
+    }
+
+    void clear() {
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            UniqueLock lock(shards[i].mutex);
+            shards[i].map.clear();
+        }
+    }
+
+    // The number of elements. Exact only when no other thread is writing at
+    // the same time.
+    size_type size() const {
+        size_type ret = 0;
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            SharedLock lock(shards[i].mutex);
+            ret += shards[i].map.size();
+        }
+        return ret;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    size_type shard_count() const noexcept {
+        return std::size_t(1) << shardBits;
+    }
+
+    hasher hash_function() const { return hash; }
+};
+
+} // namespace util
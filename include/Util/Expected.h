@@ -0,0 +1,561 @@
+#pragma once
+
+#include "Util/Optional.h"
+#include "Util/in_place.h"
+
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// expected<T, E> holds either a value of type T or an error of type E. It is
+// meant for code paths where failures are common enough that throwing (and
+// unwinding) on every one of them is too expensive, e.g. parsers fed with
+// untrusted input. Errors are carried by value and never allocate.
+//
+// The storage follows optional<T>: a tagged union that is trivially
+// destructible whenever both T and E are, and trivially copyable whenever both
+// T and E are, in which case copies are plain memcpys and small expected
+// objects are returned in registers.
+template <class T, class E>
+class expected;
+
+// Wrapper that marks a value as an error when constructing an expected
+template <class E>
+class unexpected {
+    static_assert(!std::is_reference<E>::value, "bad E");
+    static_assert(!std::is_same<typename std::decay<E>::type, void>::value,
+                  "bad E");
+
+    E err_;
+
+public:
+    constexpr explicit unexpected(const E& e) : err_(e) {}
+    constexpr explicit unexpected(E&& e) : err_(constexpr_move(e)) {}
+
+    constexpr const E& error() const& { return err_; }
+    OPTIONAL_MUTABLE_CONSTEXPR E& error() & { return err_; }
+    OPTIONAL_MUTABLE_CONSTEXPR E&& error() && { return constexpr_move(err_); }
+};
+
+template <class E>
+constexpr unexpected<typename std::decay<E>::type> make_unexpected(E&& e) {
+    return unexpected<typename std::decay<E>::type>(constexpr_forward<E>(e));
+}
+
+template <class E>
+constexpr bool operator==(const unexpected<E>& x, const unexpected<E>& y) {
+    return x.error() == y.error();
+}
+
+template <class E>
+constexpr bool operator!=(const unexpected<E>& x, const unexpected<E>& y) {
+    return !(x == y);
+}
+
+// Tag for constructing the error in place
+constexpr struct unexpect_t {
+} unexpect{};
+
+// Thrown by expected::value() when there is no value. Checking has_value()
+// first (or using value_or) keeps error handling off the exception path.
+template <class E>
+class bad_expected_access : public std::logic_error {
+    E err_;
+
+public:
+    explicit bad_expected_access(E e)
+        : logic_error{"bad expected access"}, err_(std::move(e)) {}
+
+    const E& error() const { return err_; }
+};
+
+namespace detail_ {
+
+template <class T, class E>
+union expected_storage_t {
+    unsigned char dummy_;
+    T value_;
+    E error_;
+
+    constexpr expected_storage_t(trivial_init_t) noexcept : dummy_(){};
+
+    template <class... Args>
+    constexpr expected_storage_t(in_place_t, Args&&... args)
+        : value_(constexpr_forward<Args>(args)...) {}
+
+    template <class... Args>
+    constexpr expected_storage_t(unexpect_t, Args&&... args)
+        : error_(constexpr_forward<Args>(args)...) {}
+
+    ~expected_storage_t() {}
+};
+
+template <class T, class E>
+union constexpr_expected_storage_t {
+    unsigned char dummy_;
+    T value_;
+    E error_;
+
+    constexpr constexpr_expected_storage_t(trivial_init_t) noexcept
+        : dummy_(){};
+
+    template <class... Args>
+    constexpr constexpr_expected_storage_t(in_place_t, Args&&... args)
+        : value_(constexpr_forward<Args>(args)...) {}
+
+    template <class... Args>
+    constexpr constexpr_expected_storage_t(unexpect_t, Args&&... args)
+        : error_(constexpr_forward<Args>(args)...) {}
+
+    ~constexpr_expected_storage_t() = default;
+};
+
+template <class T, class E>
+struct expected_base {
+    bool has_;
+    expected_storage_t<T, E> storage_;
+
+    explicit constexpr expected_base(trivial_init_t) noexcept
+        : has_(false), storage_(trivial_init) {}
+
+    template <class... Args>
+    explicit constexpr expected_base(in_place_t, Args&&... args)
+        : has_(true), storage_(in_place, constexpr_forward<Args>(args)...) {}
+
+    template <class... Args>
+    explicit constexpr expected_base(unexpect_t, Args&&... args)
+        : has_(false), storage_(unexpect, constexpr_forward<Args>(args)...) {}
+
+    ~expected_base() { destroy(); }
+
+    template <class... Args>
+    void construct_value(Args&&... args) {
+        ::new (static_cast<void*>(std::addressof(storage_.value_)))
+            T(std::forward<Args>(args)...);
+        has_ = true;
+    }
+
+    template <class... Args>
+    void construct_error(Args&&... args) {
+        ::new (static_cast<void*>(std::addressof(storage_.error_)))
+            E(std::forward<Args>(args)...);
+        has_ = false;
+    }
+
+    void destroy() noexcept {
+        if (has_)
+            storage_.value_.T::~T();
+        else
+            storage_.error_.E::~E();
+    }
+};
+
+template <class T, class E>
+struct constexpr_expected_base {
+    bool has_;
+    constexpr_expected_storage_t<T, E> storage_;
+
+    explicit constexpr constexpr_expected_base(trivial_init_t) noexcept
+        : has_(false), storage_(trivial_init) {}
+
+    template <class... Args>
+    explicit constexpr constexpr_expected_base(in_place_t, Args&&... args)
+        : has_(true), storage_(in_place, constexpr_forward<Args>(args)...) {}
+
+    template <class... Args>
+    explicit constexpr constexpr_expected_base(unexpect_t, Args&&... args)
+        : has_(false), storage_(unexpect, constexpr_forward<Args>(args)...) {}
+
+    ~constexpr_expected_base() = default;
+
+    template <class... Args>
+    void construct_value(Args&&... args) {
+        ::new (static_cast<void*>(std::addressof(storage_.value_)))
+            T(std::forward<Args>(args)...);
+        has_ = true;
+    }
+
+    template <class... Args>
+    void construct_error(Args&&... args) {
+        ::new (static_cast<void*>(std::addressof(storage_.error_)))
+            E(std::forward<Args>(args)...);
+        has_ = false;
+    }
+
+    // Both alternatives are trivially destructible
+    void destroy() noexcept {}
+};
+
+template <class T, class E>
+using ExpectedStorageBase = typename std::conditional<
+    std::is_trivially_destructible<T>::value &&
+        std::is_trivially_destructible<E>::value,
+    constexpr_expected_base<T, E>, expected_base<T, E>>::type;
+
+// Replaces oldval, which is alive, with a New built from args, in the same
+// storage. As in std::expected, this never leaves the storage empty: if
+// building the new alternative may throw, it is built in a temporary before
+// the old one is destroyed, or else the old one is moved aside and restored
+// on failure. A restore that throws as well terminates.
+template <class New, class Old, class... Args>
+void reinit(std::true_type /* nothrow */, New& newval, Old& oldval,
+            Args&&... args) {
+    oldval.~Old();
+    ::new (static_cast<void*>(std::addressof(newval)))
+        New(std::forward<Args>(args)...);
+}
+
+template <class T>
+void restore(T& dst, T& saved) noexcept {
+    ::new (static_cast<void*>(std::addressof(dst))) T(std::move(saved));
+}
+
+template <class New, class Old, class... Args>
+void reinitViaTemporary(std::true_type /* nothrow move */, New& newval,
+                        Old& oldval, Args&&... args) {
+    New tmp(std::forward<Args>(args)...);
+    reinit(std::true_type{}, newval, oldval, std::move(tmp));
+}
+
+template <class New, class Old, class... Args>
+void reinitViaTemporary(std::false_type, New& newval, Old& oldval,
+                        Args&&... args) {
+    Old saved(std::move(oldval));
+    oldval.~Old();
+    try {
+        ::new (static_cast<void*>(std::addressof(newval)))
+            New(std::forward<Args>(args)...);
+    } catch (...) {
+        restore(oldval, saved);
+        throw;
+    }
+}
+
+template <class New, class Old, class... Args>
+void reinit(std::false_type, New& newval, Old& oldval, Args&&... args) {
+    reinitViaTemporary(std::is_nothrow_move_constructible<New>{}, newval,
+                       oldval, std::forward<Args>(args)...);
+}
+
+template <class New, class Old, class... Args>
+void reinit(New& newval, Old& oldval, Args&&... args) {
+    reinit(std::integral_constant<
+               bool, std::is_nothrow_constructible<New, Args...>::value>{},
+           newval, oldval, std::forward<Args>(args)...);
+}
+
+// When both alternatives are trivially copyable, the defaulted copy and move
+// operations are trivial and boil down to copying the bytes of the union
+template <class T, class E,
+          bool = std::is_trivially_copyable<T>::value &&
+                 std::is_trivially_copyable<E>::value>
+struct expected_copy_base : ExpectedStorageBase<T, E> {
+    using ExpectedStorageBase<T, E>::ExpectedStorageBase;
+};
+
+template <class T, class E>
+struct expected_copy_base<T, E, false> : ExpectedStorageBase<T, E> {
+    using ExpectedStorageBase<T, E>::ExpectedStorageBase;
+
+    expected_copy_base(const expected_copy_base& rhs)
+        : ExpectedStorageBase<T, E>(trivial_init) {
+        if (rhs.has_)
+            this->construct_value(rhs.storage_.value_);
+        else
+            this->construct_error(rhs.storage_.error_);
+    }
+
+    expected_copy_base(expected_copy_base&& rhs) noexcept(
+        std::is_nothrow_move_constructible<T>::value&&
+            std::is_nothrow_move_constructible<E>::value)
+        : ExpectedStorageBase<T, E>(trivial_init) {
+        if (rhs.has_)
+            this->construct_value(std::move(rhs.storage_.value_));
+        else
+            this->construct_error(std::move(rhs.storage_.error_));
+    }
+
+    expected_copy_base& operator=(const expected_copy_base& rhs) {
+        assign(rhs);
+        return *this;
+    }
+
+    expected_copy_base& operator=(expected_copy_base&& rhs) noexcept(
+        std::is_nothrow_move_constructible<T>::value&&
+            std::is_nothrow_move_assignable<T>::value&&
+                std::is_nothrow_move_constructible<E>::value&&
+                    std::is_nothrow_move_assignable<E>::value) {
+        assign(std::move(rhs));
+        return *this;
+    }
+
+private:
+    // When the alternatives differ, a throwing copy or move leaves *this
+    // unchanged (see reinit); otherwise this is the assignment of the
+    // alternative, with whatever guarantee it gives
+    template <class Other>
+    void assign(Other&& rhs) {
+        if (this->has_ && rhs.has_)
+            this->storage_.value_ =
+                std::forward<Other>(rhs).storage_.value_;
+        else if (!this->has_ && !rhs.has_)
+            this->storage_.error_ =
+                std::forward<Other>(rhs).storage_.error_;
+        else if (rhs.has_) {
+            reinit(this->storage_.value_, this->storage_.error_,
+                   std::forward<Other>(rhs).storage_.value_);
+            this->has_ = true;
+        } else {
+            reinit(this->storage_.error_, this->storage_.value_,
+                   std::forward<Other>(rhs).storage_.error_);
+            this->has_ = false;
+        }
+    }
+};
+
+} // namespace detail_
+
+template <class T, class E>
+class expected : private detail_::expected_copy_base<T, E> {
+    static_assert(!std::is_reference<T>::value, "bad T");
+    static_assert(!std::is_reference<E>::value, "bad E");
+    static_assert(!std::is_same<typename std::decay<T>::type, in_place_t>::value,
+                  "bad T");
+    static_assert(!std::is_same<typename std::decay<T>::type, unexpect_t>::value,
+                  "bad T");
+
+    using base = detail_::expected_copy_base<T, E>;
+
+    constexpr const T& contained_val() const { return base::storage_.value_; }
+    T& contained_val() { return base::storage_.value_; }
+    constexpr const E& contained_err() const { return base::storage_.error_; }
+    E& contained_err() { return base::storage_.error_; }
+
+public:
+    typedef T value_type;
+    typedef E error_type;
+    typedef unexpected<E> unexpected_type;
+
+    // constructors
+    constexpr expected() : base(in_place) {}
+
+    constexpr expected(const T& v) : base(in_place, v) {}
+
+    constexpr expected(T&& v) : base(in_place, constexpr_move(v)) {}
+
+    template <class... Args>
+    explicit constexpr expected(in_place_t, Args&&... args)
+        : base(in_place, constexpr_forward<Args>(args)...) {}
+
+    template <class U, class... Args>
+    explicit constexpr expected(in_place_t, std::initializer_list<U> il,
+                                Args&&... args)
+        : base(in_place, il, constexpr_forward<Args>(args)...) {}
+
+    constexpr expected(const unexpected<E>& e) : base(unexpect, e.error()) {}
+
+    constexpr expected(unexpected<E>&& e)
+        : base(unexpect, constexpr_move(e.error())) {}
+
+    template <class... Args>
+    explicit constexpr expected(unexpect_t, Args&&... args)
+        : base(unexpect, constexpr_forward<Args>(args)...) {}
+
+    expected(const expected&) = default;
+    expected(expected&&) = default;
+    ~expected() = default;
+
+    // assignment
+    expected& operator=(const expected&) = default;
+    expected& operator=(expected&&) = default;
+
+    template <class U>
+    auto operator=(U&& v) -> typename std::enable_if<
+        std::is_same<typename std::decay<U>::type, T>::value, expected&>::type {
+        if (has_value()) {
+            contained_val() = std::forward<U>(v);
+        } else {
+            detail_::reinit(contained_val(), contained_err(),
+                            std::forward<U>(v));
+            base::has_ = true;
+        }
+        return *this;
+    }
+
+    expected& operator=(const unexpected<E>& e) {
+        if (!has_value()) {
+            contained_err() = e.error();
+        } else {
+            detail_::reinit(contained_err(), contained_val(), e.error());
+            base::has_ = false;
+        }
+        return *this;
+    }
+
+    expected& operator=(unexpected<E>&& e) {
+        if (!has_value()) {
+            contained_err() = std::move(e.error());
+        } else {
+            detail_::reinit(contained_err(), contained_val(),
+                            std::move(e.error()));
+            base::has_ = false;
+        }
+        return *this;
+    }
+
+    // If constructing the value throws, the previous value or error is kept
+    template <class... Args>
+    void emplace(Args&&... args) {
+        if (has_value())
+            detail_::reinit(contained_val(), contained_val(),
+                            std::forward<Args>(args)...);
+        else
+            detail_::reinit(contained_val(), contained_err(),
+                            std::forward<Args>(args)...);
+        base::has_ = true;
+    }
+
+    // observers
+    constexpr bool has_value() const noexcept { return base::has_; }
+
+    explicit constexpr operator bool() const noexcept { return has_value(); }
+
+    // The unchecked accessors below only assert; they are what hot paths
+    // should use after testing has_value()
+    constexpr const T* operator->() const {
+        return (assert(has_value()), &contained_val());
+    }
+
+    T* operator->() {
+        assert(has_value());
+        return std::addressof(contained_val());
+    }
+
+    constexpr const T& operator*() const& {
+        return (assert(has_value()), contained_val());
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR T& operator*() & {
+        assert(has_value());
+        return contained_val();
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR T&& operator*() && {
+        assert(has_value());
+        return constexpr_move(contained_val());
+    }
+
+    constexpr const E& error() const& {
+        return (assert(!has_value()), contained_err());
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR E& error() & {
+        assert(!has_value());
+        return contained_err();
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR E&& error() && {
+        assert(!has_value());
+        return constexpr_move(contained_err());
+    }
+
+    constexpr const T& value() const& {
+        return has_value()
+                   ? contained_val()
+                   : (throw bad_expected_access<E>(contained_err()),
+                      contained_val());
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR T& value() & {
+        if (!has_value())
+            throw bad_expected_access<E>(contained_err());
+        return contained_val();
+    }
+
+    OPTIONAL_MUTABLE_CONSTEXPR T&& value() && {
+        if (!has_value())
+            throw bad_expected_access<E>(contained_err());
+        return constexpr_move(contained_val());
+    }
+
+    template <class V>
+    constexpr T value_or(V&& v) const& {
+        return has_value() ? contained_val()
+                           : detail_::convert<T>(constexpr_forward<V>(v));
+    }
+
+    template <class V>
+    OPTIONAL_MUTABLE_CONSTEXPR T value_or(V&& v) && {
+        return has_value() ? constexpr_move(contained_val())
+                           : detail_::convert<T>(constexpr_forward<V>(v));
+    }
+
+    // Drops the error, if any
+    optional<T> to_optional() const& {
+        return has_value() ? optional<T>(contained_val()) : optional<T>();
+    }
+
+    optional<T> to_optional() && {
+        return has_value() ? optional<T>(std::move(contained_val()))
+                           : optional<T>();
+    }
+};
+
+// Relational operators
+template <class T, class E>
+constexpr bool operator==(const expected<T, E>& x, const expected<T, E>& y) {
+    return x.has_value() != y.has_value()
+               ? false
+               : x.has_value() ? *x == *y : x.error() == y.error();
+}
+
+template <class T, class E>
+constexpr bool operator!=(const expected<T, E>& x, const expected<T, E>& y) {
+    return !(x == y);
+}
+
+template <class T, class E>
+constexpr bool operator==(const expected<T, E>& x, const T& v) {
+    return x.has_value() ? *x == v : false;
+}
+
+template <class T, class E>
+constexpr bool operator==(const T& v, const expected<T, E>& x) {
+    return x == v;
+}
+
+template <class T, class E>
+constexpr bool operator!=(const expected<T, E>& x, const T& v) {
+    return !(x == v);
+}
+
+template <class T, class E>
+constexpr bool operator!=(const T& v, const expected<T, E>& x) {
+    return !(x == v);
+}
+
+template <class T, class E>
+constexpr bool operator==(const expected<T, E>& x, const unexpected<E>& e) {
+    return x.has_value() ? false : x.error() == e.error();
+}
+
+template <class T, class E>
+constexpr bool operator==(const unexpected<E>& e, const expected<T, E>& x) {
+    return x == e;
+}
+
+template <class T, class E>
+constexpr bool operator!=(const expected<T, E>& x, const unexpected<E>& e) {
+    return !(x == e);
+}
+
+template <class T, class E>
+constexpr bool operator!=(const unexpected<E>& e, const expected<T, E>& x) {
+    return !(x == e);
+}
+
+} // namespace util
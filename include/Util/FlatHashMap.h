@@ -0,0 +1,884 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <new>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+#include <emmintrin.h>
+#endif
+
+namespace util {
+
+// flat_hash_map<K, V, Hash, Eq> and flat_hash_set<T, Hash, Eq> are open
+// addressing hash tables in the style of Abseil's Swiss tables. The elements
+// live directly in one array, next to an array of one-byte control words:
+//  - kEmpty and kDeleted mark free slots
+//  - a full slot stores the low 7 bits of its element's hash (H2)
+// A lookup starts at the slot picked by the remaining bits of the hash (H1)
+// and examines 16 control bytes at a time: with SSE2 a single compare finds
+// every slot of the group whose H2 matches, and the element itself is only
+// compared for those. The search stops at the first group holding an empty
+// slot, and the table grows at a load factor of 7/8.
+//
+// Erasing an element whose neighbourhood still holds an empty slot frees the
+// slot outright, since no probe can have walked past it. Only the remaining
+// ones leave a kDeleted tombstone, and when tombstones use up the free slots
+// the table is rehashed in place rather than grown.
+//
+// Differences with std::unordered_map:
+//  - inserting may move the elements, so rehashing invalidates pointers and
+//    references, not just iterators
+//  - the hash returned by Hash is mixed again by the table, so std::hash's
+//    identity hash for integers is fine here
+//  - when both Hash and Eq define is_transparent (e.g. StringHasher<> and
+//    std::equal_to<>), find, count, contains, at and erase accept any key
+//    type the two of them accept
+//
+// Example:
+//
+//  flat_hash_map<std::pair<int, int>, double, PairHasher<std::pair<int, int>>>
+//      weights;
+//  weights[{1, 2}] = 0.5;
+//
+//  flat_hash_set<std::string, StringHasher<>, std::equal_to<>> names;
+//  names.insert("abc");
+//  assert(names.contains("abc"));
+
+namespace flat_hash_detail {
+
+using ctrl_t = signed char;
+
+constexpr ctrl_t kEmpty = -128;
+constexpr ctrl_t kDeleted = -2;
+constexpr ctrl_t kSentinel = -1;
+
+constexpr std::size_t kGroupWidth = 16;
+constexpr std::size_t kMinCapacity = kGroupWidth;
+
+inline bool isFull(ctrl_t c) noexcept { return c >= 0; }
+
+inline unsigned trailingZeros(std::uint32_t x) noexcept {
+#if defined __GNUC__
+    return static_cast<unsigned>(__builtin_ctz(x));
+#else
+    unsigned ret = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+// The positions within a group that match some criterion, bit i standing for
+// the i-th slot of the group
+class BitMask {
+private:
+    std::uint32_t mask;
+
+public:
+    explicit BitMask(std::uint32_t m) noexcept : mask(m) {}
+
+    explicit operator bool() const noexcept { return mask != 0; }
+
+    unsigned lowest() const noexcept { return trailingZeros(mask); }
+
+    BitMask& operator++() noexcept {
+        mask &= mask - 1;
+        return *this;
+    }
+
+    // Number of non-matching positions before the first match, counting from
+    // the start and from the end of the group respectively
+    unsigned leadingMisses() const noexcept {
+        return mask ? trailingZeros(mask) : kGroupWidth;
+    }
+
+    unsigned trailingMisses() const noexcept {
+        unsigned ret = 0;
+        for (auto bit = 1u << (kGroupWidth - 1); bit && !(mask & bit);
+             bit >>= 1)
+            ++ret;
+        return ret;
+    }
+};
+
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+class Group {
+private:
+    __m128i ctrl;
+
+public:
+    explicit Group(const ctrl_t* p) noexcept
+        : ctrl(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p))) {}
+
+    BitMask match(ctrl_t h2) const noexcept {
+        return BitMask(static_cast<std::uint32_t>(
+            _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8(h2), ctrl))));
+    }
+
+    BitMask matchEmpty() const noexcept { return match(kEmpty); }
+
+    BitMask matchEmptyOrDeleted() const noexcept {
+        return BitMask(static_cast<std::uint32_t>(_mm_movemask_epi8(
+            _mm_cmpgt_epi8(_mm_set1_epi8(kSentinel), ctrl))));
+    }
+};
+#else
+class Group {
+private:
+    ctrl_t ctrl[kGroupWidth];
+
+    template <typename F>
+    BitMask matchIf(F&& pred) const noexcept {
+        std::uint32_t mask = 0;
+        for (std::size_t i = 0; i < kGroupWidth; ++i)
+            mask |= std::uint32_t(pred(ctrl[i])) << i;
+        return BitMask(mask);
+    }
+
+public:
+    explicit Group(const ctrl_t* p) noexcept {
+        std::memcpy(ctrl, p, kGroupWidth);
+    }
+
+    BitMask match(ctrl_t h2) const noexcept {
+        return matchIf([h2](ctrl_t c) { return c == h2; });
+    }
+
+    BitMask matchEmpty() const noexcept { return match(kEmpty); }
+
+    BitMask matchEmptyOrDeleted() const noexcept {
+        return matchIf([](ctrl_t c) { return c < kSentinel; });
+    }
+};
+#endif
+
+// Largest number of elements a table of the given capacity holds
+constexpr std::size_t growthFor(std::size_t capacity) {
+    return capacity - capacity / 8;
+}
+
+// Smallest power-of-two capacity able to hold n elements
+inline std::size_t capacityFor(std::size_t n) {
+    std::size_t capacity = kMinCapacity;
+    while (growthFor(capacity) < n)
+        capacity *= 2;
+    return capacity;
+}
+
+template <typename T>
+struct set_policy {
+    using key_type = T;
+    using value_type = T;
+
+    static const key_type& key(const value_type& v) noexcept { return v; }
+
+    static void transfer(value_type* dst, value_type* src) {
+        ::new (static_cast<void*>(dst)) value_type(std::move(*src));
+        src->~value_type();
+    }
+};
+
+template <typename K, typename V>
+struct map_policy {
+    using key_type = K;
+    using value_type = std::pair<const K, V>;
+
+    static const key_type& key(const value_type& v) noexcept {
+        return v.first;
+    }
+
+    // Moves the key out of the const pair member as well: the source is
+    // destroyed right away and its key is never looked at again
+    static void transfer(value_type* dst, value_type* src) {
+        ::new (static_cast<void*>(dst))
+            value_type(std::piecewise_construct,
+                       std::forward_as_tuple(
+                           std::move(const_cast<K&>(src->first))),
+                       std::forward_as_tuple(std::move(src->second)));
+        src->~value_type();
+    }
+};
+
+template <typename Policy, typename Hash, typename Eq>
+class raw_hash_set {
+public:
+    using key_type = typename Policy::key_type;
+    using value_type = typename Policy::value_type;
+    using size_type = std::size_t;
+    using difference_type = std::ptrdiff_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using reference = value_type&;
+    using const_reference = const value_type&;
+    using pointer = value_type*;
+    using const_pointer = const value_type*;
+
+    static_assert(alignof(value_type) <= alignof(std::max_align_t),
+                  "over-aligned elements are not supported");
+
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, key_type, Hash, Eq>;
+
+    template <bool IsConst>
+    class iterator_base {
+    private:
+        friend class raw_hash_set;
+
+        using slot_pointer = typename std::conditional<
+            IsConst, const typename raw_hash_set::value_type*,
+            typename raw_hash_set::value_type*>::type;
+
+        const ctrl_t* ctrl = nullptr;
+        const ctrl_t* end = nullptr;
+        slot_pointer slot = nullptr;
+
+        iterator_base(const ctrl_t* c, const ctrl_t* e, slot_pointer s)
+            : ctrl(c), end(e), slot(s) {}
+
+        void skipFree() {
+            while (ctrl != end && !isFull(*ctrl)) {
+                ++ctrl;
+                ++slot;
+            }
+        }
+
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = typename raw_hash_set::value_type;
+        using difference_type = std::ptrdiff_t;
+        using reference =
+            typename std::conditional<IsConst, const value_type&,
+                                      value_type&>::type;
+        using pointer = slot_pointer;
+
+        iterator_base() = default;
+
+        template <bool C = IsConst, typename = std::enable_if_t<C>>
+        iterator_base(const iterator_base<false>& other)
+            : ctrl(other.ctrl), end(other.end), slot(other.slot) {}
+
+        reference operator*() const { return *slot; }
+        pointer operator->() const { return slot; }
+
+        iterator_base& operator++() {
+            ++ctrl;
+            ++slot;
+            skipFree();
+            return *this;
+        }
+
+        iterator_base operator++(int) {
+            auto ret = *this;
+            ++*this;
+            return ret;
+        }
+
+        friend bool operator==(const iterator_base& lhs,
+                               const iterator_base& rhs) {
+            return lhs.ctrl == rhs.ctrl;
+        }
+
+        friend bool operator!=(const iterator_base& lhs,
+                               const iterator_base& rhs) {
+            return lhs.ctrl != rhs.ctrl;
+        }
+    };
+
+public:
+    using iterator = iterator_base<false>;
+    using const_iterator = iterator_base<true>;
+
+private:
+    static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+    ctrl_t* ctrl_ = nullptr;
+    value_type* slots_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t capacity_ = 0;
+    std::size_t growthLeft_ = 0;
+    Hash hash_;
+    Eq eq_;
+
+    template <typename K>
+    std::uint64_t hashOf(const K& key) const {
+        return mixHash(hash_(key));
+    }
+
+    static std::size_t h1(std::uint64_t hash) noexcept {
+        return static_cast<std::size_t>(hash >> 7);
+    }
+
+    static ctrl_t h2(std::uint64_t hash) noexcept {
+        return static_cast<ctrl_t>(hash & 0x7f);
+    }
+
+    static std::size_t slotOffset(std::size_t capacity) noexcept {
+        auto align = alignof(value_type);
+        return (capacity + kGroupWidth + align - 1) / align * align;
+    }
+
+    // The first kGroupWidth control bytes are mirrored after the last one,
+    // so that a group starting near the end of the table reads the start of
+    // the table without wrapping around
+    void setCtrl(std::size_t i, ctrl_t c) noexcept {
+        ctrl_[i] = c;
+        if (i < kGroupWidth)
+            ctrl_[capacity_ + i] = c;
+    }
+
+    void allocate(std::size_t capacity) {
+        auto mem = static_cast<unsigned char*>(::operator new(
+            slotOffset(capacity) + capacity * sizeof(value_type)));
+        ctrl_ = reinterpret_cast<ctrl_t*>(mem);
+        slots_ = reinterpret_cast<value_type*>(mem + slotOffset(capacity));
+        std::memset(ctrl_, static_cast<unsigned char>(kEmpty),
+                    capacity + kGroupWidth);
+        capacity_ = capacity;
+        growthLeft_ = growthFor(capacity) - size_;
+    }
+
+    void destroyAll() noexcept {
+        if (!std::is_trivially_destructible<value_type>::value) {
+            for (std::size_t i = 0; i < capacity_; ++i)
+                if (isFull(ctrl_[i]))
+                    slots_[i].~value_type();
+        }
+    }
+
+    void deallocate() noexcept {
+        ::operator delete(ctrl_);
+        ctrl_ = nullptr;
+        slots_ = nullptr;
+        capacity_ = 0;
+        growthLeft_ = 0;
+    }
+
+    // The probe sequence of a hash: the groups starting at H1, then at
+    // offsets 16, 48, 96, ... from it. Capacities are powers of two no
+    // smaller than a group, so every group is eventually visited.
+    class ProbeSeq {
+    private:
+        std::size_t mask;
+        std::size_t step = 0;
+
+    public:
+        std::size_t pos;
+
+        ProbeSeq(std::uint64_t hash, std::size_t capacity)
+            : mask(capacity - 1), pos(h1(hash) & mask) {}
+
+        std::size_t offset(unsigned i) const { return (pos + i) & mask; }
+
+        void next() {
+            step += kGroupWidth;
+            pos = (pos + step) & mask;
+        }
+    };
+
+    template <typename K>
+    std::size_t findIndex(const K& key, std::uint64_t hash) const {
+        if (capacity_ == 0)
+            return npos;
+        for (ProbeSeq seq(hash, capacity_);; seq.next()) {
+            Group g(ctrl_ + seq.pos);
+            for (auto m = g.match(h2(hash)); m; ++m) {
+                auto i = seq.offset(m.lowest());
+                if (eq_(Policy::key(slots_[i]), key))
+                    return i;
+            }
+            if (g.matchEmpty())
+                return npos;
+        }
+    }
+
+    std::size_t findFirstNonFull(std::uint64_t hash) const {
+        for (ProbeSeq seq(hash, capacity_);; seq.next()) {
+            auto m = Group(ctrl_ + seq.pos).matchEmptyOrDeleted();
+            if (m)
+                return seq.offset(m.lowest());
+        }
+    }
+
+    void resize(std::size_t capacity) {
+        auto oldCtrl = ctrl_;
+        auto oldSlots = slots_;
+        auto oldCapacity = capacity_;
+        allocate(capacity);
+        for (std::size_t i = 0; i < oldCapacity; ++i) {
+            if (isFull(oldCtrl[i])) {
+                auto hash = hashOf(Policy::key(oldSlots[i]));
+                auto target = findFirstNonFull(hash);
+                setCtrl(target, h2(hash));
+                Policy::transfer(slots_ + target, oldSlots + i);
+            }
+        }
+        ::operator delete(oldCtrl);
+    }
+
+    // Called when there is no free slot left. Unless the table is more than
+    // 25/32 full, many of the used slots are tombstones, and rehashing into
+    // the same capacity makes enough room: at least 3/32 of the capacity is
+    // then inserted before the next rehash.
+    void makeRoom() {
+        if (capacity_ == 0)
+            resize(kMinCapacity);
+        else if (size_ * 32 <= capacity_ * 25)
+            resize(capacity_);
+        else
+            resize(capacity_ * 2);
+    }
+
+    std::size_t prepareInsert(std::uint64_t hash) {
+        if (capacity_ == 0)
+            makeRoom();
+        auto target = findFirstNonFull(hash);
+        if (growthLeft_ == 0 && ctrl_[target] != kDeleted) {
+            makeRoom();
+            target = findFirstNonFull(hash);
+        }
+        ++size_;
+        growthLeft_ -= (ctrl_[target] == kEmpty);
+        setCtrl(target, h2(hash));
+        return target;
+    }
+
+    // Marks slot i as free. If the run of non-empty slots going through i is
+    // shorter than a group, every group containing i also contains an empty
+    // slot, so no probe ever went past i and it can become empty again.
+    // Otherwise a tombstone keeps those probes going.
+    void releaseSlot(std::size_t i) noexcept {
+        --size_;
+        auto before = (i - kGroupWidth) & (capacity_ - 1);
+        auto emptyAfter = Group(ctrl_ + i).matchEmpty();
+        auto emptyBefore = Group(ctrl_ + before).matchEmpty();
+        bool wasNeverFull =
+            emptyBefore && emptyAfter &&
+            emptyAfter.leadingMisses() + emptyBefore.trailingMisses() <
+                kGroupWidth;
+        setCtrl(i, wasNeverFull ? kEmpty : kDeleted);
+        growthLeft_ += wasNeverFull;
+    }
+
+    void eraseAt(std::size_t i) noexcept {
+        slots_[i].~value_type();
+        releaseSlot(i);
+    }
+
+    template <typename... Args>
+    void constructAt(std::size_t i, Args&&... args) {
+        try {
+            ::new (static_cast<void*>(slots_ + i))
+                value_type(std::forward<Args>(args)...);
+        } catch (...) {
+            releaseSlot(i);
+            throw;
+        }
+    }
+
+    iterator iteratorAt(std::size_t i) noexcept {
+        return iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i);
+    }
+
+    const_iterator iteratorAt(std::size_t i) const noexcept {
+        return const_iterator(ctrl_ + i, ctrl_ + capacity_, slots_ + i);
+    }
+
+protected:
+    // Mixes what Hash returned into the hash the table works with
+    static std::uint64_t mixHash(std::size_t h) noexcept {
+        return hash_detail::mum(static_cast<std::uint64_t>(h),
+                                hash_detail::kPrime0);
+    }
+
+    // Finds key, or claims a free slot for it. The second member is true in
+    // the latter case, and the caller must then construct the element.
+    template <typename K>
+    std::pair<std::size_t, bool> findOrPrepareInsert(const K& key,
+                                                     std::uint64_t hash) {
+        auto i = findIndex(key, hash);
+        if (i != npos)
+            return {i, false};
+        return {prepareInsert(hash), true};
+    }
+
+    template <typename K>
+    std::pair<std::size_t, bool> findOrPrepareInsert(const K& key) {
+        return findOrPrepareInsert(key, hashOf(key));
+    }
+
+    // hash is the mixed hash of key
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplaceHashed(std::uint64_t hash, K&& key,
+                                               Args&&... args) {
+        auto res = findOrPrepareInsert(key, hash);
+        if (res.second)
+            constructAt(res.first, std::piecewise_construct,
+                        std::forward_as_tuple(std::forward<K>(key)),
+                        std::forward_as_tuple(std::forward<Args>(args)...));
+        return {iteratorAt(res.first), res.second};
+    }
+
+    template <typename K, typename... Args>
+    std::pair<iterator, bool> tryEmplaceImpl(K&& key, Args&&... args) {
+        auto hash = hashOf(key);
+        return tryEmplaceHashed(hash, std::forward<K>(key),
+                                std::forward<Args>(args)...);
+    }
+
+    value_type& slotAt(std::size_t i) noexcept { return slots_[i]; }
+    const value_type& slotAt(std::size_t i) const noexcept { return slots_[i]; }
+
+    template <typename K>
+    std::size_t findIndex(const K& key) const {
+        return findIndex(key, hashOf(key));
+    }
+
+    static constexpr std::size_t notFound() noexcept { return npos; }
+
+public:
+    raw_hash_set() = default;
+
+    explicit raw_hash_set(std::size_t bucketCount, const Hash& hash = Hash(),
+                          const Eq& eq = Eq())
+        : hash_(hash), eq_(eq) {
+        if (bucketCount != 0)
+            allocate(capacityFor(bucketCount));
+    }
+
+    template <typename InputIt>
+    raw_hash_set(InputIt first, InputIt last, std::size_t bucketCount = 0,
+                 const Hash& hash = Hash(), const Eq& eq = Eq())
+        : raw_hash_set(bucketCount, hash, eq) {
+        insert(first, last);
+    }
+
+    raw_hash_set(std::initializer_list<value_type> init,
+                 std::size_t bucketCount = 0, const Hash& hash = Hash(),
+                 const Eq& eq = Eq())
+        : raw_hash_set(init.begin(), init.end(), bucketCount, hash, eq) {}
+
+    raw_hash_set(const raw_hash_set& other)
+        : raw_hash_set(other.size(), other.hash_, other.eq_) {
+        for (const auto& v : other)
+            insert(v);
+    }
+
+    raw_hash_set(raw_hash_set&& other) noexcept
+        : ctrl_(other.ctrl_), slots_(other.slots_), size_(other.size_),
+          capacity_(other.capacity_), growthLeft_(other.growthLeft_),
+          hash_(std::move(other.hash_)), eq_(std::move(other.eq_)) {
+        other.ctrl_ = nullptr;
+        other.slots_ = nullptr;
+        other.size_ = other.capacity_ = other.growthLeft_ = 0;
+    }
+
+    raw_hash_set& operator=(const raw_hash_set& other) {
+        if (this != &other) {
+            raw_hash_set tmp(other);
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    raw_hash_set& operator=(raw_hash_set&& other) noexcept {
+        if (this != &other) {
+            raw_hash_set tmp(std::move(other));
+            swap(tmp);
+        }
+        return *this;
+    }
+
+    ~raw_hash_set() {
+        destroyAll();
+        ::operator delete(ctrl_);
+    }
+
+    iterator begin() noexcept {
+        auto ret = iteratorAt(0);
+        ret.skipFree();
+        return ret;
+    }
+
+    const_iterator begin() const noexcept {
+        auto ret = iteratorAt(0);
+        ret.skipFree();
+        return ret;
+    }
+
+    const_iterator cbegin() const noexcept { return begin(); }
+    iterator end() noexcept { return iteratorAt(capacity_); }
+    const_iterator end() const noexcept { return iteratorAt(capacity_); }
+    const_iterator cend() const noexcept { return end(); }
+
+    bool empty() const noexcept { return size_ == 0; }
+    std::size_t size() const noexcept { return size_; }
+    std::size_t capacity() const noexcept { return capacity_; }
+
+    float load_factor() const noexcept {
+        return capacity_ ? float(size_) / capacity_ : 0.0f;
+    }
+
+    float max_load_factor() const noexcept { return 7.0f / 8; }
+
+    hasher hash_function() const { return hash_; }
+    key_equal key_eq() const { return eq_; }
+
+    // Destroys the elements but keeps the capacity
+    void clear() noexcept {
+        destroyAll();
+        if (capacity_ != 0)
+            std::memset(ctrl_, static_cast<unsigned char>(kEmpty),
+                        capacity_ + kGroupWidth);
+        size_ = 0;
+        growthLeft_ = growthFor(capacity_);
+    }
+
+    // Makes room for n elements without further rehashing
+    void reserve(std::size_t n) {
+        if (n > size_ + growthLeft_)
+            resize(capacityFor(n));
+    }
+
+    // Rehashes into the smallest capacity that holds max(n, size())
+    // elements. This drops every tombstone, and rehash(0) shrinks the table
+    // to fit.
+    void rehash(std::size_t n) {
+        auto target = std::max(n, size_);
+        if (target == 0) {
+            destroyAll();
+            deallocate();
+            return;
+        }
+        resize(capacityFor(target));
+    }
+
+    std::pair<iterator, bool> insert(const value_type& v) {
+        auto res = findOrPrepareInsert(Policy::key(v));
+        if (res.second)
+            constructAt(res.first, v);
+        return {iteratorAt(res.first), res.second};
+    }
+
+    std::pair<iterator, bool> insert(value_type&& v) {
+        auto res = findOrPrepareInsert(Policy::key(v));
+        if (res.second)
+            constructAt(res.first, std::move(v));
+        return {iteratorAt(res.first), res.second};
+    }
+
+    template <typename InputIt>
+    void insert(InputIt first, InputIt last) {
+        for (; first != last; ++first)
+            insert(*first);
+    }
+
+    void insert(std::initializer_list<value_type> init) {
+        insert(init.begin(), init.end());
+    }
+
+    // Builds the element first, since its key is needed to find its slot
+    template <typename... Args>
+    std::pair<iterator, bool> emplace(Args&&... args) {
+        return insert(value_type(std::forward<Args>(args)...));
+    }
+
+    template <typename K = key_type>
+    iterator find(const key_arg<K>& key) {
+        auto i = findIndex(key);
+        return i == npos ? end() : iteratorAt(i);
+    }
+
+    template <typename K = key_type>
+    const_iterator find(const key_arg<K>& key) const {
+        auto i = findIndex(key);
+        return i == npos ? end() : iteratorAt(i);
+    }
+
+    template <typename K = key_type>
+    bool contains(const key_arg<K>& key) const {
+        return findIndex(key) != npos;
+    }
+
+    template <typename K = key_type>
+    std::size_t count(const key_arg<K>& key) const {
+        return contains(key) ? 1 : 0;
+    }
+
+    // Erasing never moves other elements, so iterators to them stay valid
+    iterator erase(const_iterator pos) {
+        auto i = static_cast<std::size_t>(pos.ctrl - ctrl_);
+        eraseAt(i);
+        auto ret = iteratorAt(i);
+        ++ret;
+        return ret;
+    }
+
+    iterator erase(iterator pos) { return erase(const_iterator(pos)); }
+
+    template <typename K = key_type>
+    std::size_t erase(const key_arg<K>& key) {
+        auto i = findIndex(key);
+        if (i == npos)
+            return 0;
+        eraseAt(i);
+        return 1;
+    }
+
+    void swap(raw_hash_set& other) noexcept {
+        using std::swap;
+        swap(ctrl_, other.ctrl_);
+        swap(slots_, other.slots_);
+        swap(size_, other.size_);
+        swap(capacity_, other.capacity_);
+        swap(growthLeft_, other.growthLeft_);
+        swap(hash_, other.hash_);
+        swap(eq_, other.eq_);
+    }
+
+    friend void swap(raw_hash_set& lhs, raw_hash_set& rhs) noexcept {
+        lhs.swap(rhs);
+    }
+
+    friend bool operator==(const raw_hash_set& lhs, const raw_hash_set& rhs) {
+        if (lhs.size() != rhs.size())
+            return false;
+        for (const auto& v : lhs) {
+            auto i = rhs.findIndex(Policy::key(v));
+            if (i == npos || !(rhs.slots_[i] == v))
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const raw_hash_set& lhs, const raw_hash_set& rhs) {
+        return !(lhs == rhs);
+    }
+};
+
+} // namespace flat_hash_detail
+
+template <typename T, typename Hash = std::hash<T>,
+          typename Eq = std::equal_to<T>>
+class flat_hash_set
+    : public flat_hash_detail::raw_hash_set<flat_hash_detail::set_policy<T>,
+                                            Hash, Eq> {
+private:
+    using Base =
+        flat_hash_detail::raw_hash_set<flat_hash_detail::set_policy<T>, Hash,
+                                       Eq>;
+
+public:
+    using Base::Base;
+
+    flat_hash_set() = default;
+};
+
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Eq = std::equal_to<K>>
+class flat_hash_map
+    : public flat_hash_detail::raw_hash_set<flat_hash_detail::map_policy<K, V>,
+                                            Hash, Eq> {
+private:
+    using Base =
+        flat_hash_detail::raw_hash_set<flat_hash_detail::map_policy<K, V>,
+                                       Hash, Eq>;
+
+    template <typename Key>
+    using key_arg = hash_detail::key_arg_t<Key, K, Hash, Eq>;
+
+public:
+    using mapped_type = V;
+    using typename Base::iterator;
+    using typename Base::key_type;
+    using typename Base::value_type;
+
+    using Base::Base;
+
+    flat_hash_map() = default;
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(const key_type& key,
+                                          Args&&... args) {
+        return this->tryEmplaceImpl(key, std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace(key_type&& key, Args&&... args) {
+        return this->tryEmplaceImpl(std::move(key),
+                                    std::forward<Args>(args)...);
+    }
+
+    // As try_emplace, for a key whose hash, hash_function()(key), is already
+    // known, e.g. because it picked the shard of a concurrent_hash_map: Hash
+    // is not called again
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace_with_hash(std::size_t hash,
+                                                    const key_type& key,
+                                                    Args&&... args) {
+        return this->tryEmplaceHashed(Base::mixHash(hash), key,
+                                      std::forward<Args>(args)...);
+    }
+
+    template <typename... Args>
+    std::pair<iterator, bool> try_emplace_with_hash(std::size_t hash,
+                                                    key_type&& key,
+                                                    Args&&... args) {
+        return this->tryEmplaceHashed(Base::mixHash(hash), std::move(key),
+                                      std::forward<Args>(args)...);
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(const key_type& key, M&& obj) {
+        auto res = try_emplace(key, std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    template <typename M>
+    std::pair<iterator, bool> insert_or_assign(key_type&& key, M&& obj) {
+        auto res = try_emplace(std::move(key), std::forward<M>(obj));
+        if (!res.second)
+            res.first->second = std::forward<M>(obj);
+        return res;
+    }
+
+    V& operator[](const key_type& key) { return try_emplace(key).first->second; }
+
+    V& operator[](key_type&& key) {
+        return try_emplace(std::move(key)).first->second;
+    }
+
+    template <typename Key = key_type>
+    V& at(const key_arg<Key>& key) {
+        auto i = this->findIndex(key);
+        if (i == Base::notFound())
+            throw std::out_of_range("flat_hash_map::at: key not found");
+        return this->slotAt(i).second;
+    }
+
+    template <typename Key = key_type>
+    const V& at(const key_arg<Key>& key) const {
+        auto i = this->findIndex(key);
+        if (i == Base::notFound())
+            throw std::out_of_range("flat_hash_map::at: key not found");
+        return this->slotAt(i).second;
+    }
+};
+
+} // namespace util
@@ -0,0 +1,356 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// 128-bit versions of the Hashing.h API, for fingerprints: hashes that stand
+// in for the values themselves, e.g. to deduplicate billions of documents.
+// With 64-bit hashes, n values collide with probability about n^2 / 2^65,
+// which is already 1/40 for a billion values; with 128 bits it is negligible.
+//
+//  - fingerprint128 is the result: two 64-bit words, compared and ordered as
+//    a 128-bit integer, and hashed for tables by returning its low word
+//  - hashBytes128, Hasher128, hash_combine128, hashRange128, hashContainer128
+//    and hashValues128 mirror hashBytes, Hasher, hash_combine, hashRange,
+//    hashContainer and hashValues
+//
+// The state is two 64-bit chains fed the same words, each folding them in
+// with its own multiply. The two multiplies do not depend on each other, so
+// they add little latency, but they do take twice the multiplier throughput:
+// hashing many short keys costs about 1.5 times as much as with hashBytes.
+// Inputs of 64 bytes or more run through the same multi-lane kernel as
+// hashBytes, vectorized with SSE2 or AVX2, and only its final fold is done
+// twice, so the difference shrinks with the length: 1.3 times at 1KB, 10%
+// at 4KB.
+//
+// The low chain is the 64-bit one, so the low word of hashBytes128(p, n) is
+// hashBytes(p, n), and so is the low word of hashValues128 of integers, or of
+// hashContainer128 of a contiguous container of them. Elements that are
+// strings or containers themselves are added as their own 128-bit hash,
+// where the 64-bit API uses std::hash; other elements are added as their
+// std::hash, as in the 64-bit API, which loses nothing for integers, enums
+// and pointers. Elements of other types are only as distinct as std::hash
+// makes them.
+//
+// Example:
+//
+//  flat_hash_set<fingerprint128> seen;
+//  for (const auto& doc : documents) // std::vector<std::string>
+//      if (!seen.insert(hashContainer128(doc)).second)
+//          duplicates.push_back(&doc);
+struct fingerprint128
+{
+    std::uint64_t lo = 0;
+    std::uint64_t hi = 0;
+
+    constexpr fingerprint128() noexcept = default;
+    constexpr fingerprint128(std::uint64_t lo, std::uint64_t hi) noexcept
+        : lo(lo), hi(hi) {}
+};
+
+constexpr bool operator==(const fingerprint128& a,
+                          const fingerprint128& b) noexcept {
+    return ((a.lo ^ b.lo) | (a.hi ^ b.hi)) == 0;
+}
+
+constexpr bool operator!=(const fingerprint128& a,
+                          const fingerprint128& b) noexcept {
+    return !(a == b);
+}
+
+constexpr bool operator<(const fingerprint128& a,
+                         const fingerprint128& b) noexcept {
+    return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo);
+}
+
+constexpr bool operator>(const fingerprint128& a,
+                         const fingerprint128& b) noexcept {
+    return b < a;
+}
+
+constexpr bool operator<=(const fingerprint128& a,
+                          const fingerprint128& b) noexcept {
+    return !(b < a);
+}
+
+constexpr bool operator>=(const fingerprint128& a,
+                          const fingerprint128& b) noexcept {
+    return !(a < b);
+}
+
+// Two words and no padding, so containers of fingerprints hash in bulk
+template <>
+struct is_uniquely_represented<fingerprint128> : std::true_type {};
+
+namespace hash128_detail {
+
+// One step of the high chain
+constexpr std::uint64_t combineHi(std::uint64_t state,
+                                  std::uint64_t w) noexcept {
+    return hash_detail::mum(state ^ hash_detail::kPrime2,
+                            w ^ hash_detail::kPrime3);
+}
+
+// The two chains, before finalization
+struct State {
+    std::uint64_t lo;
+    std::uint64_t hi;
+
+    constexpr void addWord(std::uint64_t w) noexcept {
+        lo = hash_detail::combine(lo, w);
+        hi = combineHi(hi, w);
+    }
+
+    constexpr fingerprint128 finish() const noexcept {
+        return {hash_mix(lo ^ hash_detail::kPrime2),
+                hash_detail::mum(hi ^ hash_detail::kPrime0,
+                                 lo ^ hash_detail::kPrime3)};
+    }
+};
+
+template <typename T, typename = void>
+struct is_range : std::false_type {};
+
+template <typename T>
+struct is_range<T, hash_detail::void_t<
+                       decltype(std::begin(std::declval<const T&>())),
+                       decltype(std::end(std::declval<const T&>()))>>
+    : std::true_type {};
+
+// How an element is added: 0 as one block of bytes, 1 element by element,
+// 2 as its std::hash
+template <typename T>
+using value_kind = std::integral_constant<
+    int, hash_detail::is_bulk_hashable<T>::value ? 0
+         : is_range<T>::value                    ? 1
+                                                 : 2>;
+
+} // namespace hash128_detail
+
+inline fingerprint128 hashBytes128(const void* data, std::size_t len,
+                                   std::uint64_t seed = 0) noexcept {
+    using namespace hash_detail;
+    auto p = static_cast<const unsigned char*>(data);
+    auto total = len;
+    hash128_detail::State s{seed ^ (len * kPrime2), seed ^ (len * kPrime3)};
+
+    if (len >= kStripeLen) {
+        alignas(32) std::uint64_t acc[8];
+        accumulateStripes(acc, p, len, seed);
+        for (std::size_t i = 0; i < 8; i += 2) {
+            s.lo = combine(s.lo, mum(acc[i] ^ kSecret[i + 8],
+                                     acc[i + 1] ^ kSecret[i + 9]));
+            s.hi = hash128_detail::combineHi(
+                s.hi,
+                mum(acc[i] ^ kSecret[i + 16], acc[i + 1] ^ kSecret[i + 17]));
+        }
+        p += len / kStripeLen * kStripeLen;
+        len %= kStripeLen;
+    }
+
+    for (; len > 8; len -= 8, p += 8)
+        s.addWord(read64(p));
+    if (len > 0) {
+        std::uint64_t last;
+        if (total >= 8)
+            last = read64(p + len - 8);
+        else if (len >= 4)
+            last = (read32(p) << 32) | read32(p + len - 4);
+        else
+            last = (std::uint64_t(p[0]) << 16) |
+                   (std::uint64_t(p[len >> 1]) << 8) | p[len - 1];
+        s.addWord(last);
+    }
+    return s.finish();
+}
+
+namespace hash128_detail {
+
+inline void addValue(State& s, const fingerprint128& f) noexcept {
+    s.addWord(f.lo);
+    s.addWord(f.hi);
+}
+
+template <typename T>
+void addValue(State& s, const T& v);
+
+template <typename A, typename B>
+void addValue(State& s, const std::pair<A, B>& p) {
+    addValue(s, p.first);
+    addValue(s, p.second);
+}
+
+template <typename It>
+fingerprint128 hashElements(It first, It last) {
+    State s{0, 0};
+    for (; first != last; ++first)
+        addValue(s, *first);
+    return s.finish();
+}
+
+template <typename C>
+fingerprint128 hashContainer(const C& c, std::integral_constant<int, 0>) {
+    return hashBytes128(c.data(), c.size() * sizeof(typename C::value_type));
+}
+
+template <typename C>
+fingerprint128 hashContainer(const C& c, std::integral_constant<int, 1>) {
+    using std::begin;
+    using std::end;
+    return hashElements(begin(c), end(c));
+}
+
+template <typename T>
+void addValue(State& s, const T& v, std::integral_constant<int, 2>) {
+    s.addWord(hash_detail::stdHash(v));
+}
+
+template <typename T, int Kind>
+void addValue(State& s, const T& v, std::integral_constant<int, Kind> kind) {
+    addValue(s, hashContainer(v, kind));
+}
+
+template <typename T>
+void addValue(State& s, const T& v) {
+    addValue(s, v, value_kind<T>{});
+}
+
+} // namespace hash128_detail
+
+// A streaming 128-bit hasher, as Hasher. The low word of finish() is what
+// Hasher would return for the same words.
+class Hasher128 {
+private:
+    hash128_detail::State state;
+
+public:
+    constexpr explicit Hasher128(std::uint64_t seed = 0) noexcept
+        : state{seed, seed} {}
+
+    // Folds an already computed hash value into the state
+    constexpr Hasher128& addHash(std::uint64_t h) noexcept {
+        state.addWord(h);
+        return *this;
+    }
+
+    constexpr Hasher128& addHash(const fingerprint128& f) noexcept {
+        state.addWord(f.lo);
+        state.addWord(f.hi);
+        return *this;
+    }
+
+    template <typename T>
+    Hasher128& add(const T& v) {
+        hash128_detail::addValue(state, v);
+        return *this;
+    }
+
+    constexpr fingerprint128 finish() const noexcept { return state.finish(); }
+};
+
+// Folds v into seed, which is not finalized, as hash_combine does
+template <typename T>
+void hash_combine128(fingerprint128& seed, const T& v) {
+    hash128_detail::State s{seed.lo, seed.hi};
+    hash128_detail::addValue(s, v);
+    seed = {s.lo, s.hi};
+}
+
+template <typename It, typename F>
+fingerprint128 hashRange128(It first, It last, F&& func) {
+    Hasher128 hasher;
+    for (auto itr = first; itr != last; ++itr)
+        hasher.add(func(*itr));
+    return hasher.finish();
+}
+
+// Hashes the elements of [first, last) in order. Ranges of uniquely
+// represented values given as pointers, or as iterators of std::vector or
+// std::string, are hashed as raw bytes, in bulk.
+template <typename T>
+fingerprint128 hashRange128(const T* first, const T* last) {
+    if (is_uniquely_represented<T>::value)
+        return hashBytes128(first, (last - first) * sizeof(T));
+    return hash128_detail::hashElements(first, last);
+}
+
+template <typename T>
+fingerprint128 hashRange128(T* first, T* last) {
+    return hashRange128(static_cast<const T*>(first),
+                        static_cast<const T*>(last));
+}
+
+namespace hash128_detail {
+
+template <typename It>
+fingerprint128 hashIteratorRange(It first, It last, std::true_type) {
+    const auto* p = first == last ? nullptr : std::addressof(*first);
+    return hashRange128(p, p + (last - first));
+}
+
+template <typename It>
+fingerprint128 hashIteratorRange(It first, It last, std::false_type) {
+    return hashElements(first, last);
+}
+
+} // namespace hash128_detail
+
+template <typename It>
+fingerprint128 hashRange128(It first, It last) {
+    return hash128_detail::hashIteratorRange(
+        first, last, hash_detail::is_contiguous_iterator<It>{});
+}
+
+// Contiguous containers of uniquely represented values are hashed as raw
+// bytes, in bulk, and everything else element by element, as by
+// hashContainer
+template <typename C>
+fingerprint128 hashContainer128(const C& container) {
+    return hash128_detail::hashContainer(
+        container,
+        std::integral_constant<int, hash_detail::is_bulk_hashable<C>::value
+                                        ? 0
+                                        : 1>{});
+}
+
+// Hashes any number of values, in order, with a single Hasher128
+template <typename... Ts>
+fingerprint128 hashValues128(const Ts&... vs) {
+    Hasher128 hasher;
+    using expand = int[];
+    (void)expand{0, (hasher.add(vs), 0)...};
+    return hasher.finish();
+}
+
+// Hashes containers into fingerprints, as ContainerHasher does into size_t
+template <typename ContainerType>
+struct ContainerFingerprinter
+{
+    using value_type = typename ContainerType::value_type;
+
+    fingerprint128 operator()(const ContainerType& c) const {
+        return hashContainer128(c);
+    }
+};
+} // namespace util
+
+namespace std {
+// The low word is already a well-mixed 64-bit hash
+template <>
+struct hash<util::fingerprint128> {
+    using argument_type = util::fingerprint128;
+    using result_type = size_t;
+    result_type operator()(const argument_type& f) const noexcept {
+        return static_cast<size_t>(f.lo);
+    }
+};
+}
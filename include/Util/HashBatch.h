@@ -0,0 +1,104 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// hash_batch hashes a whole column of keys at once, writing out[i] for
+// keys[i]. The results are exactly those of the per-key hashers:
+//  - hash_batch(const T* keys, n, out), for integers: hashValues(keys[i])
+//  - hash_batch(const std::pair<A, B>* keys, n, out):
+//    PairHasher<std::pair<A, B>>()(keys[i])
+//  - hash_batch(const char* data, width, n, out), for n fixed-width strings
+//    stored back to back: StringHasher<>() of each of them
+// so they can be mixed freely, e.g. building a hash join's table one key at
+// a time and probing it a column at a time.
+//
+// The loops are scalar on purpose. Every key goes through a 64x64->128-bit
+// multiply, which x86 only has as a scalar instruction: built out of AVX2's
+// 32-bit vpmuludq, it takes four multiplies and a dozen other instructions
+// for four keys, and measured no faster than mulx on integers and slower on
+// pairs. What a batch does save is the per-key work around the hash: for
+// strings, the choice of path through hashBytes depends on the width only,
+// so it is made once per column instead of once per key.
+//
+// Example:
+//
+//  std::vector<std::uint64_t> hashes(column.size());
+//  hash_batch(column.data(), column.size(), hashes.data());
+
+namespace batch_detail {
+
+// Hasher().addHash(w).finish()
+inline std::uint64_t hashWord(std::uint64_t w) noexcept {
+    return hash_mix(hash_detail::combine(0, w) ^ hash_detail::kPrime2);
+}
+
+// Strings shorter than a stripe. This is hashBytes with a seed of 0, the
+// branches on the length hoisted out of the loop.
+inline void hashShortStrings(const char* data, std::size_t width,
+                             std::size_t n, std::uint64_t* out) noexcept {
+    using namespace hash_detail;
+    auto p = reinterpret_cast<const unsigned char*>(data);
+    auto init = width * kPrime2;
+    if (width == 0) {
+        for (std::size_t i = 0; i < n; ++i)
+            out[i] = hash_mix(init ^ kPrime2);
+    } else if (width < 4) {
+        for (std::size_t i = 0; i < n; ++i, p += width) {
+            auto last = (std::uint64_t(p[0]) << 16) |
+                        (std::uint64_t(p[width >> 1]) << 8) | p[width - 1];
+            out[i] = hash_mix(combine(init, last) ^ kPrime2);
+        }
+    } else if (width < 8) {
+        for (std::size_t i = 0; i < n; ++i, p += width) {
+            auto last = (read32(p) << 32) | read32(p + width - 4);
+            out[i] = hash_mix(combine(init, last) ^ kPrime2);
+        }
+    } else {
+        // Whole words, then the last 8 bytes, which may overlap them
+        auto words = (width - 1) / 8;
+        for (std::size_t i = 0; i < n; ++i, p += width) {
+            auto h = init;
+            for (std::size_t w = 0; w < words; ++w)
+                h = combine(h, read64(p + 8 * w));
+            out[i] = hash_mix(combine(h, read64(p + width - 8)) ^ kPrime2);
+        }
+    }
+}
+
+} // namespace batch_detail
+
+template <typename T, std::enable_if_t<std::is_integral<T>::value, int> = 0>
+void hash_batch(const T* keys, std::size_t n, std::uint64_t* out) {
+    for (std::size_t i = 0; i < n; ++i)
+        out[i] = batch_detail::hashWord(hash_detail::stdHash(keys[i]));
+}
+
+template <typename A, typename B>
+void hash_batch(const std::pair<A, B>* keys, std::size_t n,
+                std::uint64_t* out) {
+    for (std::size_t i = 0; i < n; ++i) {
+        auto h = hash_detail::combine(0, hash_detail::stdHash(keys[i].first));
+        h = hash_detail::combine(h, hash_detail::stdHash(keys[i].second));
+        out[i] = hash_mix(h ^ hash_detail::kPrime2);
+    }
+}
+
+// Hashes the n strings of width bytes stored back to back from data
+inline void hash_batch(const char* data, std::size_t width, std::size_t n,
+                       std::uint64_t* out) {
+    if (width < hash_detail::kStripeLen) {
+        batch_detail::hashShortStrings(data, width, n, out);
+        return;
+    }
+    for (std::size_t i = 0; i < n; ++i, data += width)
+        out[i] = hashBytes(data, width);
+}
+
+} // namespace util
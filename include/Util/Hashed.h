@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Util/in_place.h"
+
+#include <cstddef>
+#include <functional>
+#include <initializer_list>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// hashed<T, Hash> holds a T along with Hash()(value), computed once when the
+// value is constructed or modified. Hash tables keyed by hashed<T> then never
+// rehash their keys, neither when they grow nor on lookups, and comparisons
+// between keys with different hashes stop before comparing the values.
+// This pays off for keys that are expensive to hash and compare, such as
+// containers of strings.
+//
+// std::hash<hashed<T, Hash>> returns the cached hash, so hashed<T> works as
+// is with the std and util hash tables, and with the util hashers, which go
+// through std::hash for the elements of containers, pairs and tuples.
+//
+// The value is only reachable through const accessors; modify() runs a
+// function on the value and then refreshes the cached hash. If the function
+// or the hasher throws, the cache is marked stale and hash() computes the
+// hash from the value until the next successful update.
+//
+// Example:
+//
+//  using Path = std::vector<std::string>;
+//  std::unordered_map<hashed<Path, ContainerHasher<Path>>, int> index;
+//  index.emplace(Path{"usr", "lib"}, 1);
+//  auto key = hashed<Path, ContainerHasher<Path>>(Path{"usr", "lib"});
+//  index.find(key); // hashes key once, whatever the number of lookups
+//
+// The cached hash is only as strong as Hash: for keys from untrusted sources,
+// use hashed<T, SeededHasher<T>>.
+template <typename T, typename Hash = std::hash<T>>
+class hashed {
+private:
+    T val;
+    std::size_t cachedHash;
+    // Whether val may have changed since cachedHash was computed, because
+    // an update threw
+    bool stale = false;
+
+    void refresh() {
+        cachedHash = Hash()(val);
+        stale = false;
+    }
+
+    template <typename F>
+    void modifyImpl(F&& fn, std::true_type) {
+        stale = true;
+        std::forward<F>(fn)(val);
+        refresh();
+    }
+
+    template <typename F, typename R = decltype(std::declval<F>()(
+                              std::declval<T&>()))>
+    R modifyImpl(F&& fn, std::false_type) {
+        stale = true;
+        R ret = std::forward<F>(fn)(val);
+        refresh();
+        return std::forward<R>(ret);
+    }
+
+public:
+    using value_type = T;
+    using hasher = Hash;
+
+    template <typename U = T, typename = std::enable_if_t<
+                                  std::is_default_constructible<U>::value>>
+    hashed() : val(), cachedHash(Hash()(val)) {}
+
+    hashed(const T& v) : val(v), cachedHash(Hash()(val)) {}
+    hashed(T&& v) : val(std::move(v)), cachedHash(Hash()(val)) {}
+
+    template <typename... Args>
+    explicit hashed(in_place_t, Args&&... args)
+        : val(std::forward<Args>(args)...), cachedHash(Hash()(val)) {}
+
+    template <typename U, typename... Args>
+    explicit hashed(in_place_t, std::initializer_list<U> il, Args&&... args)
+        : val(il, std::forward<Args>(args)...), cachedHash(Hash()(val)) {}
+
+    hashed& operator=(const T& v) {
+        stale = true;
+        val = v;
+        refresh();
+        return *this;
+    }
+
+    hashed& operator=(T&& v) {
+        stale = true;
+        val = std::move(v);
+        refresh();
+        return *this;
+    }
+
+    const T& value() const & noexcept { return val; }
+    T&& value() && noexcept { return std::move(val); }
+    const T& operator*() const & noexcept { return val; }
+    const T* operator->() const noexcept { return &val; }
+    operator const T&() const & noexcept { return val; }
+
+    // The cached hash, or a fresh one if the last update threw
+    std::size_t hash() const
+        noexcept(noexcept(Hash()(std::declval<const T&>()))) {
+        return stale ? Hash()(val) : cachedHash;
+    }
+
+    // Calls fn(value) with a mutable reference, then rehashes the value and
+    // returns what fn returned. If fn or Hash throws, the exception
+    // propagates and the cache stays stale.
+    template <typename F>
+    decltype(auto) modify(F&& fn) {
+        return modifyImpl(
+            std::forward<F>(fn),
+            std::is_void<decltype(std::declval<F>()(std::declval<T&>()))>());
+    }
+
+    void swap(hashed& other) noexcept(noexcept(std::swap(val, other.val))) {
+        using std::swap;
+        swap(val, other.val);
+        swap(cachedHash, other.cachedHash);
+        swap(stale, other.stale);
+    }
+};
+
+template <typename T, typename Hash>
+bool operator==(const hashed<T, Hash>& a, const hashed<T, Hash>& b) {
+    return a.hash() == b.hash() && a.value() == b.value();
+}
+
+template <typename T, typename Hash>
+bool operator!=(const hashed<T, Hash>& a, const hashed<T, Hash>& b) {
+    return !(a == b);
+}
+
+template <typename T, typename Hash>
+void swap(hashed<T, Hash>& a, hashed<T, Hash>& b) noexcept(noexcept(a.swap(b))) {
+    a.swap(b);
+}
+
+} // namespace util
+
+namespace std {
+template <typename T, typename Hash>
+struct hash<util::hashed<T, Hash>> {
+    using argument_type = util::hashed<T, Hash>;
+    using result_type = size_t;
+    result_type operator()(const argument_type& obj) const
+        noexcept(noexcept(obj.hash())) {
+        return obj.hash();
+    }
+};
+}
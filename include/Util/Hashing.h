@@ -1,93 +1,1110 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <functional>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <tuple>
 #include <type_traits>
+#include <utility>
+#include <vector>
+
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+#include <emmintrin.h>
+#endif
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+#include <immintrin.h>
+#endif
+#if defined __has_include
+#if __has_include(<string_view>) && __cplusplus >= 201703L
+#include <string_view>
+#define UTIL_HASHING_HAS_STRING_VIEW 1
+#endif
+#endif
+#if defined __has_builtin
+#if __has_builtin(__builtin_is_constant_evaluated)
+#define UTIL_HASHING_HAS_IS_CONSTANT_EVALUATED 1
+#endif
+#endif
 
 namespace util {
 
+// The 64-bit finalizer of MurmurHash3. Every input bit affects every output bit
+// with probability close to 1/2, which makes it suitable for turning identity
+// hashes (e.g. libstdc++'s std::hash<int>) into well-distributed table keys.
+constexpr std::uint64_t hash_mix(std::uint64_t h) noexcept {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+namespace hash_detail {
+
+// The secrets of wyhash
+constexpr std::uint64_t kPrime0 = 0xa0761d6478bd642fULL;
+constexpr std::uint64_t kPrime1 = 0xe7037ed1a0b428dbULL;
+constexpr std::uint64_t kPrime2 = 0x8ebc6af09c88c6e3ULL;
+constexpr std::uint64_t kPrime3 = 0x589965cc75374cc3ULL;
+
+// Multiplies a and b into 128 bits and folds the halves together with xor.
+// This is the mixing primitive of wyhash: one multiplication spreads every
+// bit of the operands over the middle of the product, and the fold brings the
+// well-mixed middle bits back into the low 64 bits.
+constexpr std::uint64_t mum(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined __SIZEOF_INT128__
+    __extension__ using uint128 = unsigned __int128;
+    auto r = static_cast<uint128>(a) * b;
+    return static_cast<std::uint64_t>(r) ^ static_cast<std::uint64_t>(r >> 64);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32;
+    std::uint64_t la = static_cast<std::uint32_t>(a);
+    std::uint64_t lb = static_cast<std::uint32_t>(b);
+    std::uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+    std::uint64_t t = rl + (rm0 << 32);
+    std::uint64_t c = t < rl;
+    std::uint64_t lo = t + (rm1 << 32);
+    c += lo < t;
+    std::uint64_t hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+    return lo ^ hi;
+#endif
+}
+
+// The high 64 bits of a * b, i.e. a scaled to [0, n) for b = n
+constexpr std::uint64_t mulHigh(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined __SIZEOF_INT128__
+    __extension__ using uint128 = unsigned __int128;
+    return static_cast<std::uint64_t>((static_cast<uint128>(a) * b) >> 64);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32;
+    std::uint64_t la = static_cast<std::uint32_t>(a);
+    std::uint64_t lb = static_cast<std::uint32_t>(b);
+    std::uint64_t ll = la * lb, lh = la * hb, hl = ha * lb;
+    std::uint64_t mid = (ll >> 32) + static_cast<std::uint32_t>(lh) +
+                        static_cast<std::uint32_t>(hl);
+    return ha * hb + (lh >> 32) + (hl >> 32) + (mid >> 32);
+#endif
+}
+
+// One step of the streaming hash: folds the 64-bit word w into state
+constexpr std::uint64_t combine(std::uint64_t state, std::uint64_t w) noexcept {
+    return mum(state ^ kPrime0, w ^ kPrime1);
+}
+
+// The 32-bit finalizer of MurmurHash3, for 32-bit hashes computed eight or
+// sixteen at a time with AVX2 or AVX-512 (see fmix32(__m256i) below)
+constexpr std::uint32_t fmix32(std::uint32_t x) noexcept {
+    x ^= x >> 16;
+    x *= 0x85ebca6bU;
+    x ^= x >> 13;
+    x *= 0xc2b2ae35U;
+    x ^= x >> 16;
+    return x;
+}
+
+// Bulk byte hashing, used for contiguous ranges of uniquely represented
+// values. The input is cut into 64-byte stripes that feed eight independent
+// 64-bit accumulator lanes, in the manner of XXH3:
+//
+//   acc[i]     += lo32(d[i] ^ key[i]) * hi32(d[i] ^ key[i])
+//   acc[i ^ 1] += d[i]
+//
+// where the keys slide by one word from one stripe to the next. Every 16
+// stripes (1KB) the accumulators are scrambled with a multiply so that the
+// position of each block matters. The lanes only depend on themselves, so the
+// loop is limited by throughput rather than latency, and the 32x32->64
+// multiplies map onto pmuludq with SSE2 and AVX2. All variants below produce
+// the same result.
+constexpr std::size_t kStripeLen = 64;
+constexpr std::size_t kStripesPerBlock = 16;
+constexpr std::uint64_t kScramblePrime = 0x9e3779b1ULL;
+
+alignas(32) constexpr std::uint64_t kSecret[kStripesPerBlock + 8] = {
+    0x2cb0f69f4abea221ULL, 0x9417034723148989ULL, 0xdd555950609dfe03ULL,
+    0xdbafb150deb12800ULL, 0x7e789b2e6c442cb6ULL, 0xf41e5636c7e4f8c4ULL,
+    0x0959d150f8fba7e4ULL, 0xa97316f13cdb9eeaULL, 0x74cd8258f9520068ULL,
+    0x55c74a62e116868bULL, 0xd2f4c799a2023cbdULL, 0xdf98cb79a37b51b9ULL,
+    0x396f5885524f3905ULL, 0xaf1d56386ca3b276ULL, 0xa9ffbe6b5104e85aULL,
+    0x6bd0c51b9fd533b3ULL, 0x980ce91c50ab4b56ULL, 0x28ac395780fe62c5ULL,
+    0x768912e3a6bcedc7ULL, 0x50b3e8c9332c7c88ULL, 0xce3bbfe520bd47daULL,
+    0xcba6c8e8e0bb7c4fULL, 0xbf194db8434a346dULL, 0x7d8f2a7b60416d7fULL,
+};
+
+inline std::uint64_t read64(const unsigned char* p) noexcept {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline void accumulateScalar(std::uint64_t* acc, const unsigned char* p,
+                             std::size_t stripes) noexcept {
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeLen) {
+        for (std::size_t i = 0; i < 8; ++i) {
+            auto d = read64(p + 8 * i);
+            auto dk = d ^ kSecret[s + i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xffffffffULL) * (dk >> 32);
+        }
+    }
+}
+
+inline void scrambleScalar(std::uint64_t* acc) noexcept {
+    for (std::size_t i = 0; i < 8; ++i) {
+        auto a = acc[i];
+        a ^= a >> 47;
+        a ^= kSecret[kStripesPerBlock + i];
+        acc[i] = a * kScramblePrime;
+    }
+}
+
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+inline void accumulateSse2(std::uint64_t* acc, const unsigned char* p,
+                           std::size_t stripes) noexcept {
+    __m128i a[4];
+    for (std::size_t i = 0; i < 4; ++i)
+        a[i] = _mm_load_si128(reinterpret_cast<const __m128i*>(acc) + i);
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeLen) {
+        for (std::size_t i = 0; i < 4; ++i) {
+            auto d = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p) + i);
+            auto k = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(kSecret + s) + i);
+            auto dk = _mm_xor_si128(d, k);
+            auto prod = _mm_mul_epu32(dk, _mm_srli_epi64(dk, 32));
+            auto swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(prod, swapped));
+        }
+    }
+    for (std::size_t i = 0; i < 4; ++i)
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+}
+
+inline void scrambleSse2(std::uint64_t* acc) noexcept {
+    auto prime = _mm_set1_epi64x(kScramblePrime);
+    for (std::size_t i = 0; i < 4; ++i) {
+        auto a = _mm_load_si128(reinterpret_cast<const __m128i*>(acc) + i);
+        auto k = _mm_load_si128(
+            reinterpret_cast<const __m128i*>(kSecret + kStripesPerBlock) + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, k);
+        auto lo = _mm_mul_epu32(a, prime);
+        auto hi = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        a = _mm_add_epi64(lo, _mm_slli_epi64(hi, 32));
+        _mm_store_si128(reinterpret_cast<__m128i*>(acc) + i, a);
+    }
+}
+#endif
+
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+inline void accumulateAvx2(std::uint64_t* acc, const unsigned char* p,
+                           std::size_t stripes) noexcept {
+    auto a0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc));
+    auto a1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc) + 1);
+    for (std::size_t s = 0; s < stripes; ++s, p += kStripeLen) {
+        auto d0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        auto d1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p) + 1);
+        auto k0 =
+            _mm256_loadu_si256(reinterpret_cast<const __m256i*>(kSecret + s));
+        auto k1 = _mm256_loadu_si256(
+            reinterpret_cast<const __m256i*>(kSecret + s) + 1);
+        auto dk0 = _mm256_xor_si256(d0, k0);
+        auto dk1 = _mm256_xor_si256(d1, k1);
+        auto prod0 = _mm256_mul_epu32(dk0, _mm256_srli_epi64(dk0, 32));
+        auto prod1 = _mm256_mul_epu32(dk1, _mm256_srli_epi64(dk1, 32));
+        a0 = _mm256_add_epi64(
+            a0, _mm256_add_epi64(
+                    prod0, _mm256_shuffle_epi32(d0, _MM_SHUFFLE(1, 0, 3, 2))));
+        a1 = _mm256_add_epi64(
+            a1, _mm256_add_epi64(
+                    prod1, _mm256_shuffle_epi32(d1, _MM_SHUFFLE(1, 0, 3, 2))));
+    }
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc), a0);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(acc) + 1, a1);
+}
+
+inline void scrambleAvx2(std::uint64_t* acc) noexcept {
+    auto prime = _mm256_set1_epi64x(kScramblePrime);
+    for (std::size_t i = 0; i < 2; ++i) {
+        auto a = _mm256_load_si256(reinterpret_cast<const __m256i*>(acc) + i);
+        auto k = _mm256_load_si256(
+            reinterpret_cast<const __m256i*>(kSecret + kStripesPerBlock) + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, k);
+        auto lo = _mm256_mul_epu32(a, prime);
+        auto hi = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        a = _mm256_add_epi64(lo, _mm256_slli_epi64(hi, 32));
+        _mm256_store_si256(reinterpret_cast<__m256i*>(acc) + i, a);
+    }
+}
+
+inline __m256i fmix32(__m256i x) noexcept {
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(int(0x85ebca6bU)));
+    x = _mm256_xor_si256(x, _mm256_srli_epi32(x, 13));
+    x = _mm256_mullo_epi32(x, _mm256_set1_epi32(int(0xc2b2ae35U)));
+    return _mm256_xor_si256(x, _mm256_srli_epi32(x, 16));
+}
+
+#if defined __AVX512F__
+// AVX-512 code uses the zero-masking forms of shifts and minimums with every
+// lane enabled: GCC 12 warns about the unmasked forms, which fill masked-off
+// lanes from an uninitialized variable
+constexpr __mmask16 kAllLanes32 = 0xffff;
+
+inline __m512i fmix32(__m512i x) noexcept {
+    x = _mm512_xor_si512(x, _mm512_maskz_srli_epi32(kAllLanes32, x, 16));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(int(0x85ebca6bU)));
+    x = _mm512_xor_si512(x, _mm512_maskz_srli_epi32(kAllLanes32, x, 13));
+    x = _mm512_mullo_epi32(x, _mm512_set1_epi32(int(0xc2b2ae35U)));
+    return _mm512_xor_si512(x, _mm512_maskz_srli_epi32(kAllLanes32, x, 16));
+}
+#endif
+#endif
+
+inline void accumulate(std::uint64_t* acc, const unsigned char* p,
+                       std::size_t stripes) noexcept {
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+    accumulateAvx2(acc, p, stripes);
+#elif defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+    accumulateSse2(acc, p, stripes);
+#else
+    accumulateScalar(acc, p, stripes);
+#endif
+}
+
+inline void scramble(std::uint64_t* acc) noexcept {
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+    scrambleAvx2(acc);
+#elif defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+    scrambleSse2(acc);
+#else
+    scrambleScalar(acc);
+#endif
+}
+
+template <typename... Ts>
+struct make_void {
+    using type = void;
+};
+
+template <typename... Ts>
+using void_t = typename make_void<Ts...>::type;
+
+// Whether a hasher or a comparator accepts other types than its key type,
+// for heterogeneous lookups
+template <typename T, typename = void>
+struct is_transparent : std::false_type {};
+
+template <typename T>
+struct is_transparent<T, void_t<typename T::is_transparent>>
+    : std::true_type {};
+
+// The argument type of heterogeneous lookups: with transparent hashers,
+// KeyArg<true>::type<K, Key> is K, the type of the argument, and otherwise
+// the key type. Once the container is instantiated the alias resolves to K
+// itself, which is deduced from the argument, whereas
+// std::conditional<..., K, Key>::type would hide K from deduction and
+// convert every argument to the key type.
+template <bool Transparent>
+struct KeyArg {
+    template <typename K, typename Key>
+    using type = K;
+};
+
+template <>
+struct KeyArg<false> {
+    template <typename K, typename Key>
+    using type = Key;
+};
+
+// K if both Hash and Eq are transparent, and Key otherwise. Containers
+// declare their lookups as
+//
+//  template <typename K>
+//  using key_arg = hash_detail::key_arg_t<K, key_type, Hash, Eq>;
+//
+//  template <typename K = key_type>
+//  iterator find(const key_arg<K>& key);
+//
+// Eq defaults to Hash for containers that only hash their keys.
+template <typename K, typename Key, typename Hash, typename Eq = Hash>
+using key_arg_t =
+    typename KeyArg<is_transparent<Hash>::value &&
+                    is_transparent<Eq>::value>::template type<K, Key>;
+
+} // namespace hash_detail
+
+// Whether equal values of T always have identical object representations, so
+// that hashing their bytes is consistent with operator==. Specialize this for
+// packed structs without padding to opt them into bulk hashing. Floating point
+// types are excluded since 0.0 == -0.0.
+template <typename T>
+struct is_uniquely_represented
+    : std::integral_constant<bool,
+                             std::is_integral<T>::value ||
+                                 std::is_enum<T>::value ||
+                                 std::is_pointer<T>::value
+#if defined __cpp_lib_has_unique_object_representations
+                                 || std::has_unique_object_representations<
+                                        T>::value
+#endif
+                             > {
+};
+
+// Whether C stores its elements contiguously, as advertised by a data()
+// member function returning a pointer to its value_type
+template <typename C, typename = void>
+struct is_contiguous_container : std::false_type {};
+
+template <typename C>
+struct is_contiguous_container<
+    C, hash_detail::void_t<typename C::value_type,
+                           decltype(std::declval<const C&>().data()),
+                           decltype(std::declval<const C&>().size())>>
+    : std::is_same<typename std::decay<decltype(
+                       std::declval<const C&>().data())>::type,
+                   const typename C::value_type*> {};
+
+namespace hash_detail {
+
+inline std::uint64_t read32(const unsigned char* p) noexcept {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+// Runs the multi-lane kernel over the whole stripes of [p, p + len), len
+// being at least one stripe, leaving the lanes in acc (aligned to 32 bytes)
+inline void accumulateStripes(std::uint64_t* acc, const unsigned char* p,
+                              std::size_t len, std::uint64_t seed) noexcept {
+    for (std::size_t i = 0; i < 8; ++i)
+        acc[i] = kSecret[i] ^ seed;
+
+    auto numBlocks = len / (kStripeLen * kStripesPerBlock);
+    for (std::size_t b = 0; b < numBlocks; ++b) {
+        accumulate(acc, p, kStripesPerBlock);
+        scramble(acc);
+        p += kStripeLen * kStripesPerBlock;
+    }
+    accumulate(acc, p, (len % (kStripeLen * kStripesPerBlock)) / kStripeLen);
+}
+
+// Runs the multi-lane kernel over the whole stripes of [p, p + len) and folds
+// the lanes into h
+inline std::uint64_t hashStripes(const unsigned char* p, std::size_t len,
+                                 std::uint64_t seed, std::uint64_t h) noexcept {
+    alignas(32) std::uint64_t acc[8];
+    accumulateStripes(acc, p, len, seed);
+    for (std::size_t i = 0; i < 8; i += 2)
+        h = combine(h, mum(acc[i] ^ kSecret[i + 8], acc[i + 1] ^ kSecret[i + 9]));
+    return h;
+}
+
+} // namespace hash_detail
+
+// Hashes len bytes starting at data. Inputs of a stripe or more go through
+// the multi-lane kernel above, and what is left is folded in word by word.
+// A partial last word is read with overlapping loads rather than copied out
+// byte by byte; since the length is part of the hash this stays injective.
+inline std::size_t hashBytes(const void* data, std::size_t len,
+                             std::uint64_t seed = 0) noexcept {
+    using namespace hash_detail;
+    auto p = static_cast<const unsigned char*>(data);
+    auto total = len;
+    auto h = seed ^ (len * kPrime2);
+
+    if (len >= kStripeLen) {
+        h = hashStripes(p, len, seed, h);
+        p += len / kStripeLen * kStripeLen;
+        len %= kStripeLen;
+    }
+
+    for (; len > 8; len -= 8, p += 8)
+        h = combine(h, read64(p));
+    if (len > 0) {
+        std::uint64_t last;
+        if (total >= 8)
+            last = read64(p + len - 8);
+        else if (len >= 4)
+            last = (read32(p) << 32) | read32(p + len - 4);
+        else
+            last = (std::uint64_t(p[0]) << 16) |
+                   (std::uint64_t(p[len >> 1]) << 8) | p[len - 1];
+        h = combine(h, last);
+    }
+    return static_cast<std::size_t>(hash_mix(h ^ kPrime2));
+}
+
+namespace hash_detail {
+
+// Reads n <= 8 bytes as read64 and read32 do, in the native byte order, for
+// constant evaluation where memcpy is not allowed
+constexpr std::uint64_t loadBytes(const char* p, std::size_t n) noexcept {
+    std::uint64_t v = 0;
+    for (std::size_t i = 0; i < n; ++i) {
+        std::uint64_t byte = static_cast<unsigned char>(p[i]);
+#if defined __BYTE_ORDER__ && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        v |= byte << (8 * (n - 1 - i));
+#else
+        v |= byte << (8 * i);
+#endif
+    }
+    return v;
+}
+
+// hashStripes with the scalar kernel, one stripe at a time
+constexpr std::uint64_t hashStripesConstexpr(const char* p, std::size_t len,
+                                             std::uint64_t seed,
+                                             std::uint64_t h) noexcept {
+    std::uint64_t acc[8] = {};
+    for (std::size_t i = 0; i < 8; ++i)
+        acc[i] = kSecret[i] ^ seed;
+
+    for (std::size_t s = 0; s < len / kStripeLen; ++s, p += kStripeLen) {
+        auto k = s % kStripesPerBlock;
+        for (std::size_t i = 0; i < 8; ++i) {
+            auto d = loadBytes(p + 8 * i, 8);
+            auto dk = d ^ kSecret[k + i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xffffffffULL) * (dk >> 32);
+        }
+        if (k + 1 == kStripesPerBlock) {
+            for (std::size_t i = 0; i < 8; ++i) {
+                auto a = acc[i];
+                a ^= a >> 47;
+                a ^= kSecret[kStripesPerBlock + i];
+                acc[i] = a * kScramblePrime;
+            }
+        }
+    }
+
+    for (std::size_t i = 0; i < 8; i += 2)
+        h = combine(h, mum(acc[i] ^ kSecret[i + 8], acc[i + 1] ^ kSecret[i + 9]));
+    return h;
+}
+
+// hashBytes, step for step, in a form that can run at compile time
+constexpr std::size_t hashBytesConstexpr(const char* p, std::size_t len,
+                                         std::uint64_t seed = 0) noexcept {
+    auto total = len;
+    auto h = seed ^ (len * kPrime2);
+
+    if (len >= kStripeLen) {
+        h = hashStripesConstexpr(p, len, seed, h);
+        p += len / kStripeLen * kStripeLen;
+        len %= kStripeLen;
+    }
+
+    for (; len > 8; len -= 8, p += 8)
+        h = combine(h, loadBytes(p, 8));
+    if (len > 0) {
+        std::uint64_t last = 0;
+        if (total >= 8)
+            last = loadBytes(p + len - 8, 8);
+        else if (len >= 4)
+            last = (loadBytes(p, 4) << 32) | loadBytes(p + len - 4, 4);
+        else
+            last = (loadBytes(p, 1) << 16) |
+                   (loadBytes(p + (len >> 1), 1) << 8) |
+                   loadBytes(p + len - 1, 1);
+        h = combine(h, last);
+    }
+    return static_cast<std::size_t>(hash_mix(h ^ kPrime2));
+}
+
+// std::hash of integers is the identity in libstdc++ and libc++. Spelling it
+// out lets the hashers below run at compile time for integer keys, with the
+// same results as at run time.
+#if defined __GLIBCXX__ || defined _LIBCPP_VERSION
+template <typename T>
+struct has_identity_std_hash
+    : std::integral_constant<bool, std::is_integral<T>::value &&
+                                       sizeof(T) <= sizeof(std::size_t)> {};
+#else
+template <typename T>
+struct has_identity_std_hash : std::false_type {};
+#endif
+
+template <typename T,
+          std::enable_if_t<has_identity_std_hash<T>::value, int> = 0>
+constexpr std::size_t stdHash(const T& v) noexcept {
+    return static_cast<std::size_t>(v);
+}
+
+template <typename T,
+          std::enable_if_t<!has_identity_std_hash<T>::value, int> = 0>
+std::size_t stdHash(const T& v) {
+    return std::hash<T>()(v);
+}
+
+} // namespace hash_detail
+
+// The hash of the string [s, s + len), equal to StringHasher<>() and
+// hashBytes, that can also be computed at compile time. Together with the
+// _h literal below, it turns string keys known in advance into constants:
+//
+//  switch (StringHasher<>()(option)) {
+//  case "cache.size"_h:
+//      ...
+//  case "cache.ttl"_h:
+//      ...
+//  }
+//
+// Note that a switch on hashes still has to compare the strings, since two
+// different strings may share a hash.
+constexpr std::size_t hashString(const char* s, std::size_t len) noexcept {
+#ifdef UTIL_HASHING_HAS_IS_CONSTANT_EVALUATED
+    if (!__builtin_is_constant_evaluated())
+        return hashBytes(s, len);
+#endif
+    return hash_detail::hashBytesConstexpr(s, len);
+}
+
+constexpr std::size_t hashString(const char* s) noexcept {
+    std::size_t len = 0;
+    while (s[len] != '\0')
+        ++len;
+    return hashString(s, len);
+}
+
+#ifdef UTIL_HASHING_HAS_STRING_VIEW
+constexpr std::size_t hashString(std::string_view s) noexcept {
+    return hashString(s.data(), s.size());
+}
+#endif
+
+inline namespace literals {
+inline namespace hash_literals {
+
+// "key"_h is StringHasher<>()("key"), computed at compile time
+constexpr std::size_t operator""_h(const char* s, std::size_t len) noexcept {
+    return hashString(s, len);
+}
+
+} // namespace hash_literals
+} // namespace literals
+
+// A streaming 64-bit hasher. Words are folded into the state one at a time
+// with a wide multiply (see hash_detail::mum), and finish() runs the state
+// through a final avalanche so that the low bits used by power-of-two tables
+// depend on every input bit.
+//
+// Example:
+//
+//  Hasher h;
+//  h.add(key.id);
+//  h.add(key.name);
+//  auto hash = h.finish();
+class Hasher {
+private:
+    std::uint64_t state;
+
+public:
+    constexpr explicit Hasher(std::uint64_t seed = 0) noexcept : state(seed) {}
+
+    // Folds an already computed hash value into the state
+    constexpr Hasher& addHash(std::uint64_t h) noexcept {
+        state = hash_detail::combine(state, h);
+        return *this;
+    }
+
+    template <typename T>
+    constexpr Hasher& add(const T& v) {
+        return addHash(hash_detail::stdHash(v));
+    }
+
+    constexpr std::size_t finish() const noexcept {
+        return static_cast<std::size_t>(
+            hash_mix(state ^ hash_detail::kPrime2));
+    }
+};
+
+// A hash policy decides how the hashers below (ContainerHasher, PairHasher,
+// TupleHasher, StructHasher and EnumClassHasher) turn values into words:
+//  - seed() is the initial state of their Hasher
+//  - value(v) is the hash of a single element
+//  - bytes(data, len) is the hash of a block of uniquely represented values
+// DefaultHashPolicy is unseeded and deterministic. Util/SeededHash.h provides
+// a keyed policy for tables whose keys come from untrusted sources.
+struct DefaultHashPolicy {
+    static constexpr std::uint64_t seed() noexcept { return 0; }
+
+    template <typename T>
+    static constexpr std::uint64_t value(const T& v) {
+        return hash_detail::stdHash(v);
+    }
+
+    static std::size_t bytes(const void* data, std::size_t len) noexcept {
+        return hashBytes(data, len);
+    }
+};
+
 template <typename T>
-inline void hash_combine(std::size_t& seed, const T& v) {
-    seed ^= std::hash<T>()(v) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+constexpr void hash_combine(std::size_t& seed, const T& v) {
+    seed = static_cast<std::size_t>(
+        hash_detail::combine(seed, hash_detail::stdHash(v)));
 }
 
 template <typename T, typename F>
 size_t hashRange(T first, T last, F&& func) {
-    std::size_t seed = 0;
+    Hasher hasher;
+    for (auto itr = first; itr != last; ++itr)
+        hasher.add(func(*itr));
+    return hasher.finish();
+}
+
+namespace hash_detail {
+
+template <typename Policy, typename It>
+std::size_t hashElements(It first, It last) {
+    Hasher hasher(Policy::seed());
     for (auto itr = first; itr != last; ++itr)
-        hash_combine(seed, func(*itr));
-    return seed;
+        hasher.addHash(Policy::value(*itr));
+    return hasher.finish();
+}
+
+template <typename T>
+std::size_t hashPointerRange(const T* first, const T* last, std::true_type) {
+    return hashBytes(first, (last - first) * sizeof(T));
+}
+
+template <typename T>
+std::size_t hashPointerRange(const T* first, const T* last, std::false_type) {
+    return hashElements<DefaultHashPolicy>(first, last);
+}
+
+template <typename It, typename C>
+using is_iterator_of =
+    std::integral_constant<bool,
+                           std::is_same<It, typename C::iterator>::value ||
+                               std::is_same<It, typename C::const_iterator>::value>;
+
+// Whether It walks the elements of a std::vector or a std::string, which are
+// as contiguous as those behind a pointer. C++14 has no contiguous iterator
+// category to ask instead. Only iterators over uniquely represented values,
+// which hashRange hashes in bulk, are worth recognizing.
+template <typename It, typename V,
+          bool = is_uniquely_represented<V>::value &&
+                 !std::is_array<V>::value && !std::is_same<V, bool>::value>
+struct is_std_contiguous_iterator : std::false_type {};
+
+template <typename It, typename V>
+struct is_std_contiguous_iterator<It, V, true>
+    : std::integral_constant<
+          bool, is_iterator_of<It, std::vector<V>>::value ||
+                    is_iterator_of<It, std::string>::value ||
+                    is_iterator_of<It, std::wstring>::value ||
+                    is_iterator_of<It, std::u16string>::value ||
+                    is_iterator_of<It, std::u32string>::value> {};
+
+template <typename It, typename = void>
+struct is_contiguous_iterator : std::false_type {};
+
+template <typename It>
+struct is_contiguous_iterator<
+    It, void_t<typename std::iterator_traits<It>::value_type>>
+    : is_std_contiguous_iterator<
+          It, typename std::iterator_traits<It>::value_type> {};
+
+template <typename It>
+std::size_t hashIteratorRange(It first, It last, std::true_type) {
+    const auto* p = first == last ? nullptr : std::addressof(*first);
+    using T = typename std::iterator_traits<It>::value_type;
+    return hashPointerRange(p, p + (last - first),
+                            is_uniquely_represented<T>{});
+}
+
+template <typename It>
+std::size_t hashIteratorRange(It first, It last, std::false_type) {
+    return hashElements<DefaultHashPolicy>(first, last);
+}
+
+// Whether C is hashed as one block of bytes by hashContainer
+template <typename C, typename = void>
+struct is_bulk_hashable : std::false_type {};
+
+template <typename C>
+struct is_bulk_hashable<
+    C, std::enable_if_t<is_contiguous_container<C>::value>>
+    : is_uniquely_represented<typename C::value_type> {};
+
+template <typename Policy, typename C>
+std::size_t hashContainerImpl(const C& container, std::true_type) {
+    return Policy::bytes(container.data(),
+                         container.size() * sizeof(typename C::value_type));
+}
+
+template <typename Policy, typename C>
+std::size_t hashContainerImpl(const C& container, std::false_type) {
+    using std::begin;
+    using std::end;
+    return hashElements<Policy>(begin(container), end(container));
+}
+
+template <typename Policy, typename C>
+std::size_t hashContainerWith(const C& container) {
+    return hashContainerImpl<Policy>(container, is_bulk_hashable<C>{});
+}
+
+} // namespace hash_detail
+
+// Hashes the elements of [first, last) in order. Ranges of uniquely
+// represented values given as pointers, or as iterators of std::vector or
+// std::string, are hashed as raw bytes, in bulk.
+template <typename It>
+size_t hashRange(It first, It last) {
+    return hash_detail::hashIteratorRange(
+        first, last, hash_detail::is_contiguous_iterator<It>{});
+}
+
+template <typename T>
+size_t hashRange(const T* first, const T* last) {
+    return hash_detail::hashPointerRange(first, last,
+                                         is_uniquely_represented<T>{});
+}
+
+template <typename T>
+size_t hashRange(T* first, T* last) {
+    return hashRange(static_cast<const T*>(first), static_cast<const T*>(last));
 }
 
+// Contiguous containers of uniquely represented values (std::vector<int>,
+// std::string, std::array<char, N>, ...) are hashed as raw bytes, in bulk.
+// Everything else is hashed element by element. Either way,
+// hashContainer(c) == hashRange(begin(c), end(c)) for the standard
+// containers. The two ways do not agree with each other, though: a
+// std::list<int> hashes differently from a std::vector<int> of the same
+// elements, so only hash the same kind of container into one table.
 template <typename T>
 size_t hashContainer(const T& container) {
-    std::size_t seed = 0;
-    for (auto elem : container)
-        hash_combine(seed, elem);
-    return seed;
+    return hash_detail::hashContainerWith<DefaultHashPolicy>(container);
 }
 
 // This is a generalize hasher for all STL containers (and all custom containers
 // that exports value_type typedef). For some reasons, C++11 doesn't specialize
-// std::hash for key types that are containers themselves. This hasher tries to
-// mimic what boost::hash_combine and boost::hash_range does.
-template <typename ContainerType>
+// std::hash for key types that are containers themselves. This hasher feeds
+// the hash of every element, in order, to a util::Hasher.
+template <typename ContainerType, typename Policy = DefaultHashPolicy>
 class ContainerHasher
 {
 public:
     using value_type = typename ContainerType::value_type;
 
     std::size_t operator()(const ContainerType& c) const {
-        return hashContainer(c);
+        return hash_detail::hashContainerWith<Policy>(c);
     }
 };
 
+namespace hash_detail {
+
+template <typename Policy, typename... Ts>
+constexpr std::size_t hashValuesWith(const Ts&... vs) {
+    Hasher hasher(Policy::seed());
+    using expand = int[];
+    (void)expand{0, (hasher.addHash(Policy::value(vs)), 0)...};
+    return hasher.finish();
+}
+
+} // namespace hash_detail
+
+// Hashes any number of values, in order, with a single Hasher
+template <typename... Ts>
+constexpr std::size_t hashValues(const Ts&... vs) {
+    return hash_detail::hashValuesWith<DefaultHashPolicy>(vs...);
+}
+
+// hashPair, hashTriple and hashQuadraple are kept for existing callers; they
+// are the same as hashValues with two, three and four arguments
 template <typename T1, typename T2>
-std::size_t hashPair(const T1& t1, const T2& t2) {
-    std::size_t seed = 0;
-    hash_combine(seed, t1);
-    hash_combine(seed, t2);
-    return seed;
+constexpr std::size_t hashPair(const T1& t1, const T2& t2) {
+    return hashValues(t1, t2);
 }
 
-template <typename Pair>
+namespace hash_detail {
+
+template <typename Policy,
+          std::enable_if_t<!std::is_same<Policy, DefaultHashPolicy>::value,
+                           int> = 0>
+std::size_t stringBytes(const char* s, std::size_t len) {
+    return Policy::bytes(s, len);
+}
+
+// hashString only runs hashBytes at run time when the compiler can tell it
+// is not evaluating a constant expression
+template <typename Policy,
+          std::enable_if_t<std::is_same<Policy, DefaultHashPolicy>::value,
+                           int> = 0>
+constexpr std::size_t stringBytes(const char* s, std::size_t len) noexcept {
+#ifdef UTIL_HASHING_HAS_IS_CONSTANT_EVALUATED
+    return hashString(s, len);
+#else
+    return DefaultHashPolicy::bytes(s, len);
+#endif
+}
+
+} // namespace hash_detail
+
+// Hashes std::string and C strings (and std::string_view since C++17) to the
+// same value as hashContainer(std::string(s)). It is transparent, so tables
+// keyed by std::string can be searched with any of them without building a
+// temporary std::string.
+template <typename Policy = DefaultHashPolicy>
+struct StringHasher
+{
+    using is_transparent = void;
+
+    std::size_t operator()(const std::string& s) const {
+        return Policy::bytes(s.data(), s.size());
+    }
+
+    std::size_t operator()(const char* s) const {
+        return Policy::bytes(s, std::strlen(s));
+    }
+
+#ifdef UTIL_HASHING_HAS_STRING_VIEW
+    // Also computed at compile time with the default policy, e.g. for the
+    // keys of a static_perfect_hash_map
+    constexpr std::size_t operator()(std::string_view s) const {
+        return hash_detail::stringBytes<Policy>(s.data(), s.size());
+    }
+#endif
+};
+
+template <typename Pair, typename Policy = DefaultHashPolicy>
 struct PairHasher
 {
-    std::size_t operator()(const Pair& p) const {
-        return hashPair(p.first, p.second);
+    constexpr std::size_t operator()(const Pair& p) const {
+        return hash_detail::hashValuesWith<Policy>(p.first, p.second);
     }
 };
 
 template <typename T1, typename T2, typename T3>
-std::size_t hashTriple(const T1& t1, const T2& t2, const T3& t3) {
-    std::size_t seed = 0;
-    hash_combine(seed, t1);
-    hash_combine(seed, t2);
-    hash_combine(seed, t3);
-    return seed;
+constexpr std::size_t hashTriple(const T1& t1, const T2& t2, const T3& t3) {
+    return hashValues(t1, t2, t3);
 }
 
 template <typename T1, typename T2, typename T3, typename T4>
-std::size_t hashQuadraple(const T1& t1, const T2& t2, const T3& t3,
-                          const T4& t4) {
-    std::size_t seed = 0;
-    hash_combine(seed, t1);
-    hash_combine(seed, t2);
-    hash_combine(seed, t3);
-    hash_combine(seed, t4);
-    return seed;
+constexpr std::size_t hashQuadraple(const T1& t1, const T2& t2, const T3& t3,
+                                    const T4& t4) {
+    return hashValues(t1, t2, t3, t4);
+}
+
+namespace hash_detail {
+
+template <typename Policy, typename Tuple, std::size_t... Is>
+std::size_t hashTupleImpl(const Tuple& t, std::index_sequence<Is...>) {
+    return hashValuesWith<Policy>(std::get<Is>(t)...);
+}
+
+template <typename Policy, typename Tuple>
+std::size_t hashTupleWith(const Tuple& t) {
+    return hashTupleImpl<Policy>(
+        t, std::make_index_sequence<std::tuple_size<Tuple>::value>{});
+}
+
+template <typename... Ts>
+struct all_uniquely_represented;
+
+template <>
+struct all_uniquely_represented<> : std::true_type {};
+
+template <typename T, typename... Ts>
+struct all_uniquely_represented<T, Ts...>
+    : std::integral_constant<bool, is_uniquely_represented<T>::value &&
+                                       all_uniquely_represented<Ts...>::value> {
+};
+
+template <typename... Ts>
+constexpr std::size_t packedSize() {
+    std::size_t sizes[] = {0, sizeof(Ts)...};
+    std::size_t ret = 0;
+    for (auto s : sizes)
+        ret += s;
+    return ret;
+}
+
+// Copies the fields back to back, dropping any padding between them, and
+// hashes the result as one block. The copies of adjacent fields are merged by
+// the compiler into a few wide moves.
+template <typename Policy, typename... Ts, std::size_t... Is>
+std::size_t hashFields(const std::tuple<const Ts&...>& fields,
+                       std::index_sequence<Is...>, std::true_type) {
+    constexpr std::size_t sizes[] = {sizeof(Ts)...};
+    unsigned char block[packedSize<Ts...>()];
+    std::size_t offset = 0;
+    using expand = int[];
+    (void)expand{0, (std::memcpy(block + offset, &std::get<Is>(fields),
+                                 sizes[Is]),
+                     offset += sizes[Is], 0)...};
+    return Policy::bytes(block, sizeof(block));
+}
+
+template <typename Policy, typename... Ts, std::size_t... Is>
+std::size_t hashFields(const std::tuple<const Ts&...>& fields,
+                       std::index_sequence<Is...> indices, std::false_type) {
+    return hashTupleImpl<Policy>(fields, indices);
+}
+
+template <typename Policy, typename... Ts>
+std::size_t hashFields(const std::tuple<const Ts&...>& fields) {
+    return hashFields<Policy>(fields, std::index_sequence_for<Ts...>{},
+                              all_uniquely_represented<Ts...>{});
+}
+
+} // namespace hash_detail
+
+// Hashes the elements of a std::tuple, std::pair or std::array, in order:
+// hashTuple(std::make_tuple(a, b)) == hashValues(a, b)
+template <typename Tuple>
+std::size_t hashTuple(const Tuple& t) {
+    return hash_detail::hashTupleWith<DefaultHashPolicy>(t);
+}
+
+template <typename Tuple, typename Policy = DefaultHashPolicy>
+struct TupleHasher
+{
+    std::size_t operator()(const Tuple& t) const {
+        return hash_detail::hashTupleWith<Policy>(t);
+    }
+};
+
+// Hashes a struct that lists its fields with UTIL_HASHABLE_FIELDS. When every
+// field is uniquely represented, the fields are packed into one block and
+// hashed with hashBytes(); otherwise they are hashed one by one as with
+// hashValues().
+template <typename T>
+std::size_t hashStruct(const T& v) {
+    return hash_detail::hashFields<DefaultHashPolicy>(v.util_hash_fields());
+}
+
+template <typename T, typename Policy = DefaultHashPolicy>
+struct StructHasher
+{
+    std::size_t operator()(const T& v) const {
+        return hash_detail::hashFields<Policy>(v.util_hash_fields());
+    }
+};
+
+namespace hash_detail {
+
+// The hash of one element of an unordered container. The elements of maps
+// are pairs, which have no std::hash.
+template <typename Policy, typename T>
+std::uint64_t elementHash(const T& v) {
+    return Policy::value(v);
+}
+
+template <typename Policy, typename K, typename V>
+std::uint64_t elementHash(const std::pair<K, V>& kv) {
+    return hashValuesWith<Policy>(kv.first, kv.second);
+}
+
+// Order-independent accumulator: both the sum and the xor of the mixed
+// element hashes are kept, along with the element count. The sum tells
+// multisets apart where the xor would cancel out duplicates, and partial
+// accumulators merge in any order.
+class UnorderedAccumulator {
+private:
+    std::uint64_t sum = 0;
+    std::uint64_t bits = 0;
+    std::uint64_t count = 0;
+
+public:
+    void add(std::uint64_t h) noexcept {
+        auto m = hash_mix(h ^ kPrime1);
+        sum += m;
+        bits ^= m;
+        ++count;
+    }
+
+    void merge(const UnorderedAccumulator& other) noexcept {
+        sum += other.sum;
+        bits ^= other.bits;
+        count += other.count;
+    }
+
+    std::size_t finish(std::uint64_t seed) const noexcept {
+        return Hasher(seed).addHash(sum).addHash(bits).addHash(count).finish();
+    }
+};
+
+template <typename Policy, typename It>
+UnorderedAccumulator accumulateUnordered(It first, It last) {
+    UnorderedAccumulator acc;
+    for (; first != last; ++first)
+        acc.add(elementHash<Policy>(*first));
+    return acc;
+}
+
+template <typename Policy, typename C>
+std::size_t hashUnorderedWith(const C& container) {
+    using std::begin;
+    using std::end;
+    return accumulateUnordered<Policy>(begin(container), end(container))
+        .finish(Policy::seed());
 }
 
+} // namespace hash_detail
+
+// Hashes the elements of a container regardless of their order, so that
+// equal std::unordered_sets (or maps, or multisets) hash the same whatever
+// their insertion history. Runs in O(n) without allocating. See
+// Util/ParallelHash.h for a version spreading the work over a ThreadPool.
+template <typename T>
+std::size_t hashUnordered(const T& container) {
+    return hash_detail::hashUnorderedWith<DefaultHashPolicy>(container);
+}
+
+template <typename ContainerType, typename Policy = DefaultHashPolicy>
+class UnorderedContainerHasher
+{
+public:
+    using value_type = typename ContainerType::value_type;
+
+    std::size_t operator()(const ContainerType& c) const {
+        return hash_detail::hashUnorderedWith<Policy>(c);
+    }
+};
+
 template <typename EnumClassType>
-size_t hashEnumClass(EnumClassType e) {
+constexpr size_t hashEnumClass(EnumClassType e) {
     using RealType = std::underlying_type_t<EnumClassType>;
-    return std::hash<RealType>()(static_cast<RealType>(e));
+    return hash_detail::stdHash(static_cast<RealType>(e));
 }
 
-template <typename EnumClassType>
+template <typename EnumClassType, typename Policy = DefaultHashPolicy>
 struct EnumClassHasher
 {
-    std::size_t operator()(const EnumClassType& e) const {
-        return hashEnumClass(e);
+    constexpr std::size_t operator()(const EnumClassType& e) const {
+        using RealType = std::underlying_type_t<EnumClassType>;
+        return static_cast<std::size_t>(
+            Policy::value(static_cast<RealType>(e)));
     }
 };
 }
+
+// Declares, inside the definition of Type, the fields that make up its value.
+// This generates operator== and operator!= comparing those fields, and lets
+// util::StructHasher<Type> hash them.
+//
+// Example:
+//
+//  struct Key {
+//      std::uint32_t id;
+//      std::uint16_t kind;
+//      std::uint64_t stamp;
+//      UTIL_HASHABLE_FIELDS(Key, id, kind, stamp)
+//  };
+//  std::unordered_set<Key, util::StructHasher<Key>> keys;
+#define UTIL_HASHABLE_FIELDS(Type, ...)                                       \
+    auto util_hash_fields() const noexcept { return std::tie(__VA_ARGS__); } \
+    friend bool operator==(const Type& lhs, const Type& rhs) {               \
+        return lhs.util_hash_fields() == rhs.util_hash_fields();             \
+    }                                                                         \
+    friend bool operator!=(const Type& lhs, const Type& rhs) {               \
+        return !(lhs == rhs);                                                 \
+    }
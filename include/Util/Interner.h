@@ -0,0 +1,268 @@
+#pragma once
+
+#include "Util/FlatHashMap.h"
+#include "Util/Hashing.h"
+#include "Util/NotNullable.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// interner<T, Hash, Eq> hash-conses immutable values: intern(v) returns a
+// pointer to the one canonical copy of every value equal to v, so that
+// interned values compare equal exactly when their pointers do, and can be
+// hashed by address. Deep comparisons and hashes of large values, such as
+// vectors of strings or trees of variants, are then paid once, when the
+// value is interned, instead of on every use.
+//
+// Canonical copies live until the interner is destroyed and never move, so
+// the returned pointers stay valid as long as the interner does. They are
+// allocated from per-shard arenas, in chunks that grow geometrically.
+//
+// interner is thread-safe. The table is split into shards, picked by the
+// high bits of the mixed hash, each with its own lock, arena and
+// flat_hash_set of canonical copies; threads interning different values
+// rarely wait for each other. Hash is called once per intern, outside of
+// any lock.
+//
+// Example:
+//
+//  using Path = std::vector<std::string>;
+//  interner<Path, ContainerHasher<Path>> paths;
+//  nn<const Path*> a = paths.intern(Path{"usr", "lib"});
+//  nn<const Path*> b = paths.intern(split(line, '/'));
+//  if (a == b) // one pointer comparison
+//      ...
+//  flat_hash_set<nn<const Path*>> seen; // hashes the pointer
+
+namespace interner_detail {
+
+template <typename T>
+struct Node {
+    template <typename... Args>
+    explicit Node(std::size_t hash, Args&&... args)
+        : value(std::forward<Args>(args)...), hash(hash) {}
+
+    T value;
+    std::size_t hash;
+};
+
+// What the shard tables are searched with: a value that may not be interned
+// yet, along with its hash
+template <typename T>
+struct Probe {
+    const T& value;
+    std::size_t hash;
+};
+
+template <typename T>
+struct NodeHash {
+    using is_transparent = void;
+
+    std::size_t operator()(const Node<T>* n) const noexcept { return n->hash; }
+    std::size_t operator()(const Probe<T>& p) const noexcept { return p.hash; }
+};
+
+template <typename T, typename Eq>
+struct NodeEq {
+    using is_transparent = void;
+
+    Eq eq;
+
+    bool operator()(const Node<T>* a, const Node<T>* b) const {
+        return a == b;
+    }
+    bool operator()(const Node<T>* n, const Probe<T>& p) const {
+        return n->hash == p.hash && eq(n->value, p.value);
+    }
+    bool operator()(const Probe<T>& p, const Node<T>* n) const {
+        return (*this)(n, p);
+    }
+};
+
+// Allocates nodes that never move, in chunks of kFirstChunk, 2 * kFirstChunk,
+// ... up to kMaxChunk nodes, and destroys them all at once
+template <typename T>
+class Arena {
+private:
+    using Storage = typename std::aligned_storage<sizeof(T), alignof(T)>::type;
+
+    static constexpr std::size_t kFirstChunk = 16;
+    static constexpr std::size_t kMaxChunk = 4096;
+
+    struct Chunk {
+        std::unique_ptr<Storage[]> nodes;
+        std::size_t capacity;
+        std::size_t used;
+    };
+
+    std::vector<Chunk> chunks;
+
+public:
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        for (auto& c : chunks)
+            for (std::size_t i = 0; i < c.used; ++i)
+                reinterpret_cast<T*>(&c.nodes[i])->~T();
+    }
+
+    template <typename... Args>
+    T* create(Args&&... args) {
+        if (chunks.empty() || chunks.back().used == chunks.back().capacity) {
+            auto capacity = chunks.empty()
+                                ? kFirstChunk
+                                : std::min(2 * chunks.back().capacity,
+                                           std::size_t(kMaxChunk));
+            chunks.push_back(
+                Chunk{std::unique_ptr<Storage[]>(new Storage[capacity]),
+                      capacity, 0});
+        }
+        auto& c = chunks.back();
+        auto p = ::new (static_cast<void*>(&c.nodes[c.used]))
+            T(std::forward<Args>(args)...);
+        ++c.used;
+        return p;
+    }
+
+    // Destroys the node returned by the last call to create
+    void destroyLast() noexcept {
+        auto& c = chunks.back();
+        --c.used;
+        reinterpret_cast<T*>(&c.nodes[c.used])->~T();
+    }
+
+    std::size_t memory_usage() const noexcept {
+        std::size_t ret = 0;
+        for (const auto& c : chunks)
+            ret += c.capacity * sizeof(Storage);
+        return ret;
+    }
+};
+
+} // namespace interner_detail
+
+template <typename T, typename Hash = std::hash<T>,
+          typename Eq = std::equal_to<T>>
+class interner
+{
+private:
+    using Node = interner_detail::Node<T>;
+    using Probe = interner_detail::Probe<T>;
+
+    using NodeSet = flat_hash_set<const Node*, interner_detail::NodeHash<T>,
+                                  interner_detail::NodeEq<T, Eq>>;
+
+    struct Shard {
+        std::mutex mutex;
+        NodeSet nodes;
+        interner_detail::Arena<Node> arena;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    unsigned shardBits;
+    Hash hash;
+
+    Shard& shardOf(std::size_t h) const {
+        auto i = shardBits == 0 ? 0 : hash_mix(h) >> (64 - shardBits);
+        return shards[static_cast<std::size_t>(i)];
+    }
+
+    template <typename V>
+    nn<const T*> internImpl(V&& v) {
+        auto h = static_cast<std::size_t>(hash(v));
+        auto& shard = shardOf(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.nodes.template find<Probe>(Probe{v, h});
+        if (it != shard.nodes.end())
+            return nn_addr((*it)->value);
+        auto node = shard.arena.create(h, std::forward<V>(v));
+        try {
+            shard.nodes.insert(node);
+        } catch (...) {
+            shard.arena.destroyLast();
+            throw;
+        }
+        return nn_addr(node->value);
+    }
+
+public:
+    using value_type = T;
+    using hasher = Hash;
+    using key_equal = Eq;
+
+    // The number of shards is rounded up to a power of two; the default
+    // suits a few dozen threads interning at the same time
+    explicit interner(std::size_t numShards = 64, const Hash& hash = Hash(),
+                      const Eq& eq = Eq())
+        : shardBits(0), hash(hash) {
+        while ((std::size_t(1) << shardBits) < numShards && shardBits < 16)
+            ++shardBits;
+        shards.reset(new Shard[std::size_t(1) << shardBits]);
+        for (std::size_t i = 0; i < shard_count(); ++i)
+            shards[i].nodes = NodeSet(0, interner_detail::NodeHash<T>(),
+                                      interner_detail::NodeEq<T, Eq>{eq});
+    }
+
+    interner(const interner&) = delete;
+    interner& operator=(const interner&) = delete;
+
+    // The canonical copy of v, copied or moved into the interner if no equal
+    // value was interned before
+    nn<const T*> intern(const T& v) { return internImpl(v); }
+    nn<const T*> intern(T&& v) { return internImpl(std::move(v)); }
+
+    // The canonical copy of v, or nullptr if no equal value was interned
+    const T* find(const T& v) const {
+        auto h = static_cast<std::size_t>(hash(v));
+        auto& shard = shardOf(h);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.nodes.template find<Probe>(Probe{v, h});
+        return it != shard.nodes.end() ? &(*it)->value : nullptr;
+    }
+
+    bool contains(const T& v) const { return find(v) != nullptr; }
+
+    // The number of distinct values interned. Exact only when no other
+    // thread is interning at the same time.
+    std::size_t size() const {
+        std::size_t ret = 0;
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            ret += shards[i].nodes.size();
+        }
+        return ret;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    std::size_t shard_count() const noexcept {
+        return std::size_t(1) << shardBits;
+    }
+
+    // Bytes held by the arenas and the shard tables
+    std::size_t memory_usage() const {
+        std::size_t ret = 0;
+        for (std::size_t i = 0; i < shard_count(); ++i) {
+            std::lock_guard<std::mutex> lock(shards[i].mutex);
+            ret += shards[i].arena.memory_usage() +
+                   shards[i].nodes.capacity() * (sizeof(const Node*) + 1);
+        }
+        return ret;
+    }
+
+    hasher hash_function() const { return hash; }
+};
+
+} // namespace util
@@ -0,0 +1,473 @@
+#pragma once
+
+#include "Util/FlatHashMap.h"
+#include "Util/Hashing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+#include <immintrin.h>
+#endif
+
+namespace util {
+
+// Locality-sensitive hashes of sets, where similar sets get similar hashes,
+// for finding near-duplicates without comparing every pair:
+//  - minhasher and one_permutation_minhasher compute MinHash signatures:
+//    numHashes 32-bit values, each equal between two sets with probability
+//    their Jaccard similarity |A & B| / |A | B|, estimated by
+//    minhashSimilarity
+//  - lsh_index buckets signatures by bands of values, so that sets above a
+//    similarity threshold share a bucket with high probability: candidates()
+//    and candidate_pairs() replace the quadratic comparison
+//  - simhash computes a 64-bit fingerprint whose Hamming distance
+//    (simhashDistance) reflects the angle between the sets seen as vectors,
+//    and accepts weights, e.g. term frequencies
+//
+// The elements are hashed as by hashRange: func(element), or the element
+// itself, goes through Hasher, so any type with std::hash works and
+// signatures of the same set agree across processes.
+//
+// minhasher applies numHashes independent hash functions to every element:
+// O(n * numHashes), the loop over the hash functions running 8 or 16 at a
+// time with AVX2 or AVX-512. one_permutation_minhasher hashes every element
+// once and keeps the minimum per bin of the hash space, then fills the empty
+// bins from others (optimal densification, Shrivastava 2017):
+// O(n + numHashes), for the same accuracy once sets have a few times
+// numHashes elements.
+//
+// Example:
+//
+//  one_permutation_minhasher minhash(128);
+//  auto index = lsh_index::for_threshold(128, 0.8);
+//  std::vector<std::vector<std::uint32_t>> signatures;
+//  for (const auto& doc : docs) { // std::vector<std::string>
+//      signatures.push_back(minhash.signature(doc.begin(), doc.end()));
+//      index.insert(signatures.size() - 1, signatures.back());
+//  }
+//  for (auto p : index.candidate_pairs())
+//      if (minhashSimilarity(signatures[p.first], signatures[p.second]) > 0.8)
+//          ...
+
+namespace lsh_detail {
+
+// The hash of an element, as by hashRange
+template <typename V>
+std::uint64_t elementHash(std::uint64_t seed, const V& v) {
+    return Hasher(seed).add(v).finish();
+}
+
+struct Identity {
+    template <typename V>
+    const V& operator()(const V& v) const noexcept {
+        return v;
+    }
+};
+
+// sig[i] = the minimum of fmix32(keys[j] ^ seeds[i]) over the n keys
+inline void minHashesScalar(const std::uint32_t* keys, std::size_t n,
+                            const std::uint32_t* seeds, std::size_t k,
+                            std::uint32_t* sig,
+                            std::size_t first = 0) noexcept {
+    for (std::size_t i = first; i < k; ++i) {
+        auto m = std::numeric_limits<std::uint32_t>::max();
+        for (std::size_t j = 0; j < n; ++j)
+            m = std::min(m, hash_detail::fmix32(keys[j] ^ seeds[i]));
+        sig[i] = m;
+    }
+}
+
+#if defined __AVX512F__ && !defined UTIL_HASHING_NO_SIMD
+// 32 hash functions at a time, in two registers so that consecutive minimums
+// don't wait for each other, streaming over the keys
+inline void minHashes(const std::uint32_t* keys, std::size_t n,
+                      const std::uint32_t* seeds, std::size_t k,
+                      std::uint32_t* sig) noexcept {
+    using hash_detail::fmix32;
+    using hash_detail::kAllLanes32;
+    auto minHash = [](__m512i m, __m512i x, __m512i s) {
+        return _mm512_maskz_min_epu32(kAllLanes32, m,
+                                      fmix32(_mm512_xor_si512(x, s)));
+    };
+    std::size_t i = 0;
+    for (; i + 32 <= k; i += 32) {
+        auto s0 = _mm512_loadu_si512(seeds + i);
+        auto s1 = _mm512_loadu_si512(seeds + i + 16);
+        auto m0 = _mm512_set1_epi32(-1), m1 = m0;
+        for (std::size_t j = 0; j < n; ++j) {
+            auto x = _mm512_set1_epi32(int(keys[j]));
+            m0 = minHash(m0, x, s0);
+            m1 = minHash(m1, x, s1);
+        }
+        _mm512_storeu_si512(sig + i, m0);
+        _mm512_storeu_si512(sig + i + 16, m1);
+    }
+    for (; i + 16 <= k; i += 16) {
+        auto s = _mm512_loadu_si512(seeds + i);
+        auto m = _mm512_set1_epi32(-1);
+        for (std::size_t j = 0; j < n; ++j)
+            m = minHash(m, _mm512_set1_epi32(int(keys[j])), s);
+        _mm512_storeu_si512(sig + i, m);
+    }
+    minHashesScalar(keys, n, seeds, k, sig, i);
+}
+#elif defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+// Sixteen hash functions at a time, as above
+inline void minHashes(const std::uint32_t* keys, std::size_t n,
+                      const std::uint32_t* seeds, std::size_t k,
+                      std::uint32_t* sig) noexcept {
+    auto load = [](const std::uint32_t* p) {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    };
+    auto store = [](std::uint32_t* p, __m256i v) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    };
+    auto minHash = [](__m256i m, __m256i x, __m256i s) {
+        return _mm256_min_epu32(m,
+                                hash_detail::fmix32(_mm256_xor_si256(x, s)));
+    };
+    std::size_t i = 0;
+    for (; i + 16 <= k; i += 16) {
+        auto s0 = load(seeds + i), s1 = load(seeds + i + 8);
+        auto m0 = _mm256_set1_epi32(-1), m1 = m0;
+        for (std::size_t j = 0; j < n; ++j) {
+            auto x = _mm256_set1_epi32(int(keys[j]));
+            m0 = minHash(m0, x, s0);
+            m1 = minHash(m1, x, s1);
+        }
+        store(sig + i, m0);
+        store(sig + i + 8, m1);
+    }
+    for (; i + 8 <= k; i += 8) {
+        auto s = load(seeds + i);
+        auto m = _mm256_set1_epi32(-1);
+        for (std::size_t j = 0; j < n; ++j)
+            m = minHash(m, _mm256_set1_epi32(int(keys[j])), s);
+        store(sig + i, m);
+    }
+    minHashesScalar(keys, n, seeds, k, sig, i);
+}
+#else
+inline void minHashes(const std::uint32_t* keys, std::size_t n,
+                      const std::uint32_t* seeds, std::size_t k,
+                      std::uint32_t* sig) noexcept {
+    minHashesScalar(keys, n, seeds, k, sig);
+}
+#endif
+
+// The bins an empty bin looks at, in turn, for one to copy: a sequence that
+// only depends on the seed and the bin. Each step is one multiply, since
+// sets much smaller than the signature take many steps per empty bin.
+class ProbeSequence {
+private:
+    std::uint64_t state;
+
+public:
+    ProbeSequence(std::uint64_t seed, std::size_t bin) noexcept
+        : state(Hasher(seed ^ hash_detail::kPrime3).addHash(bin).finish()) {}
+
+    // The next bin, in [0, bins)
+    std::size_t next(std::size_t bins) noexcept {
+        // Knuth's MMIX LCG, whose high bits pick the bin
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<std::size_t>(hash_detail::mulHigh(state, bins));
+    }
+};
+
+inline unsigned popcount(std::uint64_t x) noexcept {
+#if defined __GNUC__
+    return unsigned(__builtin_popcountll(x));
+#else
+    unsigned n = 0;
+    for (; x; x &= x - 1)
+        ++n;
+    return n;
+#endif
+}
+
+} // namespace lsh_detail
+
+class minhasher
+{
+private:
+    std::vector<std::uint32_t> seeds;
+    std::uint64_t seed_;
+
+public:
+    explicit minhasher(std::size_t numHashes, std::uint64_t seed = 0)
+        : seed_(seed) {
+        if (numHashes == 0)
+            throw std::invalid_argument("minhasher: no hash functions");
+        for (std::size_t i = 0; i < numHashes; ++i)
+            seeds.push_back(static_cast<std::uint32_t>(
+                Hasher(seed ^ hash_detail::kPrime1).addHash(i).finish()));
+    }
+
+    // The signature of the set of func(x) for x in [first, last). Duplicates
+    // don't matter; the signature of an empty set is all 0xffffffff.
+    template <typename It, typename F>
+    std::vector<std::uint32_t> signature(It first, It last, F&& func) const {
+        std::vector<std::uint32_t> keys;
+        for (; first != last; ++first)
+            keys.push_back(static_cast<std::uint32_t>(
+                lsh_detail::elementHash(seed_, func(*first))));
+        std::vector<std::uint32_t> sig(seeds.size());
+        lsh_detail::minHashes(keys.data(), keys.size(), seeds.data(),
+                              seeds.size(), sig.data());
+        return sig;
+    }
+
+    template <typename It>
+    std::vector<std::uint32_t> signature(It first, It last) const {
+        return signature(first, last, lsh_detail::Identity());
+    }
+
+    std::size_t num_hashes() const noexcept { return seeds.size(); }
+    std::uint64_t seed() const noexcept { return seed_; }
+};
+
+class one_permutation_minhasher
+{
+private:
+    std::size_t bins;
+    std::uint64_t seed_;
+
+public:
+    explicit one_permutation_minhasher(std::size_t numHashes,
+                                       std::uint64_t seed = 0)
+        : bins(numHashes), seed_(seed) {
+        if (numHashes == 0 ||
+            numHashes > std::numeric_limits<std::uint32_t>::max())
+            throw std::invalid_argument(
+                "one_permutation_minhasher: bad number of hashes");
+    }
+
+    // As minhasher::signature
+    template <typename It, typename F>
+    std::vector<std::uint32_t> signature(It first, It last, F&& func) const {
+        // The high half of the hash picks the bin, the low half competes in it
+        std::vector<std::uint32_t> sig(
+            bins, std::numeric_limits<std::uint32_t>::max());
+        std::vector<bool> filled(bins);
+        std::size_t numFilled = 0;
+        for (; first != last; ++first) {
+            auto h = lsh_detail::elementHash(seed_, func(*first));
+            auto bin = static_cast<std::size_t>(((h >> 32) * bins) >> 32);
+            sig[bin] = std::min(sig[bin], static_cast<std::uint32_t>(h));
+            if (!filled[bin]) {
+                filled[bin] = true;
+                ++numFilled;
+            }
+        }
+        if (numFilled == 0 || numFilled == bins)
+            return sig;
+
+        // Every empty bin copies the first filled bin of its own sequence of
+        // probes, which only depends on the bin, so that two sets agree on it
+        // exactly as often as on a filled bin
+        auto dense = sig;
+        for (std::size_t i = 0; i < bins; ++i) {
+            if (filled[i])
+                continue;
+            lsh_detail::ProbeSequence probes(seed_, i);
+            std::size_t j;
+            do
+                j = probes.next(bins);
+            while (!filled[j]);
+            dense[i] = sig[j];
+        }
+        return dense;
+    }
+
+    template <typename It>
+    std::vector<std::uint32_t> signature(It first, It last) const {
+        return signature(first, last, lsh_detail::Identity());
+    }
+
+    std::size_t num_hashes() const noexcept { return bins; }
+    std::uint64_t seed() const noexcept { return seed_; }
+};
+
+// The fraction of equal values in two signatures from the same minhasher: an
+// estimate of the Jaccard similarity of their sets, with a standard error of
+// at most 0.5 / sqrt(size)
+inline double minhashSimilarity(const std::vector<std::uint32_t>& a,
+                                const std::vector<std::uint32_t>& b) {
+    if (a.size() != b.size() || a.empty())
+        throw std::invalid_argument("minhashSimilarity: bad signature sizes");
+    std::size_t equal = 0;
+    for (std::size_t i = 0; i < a.size(); ++i)
+        equal += a[i] == b[i];
+    return double(equal) / a.size();
+}
+
+// An index of MinHash signatures of bands * rows values. Each band of rows
+// consecutive values is hashed into a table of its own, and two signatures
+// are candidates when they agree on a whole band. Sets of similarity s are
+// candidates with probability 1 - (1 - s^rows)^bands, a steep S-curve
+// around (1 / bands)^(1 / rows).
+class lsh_index
+{
+private:
+    using Bucket = std::vector<std::uint64_t>;
+
+    std::vector<flat_hash_map<std::uint64_t, Bucket>> tables;
+    std::size_t rows_;
+    std::size_t size_ = 0;
+
+    std::uint64_t bandHash(const std::vector<std::uint32_t>& signature,
+                           std::size_t band) const {
+        return hashBytes(signature.data() + band * rows_,
+                         rows_ * sizeof(std::uint32_t), band);
+    }
+
+    void checkSize(const std::vector<std::uint32_t>& signature) const {
+        if (signature.size() != tables.size() * rows_)
+            throw std::invalid_argument("lsh_index: bad signature size");
+    }
+
+public:
+    lsh_index(std::size_t bands, std::size_t rows)
+        : tables(bands), rows_(rows) {
+        if (bands == 0 || rows == 0)
+            throw std::invalid_argument("lsh_index: no bands or rows");
+    }
+
+    // An index for signatures of numHashes values, with the bands and rows
+    // dividing it whose S-curve is steepest at threshold
+    static lsh_index for_threshold(std::size_t numHashes, double threshold) {
+        if (numHashes == 0 || !(threshold > 0 && threshold < 1))
+            throw std::invalid_argument("lsh_index::for_threshold");
+        std::size_t best = 1;
+        double bestError = 2;
+        for (std::size_t rows = 1; rows <= numHashes; ++rows) {
+            if (numHashes % rows != 0)
+                continue;
+            auto t = std::pow(1.0 / double(numHashes / rows), 1.0 / rows);
+            if (std::abs(t - threshold) < bestError) {
+                bestError = std::abs(t - threshold);
+                best = rows;
+            }
+        }
+        return lsh_index(numHashes / best, best);
+    }
+
+    void insert(std::uint64_t id, const std::vector<std::uint32_t>& signature) {
+        checkSize(signature);
+        for (std::size_t b = 0; b < tables.size(); ++b)
+            tables[b][bandHash(signature, b)].push_back(id);
+        ++size_;
+    }
+
+    // The ids of the signatures agreeing with signature on at least one
+    // band, in increasing order
+    std::vector<std::uint64_t>
+    candidates(const std::vector<std::uint32_t>& signature) const {
+        checkSize(signature);
+        std::vector<std::uint64_t> ret;
+        for (std::size_t b = 0; b < tables.size(); ++b) {
+            auto it = tables[b].find(bandHash(signature, b));
+            if (it != tables[b].end())
+                ret.insert(ret.end(), it->second.begin(), it->second.end());
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+
+    // Every pair of distinct ids agreeing on at least one band, smaller id
+    // first, in increasing order
+    std::vector<std::pair<std::uint64_t, std::uint64_t>>
+    candidate_pairs() const {
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> ret;
+        for (const auto& table : tables) {
+            for (const auto& bucket : table) {
+                const auto& ids = bucket.second;
+                for (std::size_t i = 0; i < ids.size(); ++i)
+                    for (std::size_t j = i + 1; j < ids.size(); ++j)
+                        if (ids[i] != ids[j])
+                            ret.emplace_back(std::min(ids[i], ids[j]),
+                                             std::max(ids[i], ids[j]));
+            }
+        }
+        std::sort(ret.begin(), ret.end());
+        ret.erase(std::unique(ret.begin(), ret.end()), ret.end());
+        return ret;
+    }
+
+    std::size_t bands() const noexcept { return tables.size(); }
+    std::size_t rows() const noexcept { return rows_; }
+
+    // The number of signatures inserted
+    std::size_t size() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+};
+
+// The SimHash (Charikar 2002) of the set of func(x) for x in [first, last):
+// bit b is set when more elements have bit b set in their hash than not.
+// Repeated elements count as many times as they appear.
+template <typename It, typename F>
+std::uint64_t simhash(It first, It last, F&& func) {
+    // Bit 8 * k + b of every hash is counted in byte k of counts[b], eight
+    // bits at once, and the bytes are flushed into ones before they overflow
+    constexpr std::uint64_t kLowBits = 0x0101010101010101ULL;
+    std::uint64_t ones[64] = {}, counts[8] = {};
+    auto flush = [&] {
+        for (unsigned b = 0; b < 8; ++b) {
+            for (unsigned k = 0; k < 8; ++k)
+                ones[8 * k + b] += (counts[b] >> (8 * k)) & 0xff;
+            counts[b] = 0;
+        }
+    };
+    std::uint64_t n = 0;
+    for (; first != last; ++first) {
+        auto h = lsh_detail::elementHash(0, func(*first));
+        for (unsigned b = 0; b < 8; ++b)
+            counts[b] += (h >> b) & kLowBits;
+        if (++n % 255 == 0)
+            flush();
+    }
+    flush();
+
+    std::uint64_t ret = 0;
+    for (unsigned b = 0; b < 64; ++b)
+        ret |= std::uint64_t(2 * ones[b] > n) << b;
+    return ret;
+}
+
+template <typename It>
+std::uint64_t simhash(It first, It last) {
+    return simhash(first, last, lsh_detail::Identity());
+}
+
+// SimHash with weights: bit b is set when the elements with bit b set in
+// their hash weigh more than the others
+template <typename It, typename F, typename W>
+std::uint64_t simhashWeighted(It first, It last, F&& func, W&& weight) {
+    double sums[64] = {};
+    for (; first != last; ++first) {
+        auto h = lsh_detail::elementHash(0, func(*first));
+        auto w = double(weight(*first));
+        for (unsigned b = 0; b < 64; ++b)
+            sums[b] += (h >> b) & 1 ? w : -w;
+    }
+    std::uint64_t ret = 0;
+    for (unsigned b = 0; b < 64; ++b)
+        ret |= std::uint64_t(sums[b] > 0) << b;
+    return ret;
+}
+
+// The number of bits that differ between two SimHashes. For sets seen as
+// vectors at an angle theta, it is about 64 * theta / pi.
+inline unsigned simhashDistance(std::uint64_t a, std::uint64_t b) noexcept {
+    return lsh_detail::popcount(a ^ b);
+}
+
+} // namespace util
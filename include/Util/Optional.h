@@ -9,11 +9,13 @@
 
 #pragma once
 
+#include "Util/Hashing.h"
 #include "Util/in_place.h"
 
 #include <cassert>
 #include <functional>
 #include <initializer_list>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
@@ -86,8 +88,9 @@
 #define OPTIONAL_CONSTEXPR_INIT_LIST
 #endif
 
-#if defined TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_ && (defined __cplusplus) &&    \
-    (__cplusplus != 201103L)
+#if (defined TR2_OPTIONAL_CLANG_3_5_AND_HIGHTER_ ||                            \
+     defined TR2_OPTIONAL_GCC_4_8_1_AND_HIGHER___) &&                          \
+    (defined __cplusplus) && (__cplusplus != 201103L)
 #define OPTIONAL_HAS_MOVE_ACCESSORS 1
 #else
 #define OPTIONAL_HAS_MOVE_ACCESSORS 0
@@ -100,6 +103,24 @@
 #define OPTIONAL_MUTABLE_CONSTEXPR constexpr
 #endif
 
+#// C++17 allows assigning a whole union in a constant expression, which is how
+#// trivially copyable values get (re)constructed at compile time. C++20 adds
+#// std::construct_at, which covers every literal type.
+#if (defined __cplusplus) && (__cplusplus >= 201703L)
+#define OPTIONAL_HAS_CONSTEXPR_MUTATION 1
+#define OPTIONAL_CONSTEXPR_MUTATION constexpr
+#else
+#define OPTIONAL_HAS_CONSTEXPR_MUTATION 0
+#define OPTIONAL_CONSTEXPR_MUTATION
+#endif
+#
+#if OPTIONAL_HAS_CONSTEXPR_MUTATION == 1 &&                                    \
+    defined __cpp_lib_constexpr_dynamic_alloc
+#define OPTIONAL_HAS_CONSTEXPR_CONSTRUCT_AT 1
+#else
+#define OPTIONAL_HAS_CONSTEXPR_CONSTRUCT_AT 0
+#endif
+
 namespace util {
 
 // BEGIN workaround for missing is_trivially_destructible
@@ -241,6 +262,33 @@ constexpr U convert(U v) {
     return v;
 }
 
+// Looked up from its own namespace so that the noexcept specification of
+// optional::swap does not find the member function itself
+namespace swap_adl_ {
+using std::swap;
+
+template <class T>
+struct is_nothrow_swappable {
+    constexpr static bool value =
+        noexcept(swap(std::declval<T&>(), std::declval<T&>()));
+};
+} // namespace swap_adl_
+
+// std::swap is only constexpr since C++20, so trivially copyable values are
+// swapped by hand to keep optional::swap usable in constant expressions.
+template <class T>
+constexpr void swap_values(T& lhs, T& rhs, std::true_type) noexcept {
+    T tmp = lhs;
+    lhs = rhs;
+    rhs = tmp;
+}
+
+template <class T>
+void swap_values(T& lhs, T& rhs, std::false_type) {
+    using std::swap;
+    swap(lhs, rhs);
+}
+
 } // namespace detail
 
 constexpr struct trivial_init_t {
@@ -317,6 +365,20 @@ struct optional_base {
         if (init_)
             storage_.value_.T::~T();
     }
+
+    template <class... Args>
+    void construct(Args&&... args) noexcept(
+        noexcept(T(std::forward<Args>(args)...))) {
+        ::new (static_cast<void*>(std::addressof(storage_.value_)))
+            T(std::forward<Args>(args)...);
+        init_ = true;
+    }
+
+    void destroy() noexcept {
+        if (init_)
+            storage_.value_.T::~T();
+        init_ = false;
+    }
 };
 
 template <class T>
@@ -345,6 +407,35 @@ struct constexpr_optional_base {
         : init_(true), storage_(il, std::forward<Args>(args)...) {}
 
     ~constexpr_optional_base() = default;
+
+    template <class... Args>
+    OPTIONAL_CONSTEXPR_MUTATION void construct(Args&&... args) noexcept(
+        noexcept(T(std::forward<Args>(args)...))) {
+#if OPTIONAL_HAS_CONSTEXPR_CONSTRUCT_AT == 1
+        std::construct_at(std::addressof(storage_.value_),
+                          std::forward<Args>(args)...);
+#else
+        construct_impl(std::is_trivially_copyable<T>{},
+                       std::forward<Args>(args)...);
+#endif
+        init_ = true;
+    }
+
+    // T is trivially destructible, so there is nothing to run here
+    OPTIONAL_CONSTEXPR_MUTATION void destroy() noexcept { init_ = false; }
+
+private:
+    template <class... Args>
+    OPTIONAL_CONSTEXPR_MUTATION void construct_impl(std::true_type,
+                                                    Args&&... args) {
+        storage_ = constexpr_storage_t<T>(std::forward<Args>(args)...);
+    }
+
+    template <class... Args>
+    void construct_impl(std::false_type, Args&&... args) {
+        ::new (static_cast<void*>(std::addressof(storage_.value_)))
+            T(std::forward<Args>(args)...);
+    }
 };
 
 template <class T>
@@ -365,7 +456,8 @@ class optional : private OptionalBase<T> {
     constexpr bool initialized() const noexcept {
         return OptionalBase<T>::init_;
     }
-    typename std::remove_const<T>::type* dataptr() {
+    OPTIONAL_CONSTEXPR_MUTATION typename std::remove_const<T>::type*
+    dataptr() {
         return std::addressof(OptionalBase<T>::storage_.value_);
     }
     constexpr const T* dataptr() const {
@@ -396,27 +488,23 @@ class optional : private OptionalBase<T> {
     T& contained_val() { return OptionalBase<T>::storage_.value_; }
 #endif
 
-    void clear() noexcept {
-        if (initialized())
-            dataptr()->T::~T();
-        OptionalBase<T>::init_ = false;
+    OPTIONAL_CONSTEXPR_MUTATION void clear() noexcept {
+        OptionalBase<T>::destroy();
     }
 
     template <class... Args>
-    void initialize(Args&&... args) noexcept(
+    OPTIONAL_CONSTEXPR_MUTATION void initialize(Args&&... args) noexcept(
         noexcept(T(std::forward<Args>(args)...))) {
         assert(!OptionalBase<T>::init_);
-        ::new (static_cast<void*>(dataptr())) T(std::forward<Args>(args)...);
-        OptionalBase<T>::init_ = true;
+        OptionalBase<T>::construct(std::forward<Args>(args)...);
     }
 
     template <class U, class... Args>
-    void initialize(std::initializer_list<U> il, Args&&... args) noexcept(
+    OPTIONAL_CONSTEXPR_MUTATION void
+    initialize(std::initializer_list<U> il, Args&&... args) noexcept(
         noexcept(T(il, std::forward<Args>(args)...))) {
         assert(!OptionalBase<T>::init_);
-        ::new (static_cast<void*>(dataptr()))
-            T(il, std::forward<Args>(args)...);
-        OptionalBase<T>::init_ = true;
+        OptionalBase<T>::construct(il, std::forward<Args>(args)...);
     }
 
 public:
@@ -426,20 +514,17 @@ public:
     constexpr optional() noexcept : OptionalBase<T>(){};
     constexpr optional(nullopt_t) noexcept : OptionalBase<T>(){};
 
-    optional(const optional& rhs) : OptionalBase<T>() {
-        if (rhs.initialized()) {
-            ::new (static_cast<void*>(dataptr())) T(*rhs);
-            OptionalBase<T>::init_ = true;
-        }
+    OPTIONAL_CONSTEXPR_MUTATION optional(const optional& rhs)
+        : OptionalBase<T>() {
+        if (rhs.initialized())
+            initialize(*rhs);
     }
 
-    optional(optional&& rhs) noexcept(
+    OPTIONAL_CONSTEXPR_MUTATION optional(optional&& rhs) noexcept(
         std::is_nothrow_move_constructible<T>::value)
         : OptionalBase<T>() {
-        if (rhs.initialized()) {
-            ::new (static_cast<void*>(dataptr())) T(std::move(*rhs));
-            OptionalBase<T>::init_ = true;
-        }
+        if (rhs.initialized())
+            initialize(std::move(*rhs));
     }
 
     constexpr optional(const T& v) : OptionalBase<T>(v) {}
@@ -462,12 +547,12 @@ public:
     ~optional() = default;
 
     // 20.5.4.3, assignment
-    optional& operator=(nullopt_t) noexcept {
+    OPTIONAL_CONSTEXPR_MUTATION optional& operator=(nullopt_t) noexcept {
         clear();
         return *this;
     }
 
-    optional& operator=(const optional& rhs) {
+    OPTIONAL_CONSTEXPR_MUTATION optional& operator=(const optional& rhs) {
         if (initialized() == true && rhs.initialized() == false)
             clear();
         else if (initialized() == false && rhs.initialized() == true)
@@ -477,7 +562,7 @@ public:
         return *this;
     }
 
-    optional& operator=(optional&& rhs) noexcept(
+    OPTIONAL_CONSTEXPR_MUTATION optional& operator=(optional&& rhs) noexcept(
         std::is_nothrow_move_assignable<T>::value&&
             std::is_nothrow_move_constructible<T>::value) {
         if (initialized() == true && rhs.initialized() == false)
@@ -490,7 +575,7 @@ public:
     }
 
     template <class U>
-    auto operator=(U&& v) -> typename std::enable_if<
+    OPTIONAL_CONSTEXPR_MUTATION auto operator=(U&& v) -> typename std::enable_if<
         std::is_same<typename std::decay<U>::type, T>::value, optional&>::type {
         if (initialized()) {
             contained_val() = std::forward<U>(v);
@@ -501,21 +586,24 @@ public:
     }
 
     template <class... Args>
-    void emplace(Args&&... args) {
+    OPTIONAL_CONSTEXPR_MUTATION void emplace(Args&&... args) {
         clear();
         initialize(std::forward<Args>(args)...);
     }
 
     template <class U, class... Args>
-    void emplace(std::initializer_list<U> il, Args&&... args) {
+    OPTIONAL_CONSTEXPR_MUTATION void emplace(std::initializer_list<U> il,
+                                             Args&&... args) {
         clear();
         initialize<U, Args...>(il, std::forward<Args>(args)...);
     }
 
+    OPTIONAL_CONSTEXPR_MUTATION void reset() noexcept { clear(); }
+
     // 20.5.4.4, Swap
-    void swap(optional<T>& rhs) noexcept(
-        std::is_nothrow_move_constructible<T>::value&& noexcept(
-            swap(std::declval<T&>(), std::declval<T&>()))) {
+    OPTIONAL_CONSTEXPR_MUTATION void swap(optional<T>& rhs) noexcept(
+        std::is_nothrow_move_constructible<T>::value&&
+            detail_::swap_adl_::is_nothrow_swappable<T>::value) {
         if (initialized() == true && rhs.initialized() == false) {
             rhs.initialize(std::move(**this));
             clear();
@@ -523,8 +611,8 @@ public:
             initialize(std::move(*rhs));
             rhs.clear();
         } else if (initialized() == true && rhs.initialized() == true) {
-            using std::swap;
-            swap(**this, *rhs);
+            detail_::swap_values(**this, *rhs,
+                                 std::is_trivially_copyable<T>{});
         }
     }
 
@@ -1011,7 +1099,8 @@ constexpr bool operator>=(const T& v, const optional<const T&>& x) {
 
 // 20.5.12, Specialized algorithms
 template <class T>
-void swap(optional<T>& x, optional<T>& y) noexcept(noexcept(x.swap(y))) {
+OPTIONAL_CONSTEXPR_MUTATION void
+swap(optional<T>& x, optional<T>& y) noexcept(noexcept(x.swap(y))) {
     x.swap(y);
 }
 
@@ -1025,26 +1114,71 @@ constexpr optional<X&> make_optional(std::reference_wrapper<X> v) {
     return optional<X&>(v.get());
 }
 
+namespace detail_ {
+
+// Hash values reported for disengaged optionals, and the offset added to the
+// hash of an engaged value before it is mixed. Keeping the two apart means
+// nullopt does not collide with T{} (whose std::hash is often 0).
+constexpr std::uint64_t optional_null_salt = 0x2f4a7c159e3779b9ULL;
+constexpr std::uint64_t optional_engaged_salt = 0x9e3779b97f4a7c15ULL;
+
+constexpr std::size_t hash_engaged(std::size_t h) noexcept {
+    return static_cast<std::size_t>(hash_mix(h + optional_engaged_salt));
+}
+
+} // namespace detail_
+
+// Hashes n optionals starting at first into out[0..n). The result is identical
+// to calling std::hash<optional<T>> on every element, but the work is split in
+// two passes over fixed-size blocks: the first one gathers the raw hashes of
+// the engaged values, the second one mixes a whole block and patches the nulls
+// with a select instead of a branch, which lets the compiler vectorize it.
+template <class T>
+void hash_many(const optional<T>* first, std::size_t n, std::size_t* out) {
+    constexpr std::size_t BlockSize = 64;
+    std::size_t raw[BlockSize];
+    std::size_t engaged[BlockSize];
+
+    while (n != 0) {
+        auto count = n < BlockSize ? n : BlockSize;
+        for (std::size_t i = 0; i < count; ++i) {
+            engaged[i] = static_cast<bool>(first[i]);
+            raw[i] = engaged[i] ? std::hash<T>{}(*first[i]) : 0;
+        }
+        for (std::size_t i = 0; i < count; ++i) {
+            auto mask = std::size_t{0} - engaged[i];
+            out[i] = (detail_::hash_engaged(raw[i]) & mask) |
+                     (static_cast<std::size_t>(detail_::optional_null_salt) &
+                      ~mask);
+        }
+        first += count;
+        out += count;
+        n -= count;
+    }
+}
+
 } // namespace util
 
 namespace std {
 template <typename T>
 struct hash<util::optional<T>> {
-    typedef typename hash<T>::result_type result_type;
+    typedef std::size_t result_type;
     typedef util::optional<T> argument_type;
 
     constexpr result_type operator()(argument_type const& arg) const {
-        return arg ? std::hash<T>{}(*arg) : result_type{};
+        return arg ? util::detail_::hash_engaged(std::hash<T>{}(*arg))
+                   : static_cast<result_type>(util::detail_::optional_null_salt);
     }
 };
 
 template <typename T>
 struct hash<util::optional<T&>> {
-    typedef typename hash<T>::result_type result_type;
+    typedef std::size_t result_type;
     typedef util::optional<T&> argument_type;
 
     constexpr result_type operator()(argument_type const& arg) const {
-        return arg ? std::hash<T>{}(*arg) : result_type{};
+        return arg ? util::detail_::hash_engaged(std::hash<T>{}(*arg))
+                   : static_cast<result_type>(util::detail_::optional_null_salt);
     }
 };
 }
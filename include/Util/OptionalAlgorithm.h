@@ -0,0 +1,282 @@
+#pragma once
+
+#include "Util/Optional.h"
+#include "Util/ThreadPool.h"
+
+#include <cstddef>
+#include <iterator>
+#include <limits>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// Algorithms over ranges of optional<T> that only look at the engaged
+// elements. Every algorithm comes in two flavours:
+//  - a sequential one taking [first, last)
+//  - a parallel one taking a ThreadPool& first, which needs random access
+//    iterators. The range is cut into chunks of a fixed size and partial
+//    results are combined in chunk order, so the result does not depend on
+//    the number of threads.
+//
+// For arithmetic T, sum_engaged, min_engaged and max_engaged do not branch on
+// engagement: disengaged elements are replaced by the identity of the
+// operation with a select, and four independent accumulators are kept, which
+// lets the compiler vectorize the loop.
+
+namespace detail_ {
+
+constexpr std::size_t optional_algorithm_chunk_size = 1 << 16;
+
+template <class RandomIt, class F>
+auto reduce_chunks(ThreadPool& pool, RandomIt first, RandomIt last, F&& fn)
+    -> std::vector<decltype(fn(first, last))> {
+    auto n = static_cast<std::size_t>(last - first);
+    auto numChunks = (n + optional_algorithm_chunk_size - 1) /
+                     optional_algorithm_chunk_size;
+    std::vector<decltype(fn(first, last))> partials(numChunks);
+    parallelFor(pool, numChunks, [&](std::size_t i) {
+        auto chunkFirst = first + i * optional_algorithm_chunk_size;
+        auto chunkLast = (i + 1 == numChunks)
+                             ? last
+                             : chunkFirst + optional_algorithm_chunk_size;
+        partials[i] = fn(chunkFirst, chunkLast);
+    });
+    return partials;
+}
+
+template <class T>
+struct min_op {
+    constexpr static T identity() {
+        return std::numeric_limits<T>::has_infinity
+                   ? std::numeric_limits<T>::infinity()
+                   : std::numeric_limits<T>::max();
+    }
+    constexpr static T apply(T x, T y) { return y < x ? y : x; }
+};
+
+template <class T>
+struct max_op {
+    constexpr static T identity() {
+        return std::numeric_limits<T>::has_infinity
+                   ? -std::numeric_limits<T>::infinity()
+                   : std::numeric_limits<T>::lowest();
+    }
+    constexpr static T apply(T x, T y) { return x < y ? y : x; }
+};
+
+template <class T>
+struct sum_op {
+    constexpr static T identity() { return T(); }
+    constexpr static T apply(T x, T y) { return x + y; }
+};
+
+// Branchless reduction over random access ranges of optionals of arithmetic
+// types. Returns the reduced value and whether any element was engaged.
+template <class Op, class RandomIt>
+auto masked_reduce(RandomIt first, RandomIt last)
+    -> std::pair<typename std::iterator_traits<RandomIt>::value_type::value_type,
+                 bool> {
+    using T = typename std::iterator_traits<RandomIt>::value_type::value_type;
+    auto n = static_cast<std::size_t>(last - first);
+
+    T acc0 = Op::identity(), acc1 = acc0, acc2 = acc0, acc3 = acc0;
+    bool any = false;
+    std::size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        const auto& o0 = first[i];
+        const auto& o1 = first[i + 1];
+        const auto& o2 = first[i + 2];
+        const auto& o3 = first[i + 3];
+        acc0 = Op::apply(acc0, o0.value_or(Op::identity()));
+        acc1 = Op::apply(acc1, o1.value_or(Op::identity()));
+        acc2 = Op::apply(acc2, o2.value_or(Op::identity()));
+        acc3 = Op::apply(acc3, o3.value_or(Op::identity()));
+        any |= bool(o0) | bool(o1) | bool(o2) | bool(o3);
+    }
+    for (; i < n; ++i) {
+        acc0 = Op::apply(acc0, first[i].value_or(Op::identity()));
+        any |= bool(first[i]);
+    }
+    return {Op::apply(Op::apply(acc0, acc1), Op::apply(acc2, acc3)), any};
+}
+
+template <class Op, class RandomIt>
+auto masked_reduce(ThreadPool& pool, RandomIt first, RandomIt last)
+    -> decltype(masked_reduce<Op>(first, last)) {
+    auto partials = reduce_chunks(pool, first, last, [](RandomIt f, RandomIt l) {
+        return masked_reduce<Op>(f, l);
+    });
+    auto ret = decltype(masked_reduce<Op>(first, last)){Op::identity(), false};
+    for (auto& p : partials) {
+        ret.first = Op::apply(ret.first, p.first);
+        ret.second |= p.second;
+    }
+    return ret;
+}
+
+template <class Op, class It>
+auto branchy_reduce(It first, It last)
+    -> optional<typename std::iterator_traits<It>::value_type::value_type> {
+    using T = typename std::iterator_traits<It>::value_type::value_type;
+    optional<T> ret;
+    for (; first != last; ++first) {
+        if (*first)
+            ret = ret ? Op::apply(*ret, **first) : **first;
+    }
+    return ret;
+}
+
+template <class It>
+using optional_value_t =
+    typename std::iterator_traits<It>::value_type::value_type;
+
+template <class It>
+using use_masked_reduce = std::integral_constant<
+    bool, std::is_arithmetic<optional_value_t<It>>::value &&
+              std::is_base_of<std::random_access_iterator_tag,
+                              typename std::iterator_traits<
+                                  It>::iterator_category>::value>;
+
+template <class Op, class It>
+optional<optional_value_t<It>> reduce_engaged(It first, It last,
+                                              std::true_type) {
+    auto r = masked_reduce<Op>(first, last);
+    return r.second ? optional<optional_value_t<It>>(r.first) : nullopt;
+}
+
+template <class Op, class It>
+optional<optional_value_t<It>> reduce_engaged(It first, It last,
+                                              std::false_type) {
+    return branchy_reduce<Op>(first, last);
+}
+
+} // namespace detail_
+
+// Folds transform(*o) into init for every engaged o in [first, last), in
+// order
+template <class InputIt, class T, class BinaryOp, class UnaryOp>
+T transform_reduce_engaged(InputIt first, InputIt last, T init,
+                           BinaryOp reduce, UnaryOp transform) {
+    for (; first != last; ++first) {
+        if (*first)
+            init = reduce(std::move(init), transform(**first));
+    }
+    return init;
+}
+
+// Parallel version: reduce must be associative. Chunks are reduced
+// independently and folded into init in chunk order.
+template <class RandomIt, class T, class BinaryOp, class UnaryOp>
+T transform_reduce_engaged(ThreadPool& pool, RandomIt first, RandomIt last,
+                           T init, BinaryOp reduce, UnaryOp transform) {
+    using ResultType =
+        typename std::decay<decltype(transform(**first))>::type;
+    auto partials = detail_::reduce_chunks(
+        pool, first, last, [&](RandomIt f, RandomIt l) {
+            optional<ResultType> acc;
+            for (; f != l; ++f) {
+                if (*f)
+                    acc = acc ? ResultType(reduce(std::move(*acc), transform(**f)))
+                              : ResultType(transform(**f));
+            }
+            return acc;
+        });
+    for (auto& p : partials) {
+        if (p)
+            init = reduce(std::move(init), std::move(*p));
+    }
+    return init;
+}
+
+// Copies the engaged values of [first, last) to out, in order, and returns
+// the end of the output
+template <class InputIt, class OutputIt>
+OutputIt filter_engaged(InputIt first, InputIt last, OutputIt out) {
+    for (; first != last; ++first) {
+        if (*first)
+            *out++ = **first;
+    }
+    return out;
+}
+
+// Parallel version: counts the engaged values of each chunk, then copies every
+// chunk to its final position. out must be a random access iterator.
+template <class RandomIt, class RandomOutputIt>
+RandomOutputIt filter_engaged(ThreadPool& pool, RandomIt first, RandomIt last,
+                              RandomOutputIt out) {
+    auto counts = detail_::reduce_chunks(
+        pool, first, last, [](RandomIt f, RandomIt l) {
+            std::size_t count = 0;
+            for (; f != l; ++f)
+                count += bool(*f);
+            return count;
+        });
+
+    std::vector<std::size_t> offsets(counts.size() + 1, 0);
+    for (std::size_t i = 0; i < counts.size(); ++i)
+        offsets[i + 1] = offsets[i] + counts[i];
+
+    auto chunk = detail_::optional_algorithm_chunk_size;
+    auto n = static_cast<std::size_t>(last - first);
+    parallelFor(pool, counts.size(), [&](std::size_t i) {
+        auto chunkFirst = first + i * chunk;
+        auto chunkLast = (i + 1 == counts.size()) ? first + n : chunkFirst + chunk;
+        filter_engaged(chunkFirst, chunkLast, out + offsets[i]);
+    });
+    return out + offsets.back();
+}
+
+// Sum of the engaged values, T() if there is none
+template <class It>
+detail_::optional_value_t<It> sum_engaged(It first, It last) {
+    return detail_::reduce_engaged<detail_::sum_op<detail_::optional_value_t<It>>>(
+               first, last, detail_::use_masked_reduce<It>{})
+        .value_or(detail_::optional_value_t<It>());
+}
+
+template <class RandomIt>
+detail_::optional_value_t<RandomIt> sum_engaged(ThreadPool& pool,
+                                                RandomIt first, RandomIt last) {
+    using T = detail_::optional_value_t<RandomIt>;
+    static_assert(std::is_arithmetic<T>::value,
+                  "parallel sum_engaged needs an arithmetic type");
+    return detail_::masked_reduce<detail_::sum_op<T>>(pool, first, last).first;
+}
+
+// Smallest engaged value, nullopt if there is none
+template <class It>
+optional<detail_::optional_value_t<It>> min_engaged(It first, It last) {
+    return detail_::reduce_engaged<detail_::min_op<detail_::optional_value_t<It>>>(
+        first, last, detail_::use_masked_reduce<It>{});
+}
+
+template <class RandomIt>
+optional<detail_::optional_value_t<RandomIt>>
+min_engaged(ThreadPool& pool, RandomIt first, RandomIt last) {
+    using T = detail_::optional_value_t<RandomIt>;
+    static_assert(std::is_arithmetic<T>::value,
+                  "parallel min_engaged needs an arithmetic type");
+    auto r = detail_::masked_reduce<detail_::min_op<T>>(pool, first, last);
+    return r.second ? optional<T>(r.first) : nullopt;
+}
+
+// Largest engaged value, nullopt if there is none
+template <class It>
+optional<detail_::optional_value_t<It>> max_engaged(It first, It last) {
+    return detail_::reduce_engaged<detail_::max_op<detail_::optional_value_t<It>>>(
+        first, last, detail_::use_masked_reduce<It>{});
+}
+
+template <class RandomIt>
+optional<detail_::optional_value_t<RandomIt>>
+max_engaged(ThreadPool& pool, RandomIt first, RandomIt last) {
+    using T = detail_::optional_value_t<RandomIt>;
+    static_assert(std::is_arithmetic<T>::value,
+                  "parallel max_engaged needs an arithmetic type");
+    auto r = detail_::masked_reduce<detail_::max_op<T>>(pool, first, last);
+    return r.second ? optional<T>(r.first) : nullopt;
+}
+
+} // namespace util
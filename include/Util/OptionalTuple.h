@@ -0,0 +1,337 @@
+#pragma once
+
+#include "Util/Optional.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace util {
+
+// basic_optional_tuple<Reorder, Ts...> behaves like a std::tuple of
+// optional<Ts>..., but all the engagement flags share a single bitmask and the
+// values are packed back to back instead of each one dragging along its own
+// padded bool. With Reorder set, the values are laid out by decreasing
+// alignment, which leaves no padding between them at all.
+//
+// Copying, moving and destroying only touch the engaged fields: the mask is
+// walked bit by bit and each set bit is dispatched through a table of
+// per-field functions. When every field is trivially copyable the whole
+// buffer is copied at once instead.
+//
+// Prefer the two aliases below:
+//  - optional_tuple<Ts...>: reordered by alignment, the compact default
+//  - ordered_optional_tuple<Ts...>: fields kept in declaration order
+template <bool Reorder, class... Ts>
+class basic_optional_tuple;
+
+template <class... Ts>
+using optional_tuple = basic_optional_tuple<true, Ts...>;
+
+template <class... Ts>
+using ordered_optional_tuple = basic_optional_tuple<false, Ts...>;
+
+namespace detail_ {
+
+template <std::size_t N>
+struct optional_tuple_layout {
+    std::size_t offset[N];
+    std::size_t size;
+};
+
+template <bool Reorder, class... Ts>
+constexpr optional_tuple_layout<sizeof...(Ts)> make_optional_tuple_layout() {
+    constexpr std::size_t N = sizeof...(Ts);
+    constexpr std::size_t sizes[] = {sizeof(Ts)...};
+    constexpr std::size_t aligns[] = {alignof(Ts)...};
+
+    optional_tuple_layout<N> ret{};
+    std::size_t offset = 0;
+    if (Reorder) {
+        // Alignments are powers of two and every size is a multiple of its
+        // alignment, so placing the most aligned fields first never pads
+        std::size_t maxAlign = 1;
+        for (std::size_t i = 0; i < N; ++i)
+            if (aligns[i] > maxAlign)
+                maxAlign = aligns[i];
+        for (std::size_t a = maxAlign; a != 0; a /= 2) {
+            for (std::size_t i = 0; i < N; ++i) {
+                if (aligns[i] == a) {
+                    ret.offset[i] = offset;
+                    offset += sizes[i];
+                }
+            }
+        }
+    } else {
+        for (std::size_t i = 0; i < N; ++i) {
+            offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+            ret.offset[i] = offset;
+            offset += sizes[i];
+        }
+    }
+    ret.size = offset;
+    return ret;
+}
+
+template <std::size_t N>
+using optional_tuple_mask_t = typename std::conditional<
+    (N <= 8), std::uint8_t,
+    typename std::conditional<
+        (N <= 16), std::uint16_t,
+        typename std::conditional<(N <= 32), std::uint32_t,
+                                  std::uint64_t>::type>::type>::type;
+
+inline unsigned count_trailing_zeros(std::uint64_t x) {
+#if defined __GNUC__
+    return static_cast<unsigned>(__builtin_ctzll(x));
+#else
+    unsigned ret = 0;
+    while ((x & 1) == 0) {
+        x >>= 1;
+        ++ret;
+    }
+    return ret;
+#endif
+}
+
+template <class... Ts>
+struct all_of_traits;
+
+template <>
+struct all_of_traits<> {
+    constexpr static bool trivially_copyable = true;
+    constexpr static bool trivially_destructible = true;
+};
+
+template <class T, class... Ts>
+struct all_of_traits<T, Ts...> {
+    constexpr static bool trivially_copyable =
+        std::is_trivially_copyable<T>::value &&
+        all_of_traits<Ts...>::trivially_copyable;
+    constexpr static bool trivially_destructible =
+        std::is_trivially_destructible<T>::value &&
+        all_of_traits<Ts...>::trivially_destructible;
+};
+
+} // namespace detail_
+
+template <bool Reorder, class... Ts>
+class basic_optional_tuple {
+    static_assert(sizeof...(Ts) > 0, "optional_tuple needs at least one field");
+    static_assert(sizeof...(Ts) <= 64,
+                  "optional_tuple supports at most 64 fields");
+
+public:
+    using mask_type = detail_::optional_tuple_mask_t<sizeof...(Ts)>;
+
+    template <std::size_t I>
+    using element_type = typename std::tuple_element<I, std::tuple<Ts...>>::type;
+
+private:
+    using traits = detail_::all_of_traits<Ts...>;
+    using indices = std::index_sequence_for<Ts...>;
+
+    static constexpr std::size_t offset_of(std::size_t i) {
+        return detail_::make_optional_tuple_layout<Reorder, Ts...>().offset[i];
+    }
+
+    template <std::size_t I>
+    static element_type<I>* ptr(unsigned char* data) {
+        return reinterpret_cast<element_type<I>*>(
+            data + std::integral_constant<std::size_t, offset_of(I)>::value);
+    }
+
+    template <std::size_t I>
+    static const element_type<I>* ptr(const unsigned char* data) {
+        return reinterpret_cast<const element_type<I>*>(
+            data + std::integral_constant<std::size_t, offset_of(I)>::value);
+    }
+
+    // Calls fn(i) for every set bit i of mask, lowest first
+    template <class F>
+    static void for_each_engaged(mask_type mask, F&& fn) {
+        std::uint64_t m = mask;
+        while (m != 0) {
+            fn(detail_::count_trailing_zeros(m));
+            m &= m - 1;
+        }
+    }
+
+    template <std::size_t I>
+    static void destroy_at(unsigned char* data) {
+        using T = element_type<I>;
+        ptr<I>(data)->T::~T();
+    }
+
+    template <std::size_t I>
+    static void copy_at(unsigned char* dst, const unsigned char* src) {
+        ::new (static_cast<void*>(ptr<I>(dst))) element_type<I>(*ptr<I>(src));
+    }
+
+    template <std::size_t I>
+    static void move_at(unsigned char* dst, unsigned char* src) {
+        ::new (static_cast<void*>(ptr<I>(dst)))
+            element_type<I>(std::move(*ptr<I>(src)));
+    }
+
+    template <std::size_t... Is>
+    void destroy_engaged(std::index_sequence<Is...>) noexcept {
+        using fn_type = void (*)(unsigned char*);
+        static constexpr fn_type fns[] = {&destroy_at<Is>...};
+        for_each_engaged(mask_, [this](unsigned i) { fns[i](data_); });
+    }
+
+    template <std::size_t... Is>
+    void copy_engaged(std::index_sequence<Is...>,
+                      const basic_optional_tuple& rhs) {
+        using fn_type = void (*)(unsigned char*, const unsigned char*);
+        static constexpr fn_type fns[] = {&copy_at<Is>...};
+        for_each_engaged(rhs.mask_, [this, &rhs](unsigned i) {
+            fns[i](data_, rhs.data_);
+            mask_ |= mask_type(1) << i;
+        });
+    }
+
+    template <std::size_t... Is>
+    void move_engaged(std::index_sequence<Is...>, basic_optional_tuple& rhs) {
+        using fn_type = void (*)(unsigned char*, unsigned char*);
+        static constexpr fn_type fns[] = {&move_at<Is>...};
+        for_each_engaged(rhs.mask_, [this, &rhs](unsigned i) {
+            fns[i](data_, rhs.data_);
+            mask_ |= mask_type(1) << i;
+        });
+    }
+
+    void clear() noexcept {
+        if (!traits::trivially_destructible)
+            destroy_engaged(indices{});
+        mask_ = 0;
+    }
+
+    void copy_from(const basic_optional_tuple& rhs) {
+        if (traits::trivially_copyable) {
+            std::memcpy(data_, rhs.data_, sizeof(data_));
+            mask_ = rhs.mask_;
+        } else {
+            copy_engaged(indices{}, rhs);
+        }
+    }
+
+    void move_from(basic_optional_tuple& rhs) {
+        if (traits::trivially_copyable) {
+            std::memcpy(data_, rhs.data_, sizeof(data_));
+            mask_ = rhs.mask_;
+        } else {
+            move_engaged(indices{}, rhs);
+        }
+    }
+
+    alignas(Ts...) unsigned char
+        data_[detail_::make_optional_tuple_layout<Reorder, Ts...>().size];
+    mask_type mask_;
+
+public:
+    static constexpr std::size_t size() noexcept { return sizeof...(Ts); }
+
+    basic_optional_tuple() noexcept : mask_(0) {}
+
+    basic_optional_tuple(const basic_optional_tuple& rhs) : mask_(0) {
+        copy_from(rhs);
+    }
+
+    basic_optional_tuple(basic_optional_tuple&& rhs) : mask_(0) {
+        move_from(rhs);
+    }
+
+    // Assignment is destroy-then-copy, so it offers the basic exception
+    // guarantee only
+    basic_optional_tuple& operator=(const basic_optional_tuple& rhs) {
+        if (this != &rhs) {
+            clear();
+            copy_from(rhs);
+        }
+        return *this;
+    }
+
+    basic_optional_tuple& operator=(basic_optional_tuple&& rhs) {
+        if (this != &rhs) {
+            clear();
+            move_from(rhs);
+        }
+        return *this;
+    }
+
+    ~basic_optional_tuple() {
+        if (!traits::trivially_destructible)
+            destroy_engaged(indices{});
+    }
+
+    // Bit I is set iff field I is engaged
+    mask_type mask() const noexcept { return mask_; }
+
+    template <std::size_t I>
+    bool has_value() const noexcept {
+        return (mask_ >> I) & 1;
+    }
+
+    template <std::size_t I>
+    optional<element_type<I>&> get() noexcept {
+        return has_value<I>() ? optional<element_type<I>&>(*ptr<I>(data_))
+                              : optional<element_type<I>&>();
+    }
+
+    template <std::size_t I>
+    optional<const element_type<I>&> get() const noexcept {
+        return has_value<I>()
+                   ? optional<const element_type<I>&>(*ptr<I>(data_))
+                   : optional<const element_type<I>&>();
+    }
+
+    template <std::size_t I, class... Args>
+    element_type<I>& emplace(Args&&... args) {
+        reset<I>();
+        auto p = ::new (static_cast<void*>(ptr<I>(data_)))
+            element_type<I>(std::forward<Args>(args)...);
+        mask_ |= mask_type(1) << I;
+        return *p;
+    }
+
+    template <std::size_t I, class U>
+    element_type<I>& set(U&& v) {
+        if (has_value<I>()) {
+            auto& ref = *ptr<I>(data_);
+            ref = std::forward<U>(v);
+            return ref;
+        }
+        return emplace<I>(std::forward<U>(v));
+    }
+
+    template <std::size_t I>
+    void reset() noexcept {
+        if (has_value<I>()) {
+            destroy_at<I>(data_);
+            mask_ &= ~(mask_type(1) << I);
+        }
+    }
+
+    void reset() noexcept { clear(); }
+};
+
+template <std::size_t I, bool Reorder, class... Ts>
+optional<typename basic_optional_tuple<Reorder, Ts...>::template element_type<I>&>
+get(basic_optional_tuple<Reorder, Ts...>& t) noexcept {
+    return t.template get<I>();
+}
+
+template <std::size_t I, bool Reorder, class... Ts>
+optional<const typename basic_optional_tuple<
+    Reorder, Ts...>::template element_type<I>&>
+get(const basic_optional_tuple<Reorder, Ts...>& t) noexcept {
+    return t.template get<I>();
+}
+
+} // namespace util
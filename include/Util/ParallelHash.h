@@ -0,0 +1,315 @@
+#pragma once
+
+#include "Util/Hashing.h"
+#include "Util/ThreadPool.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// Hashing of very large inputs spread over a ThreadPool:
+//  - hashUnordered(pool, c) returns the same value as hashUnordered(c)
+//  - parallelHashRange and parallelHashContainer cut a sequence into chunks
+//    of chunkSize elements, hash the chunks on the pool and combine their
+//    hashes pairwise up a binary tree whose shape only depends on the number
+//    of chunks. The result therefore depends on chunkSize but not on the
+//    number of threads. It differs from hashRange over the same elements.
+//  - MerkleHashTree keeps the whole tree of chunk hashes, so that after a
+//    localized change only the modified chunks and their ancestors need
+//    rehashing. Its root equals parallelHashRange with the same chunk size.
+//
+// Example:
+//
+//  ThreadPool pool;
+//  auto fingerprint = parallelHashContainer(pool, buffer, 1 << 20);
+//
+//  MerkleHashTree tree(1 << 20);
+//  tree.build(pool, buffer.data(), buffer.data() + buffer.size());
+//  std::memcpy(&buffer[pos], patch.data(), patch.size());
+//  tree.update(buffer.data(), buffer.data() + buffer.size(), pos,
+//              patch.size());
+//  auto newFingerprint = tree.root();
+
+namespace hash_detail {
+
+// Below this many elements the work is not worth handing out
+constexpr std::size_t kParallelUnorderedMin = 1 << 15;
+
+template <typename C, typename = void>
+struct has_bucket_interface : std::false_type {};
+
+template <typename C>
+struct has_bucket_interface<
+    C, void_t<decltype(std::declval<const C&>().bucket_count()),
+              decltype(std::declval<const C&>().begin(std::size_t(0)))>>
+    : std::true_type {};
+
+template <typename C>
+using has_random_access_iterators = std::is_base_of<
+    std::random_access_iterator_tag,
+    typename std::iterator_traits<typename C::const_iterator>::iterator_category>;
+
+template <typename F>
+UnorderedAccumulator reduceUnordered(ThreadPool& pool, std::size_t numChunks,
+                                     F&& accumulateChunk) {
+    std::vector<UnorderedAccumulator> partials(numChunks);
+    parallelFor(pool, numChunks,
+                [&](std::size_t i) { partials[i] = accumulateChunk(i); });
+    UnorderedAccumulator ret;
+    for (const auto& p : partials)
+        ret.merge(p);
+    return ret;
+}
+
+// Hash tables are cut along their buckets
+template <typename Policy, typename C>
+std::size_t hashUnorderedParallel(ThreadPool& pool, const C& container,
+                                  std::true_type, std::false_type) {
+    auto buckets = container.bucket_count();
+    auto numChunks = std::min(buckets, (pool.size() + 1) * 4);
+    auto acc = reduceUnordered(pool, numChunks, [&](std::size_t i) {
+        UnorderedAccumulator chunk;
+        auto last = buckets * (i + 1) / numChunks;
+        for (auto b = buckets * i / numChunks; b < last; ++b)
+            chunk.merge(accumulateUnordered<Policy>(container.begin(b),
+                                                    container.end(b)));
+        return chunk;
+    });
+    return acc.finish(Policy::seed());
+}
+
+// Random access containers along their indices
+template <typename Policy, typename C, typename HasBuckets>
+std::size_t hashUnorderedParallel(ThreadPool& pool, const C& container,
+                                  HasBuckets, std::true_type) {
+    auto first = container.begin();
+    auto n = container.size();
+    auto numChunks = (pool.size() + 1) * 4;
+    auto acc = reduceUnordered(pool, numChunks, [&](std::size_t i) {
+        return accumulateUnordered<Policy>(first + n * i / numChunks,
+                                           first + n * (i + 1) / numChunks);
+    });
+    return acc.finish(Policy::seed());
+}
+
+// Anything else is walked sequentially
+template <typename Policy, typename C>
+std::size_t hashUnorderedParallel(ThreadPool&, const C& container,
+                                  std::false_type, std::false_type) {
+    return hashUnorderedWith<Policy>(container);
+}
+
+// The parent of two nodes of a chunk tree. An odd node at the end of a level
+// is carried up unchanged.
+inline std::uint64_t treeNode(std::uint64_t left, std::uint64_t right) noexcept {
+    return Hasher(kPrime3).addHash(left).addHash(right).finish();
+}
+
+// Binds the root to the length of the sequence, so that a trailing partial
+// chunk and its zero-padded version hash differently
+inline std::size_t treeRoot(std::uint64_t top, std::size_t length) noexcept {
+    return Hasher(0).addHash(top).addHash(length).finish();
+}
+
+// Replaces level by the level above it
+inline void reduceLevel(std::vector<std::uint64_t>& level) {
+    auto n = level.size();
+    for (std::size_t i = 0; i < n / 2; ++i)
+        level[i] = treeNode(level[2 * i], level[2 * i + 1]);
+    if (n % 2)
+        level[n / 2] = level[n - 1];
+    level.resize((n + 1) / 2);
+}
+
+template <typename It>
+std::uint64_t chunkHash(It first, std::size_t length, std::size_t chunkSize,
+                        std::size_t i) {
+    auto begin = i * chunkSize;
+    auto end = std::min(begin + chunkSize, length);
+    return hashRange(first + begin, first + end);
+}
+
+template <typename It>
+std::size_t numChunks(It first, It last, std::size_t chunkSize) {
+    auto length = static_cast<std::size_t>(last - first);
+    return (length + chunkSize - 1) / chunkSize;
+}
+
+template <typename C>
+auto contiguousBegin(const C& c, std::true_type) {
+    return c.data();
+}
+
+template <typename C>
+auto contiguousBegin(const C& c, std::false_type) {
+    using std::begin;
+    return begin(c);
+}
+
+} // namespace hash_detail
+
+// Same as hashUnordered(container), with the elements split between the
+// threads of pool
+template <typename Policy = DefaultHashPolicy, typename T>
+std::size_t hashUnordered(ThreadPool& pool, const T& container) {
+    if (container.size() < hash_detail::kParallelUnorderedMin)
+        return hash_detail::hashUnorderedWith<Policy>(container);
+    return hash_detail::hashUnorderedParallel<Policy>(
+        pool, container, hash_detail::has_bucket_interface<T>{},
+        hash_detail::has_random_access_iterators<T>{});
+}
+
+// Hashes the random access range [first, last) in chunks of chunkSize
+// elements (chunkSize > 0). As with hashRange, ranges of uniquely represented
+// values given as pointers are hashed as raw bytes.
+template <typename It>
+std::size_t parallelHashRange(ThreadPool& pool, It first, It last,
+                              std::size_t chunkSize) {
+    auto length = static_cast<std::size_t>(last - first);
+    std::vector<std::uint64_t> level(
+        hash_detail::numChunks(first, last, chunkSize));
+    parallelFor(pool, level.size(), [&](std::size_t i) {
+        level[i] = hash_detail::chunkHash(first, length, chunkSize, i);
+    });
+    while (level.size() > 1)
+        hash_detail::reduceLevel(level);
+    return hash_detail::treeRoot(level.empty() ? 0 : level[0], length);
+}
+
+// Contiguous containers are hashed through their data() pointer
+template <typename T>
+std::size_t parallelHashContainer(ThreadPool& pool, const T& container,
+                                  std::size_t chunkSize) {
+    auto first = hash_detail::contiguousBegin(
+        container, is_contiguous_container<T>{});
+    return parallelHashRange(pool, first, first + container.size(), chunkSize);
+}
+
+// The tree of chunk hashes of a sequence. levels[0] holds the chunk hashes
+// and every level above holds the parents of the one below, up to a single
+// node.
+class MerkleHashTree {
+private:
+    std::vector<std::vector<std::uint64_t>> levels;
+    std::size_t chunkLen;
+    std::size_t length = 0;
+
+    void buildLevels() {
+        levels.resize(1);
+        while (levels.back().size() > 1) {
+            auto next = levels.back();
+            hash_detail::reduceLevel(next);
+            levels.push_back(std::move(next));
+        }
+    }
+
+    // Recomputes the ancestors of chunks [lo, hi]
+    void propagate(std::size_t lo, std::size_t hi) {
+        for (std::size_t l = 1; l < levels.size(); ++l) {
+            lo /= 2;
+            hi /= 2;
+            const auto& below = levels[l - 1];
+            for (auto i = lo; i <= hi; ++i)
+                levels[l][i] = 2 * i + 1 < below.size()
+                                   ? hash_detail::treeNode(below[2 * i],
+                                                           below[2 * i + 1])
+                                   : below[2 * i];
+        }
+    }
+
+    void diff(const MerkleHashTree& other, std::size_t level, std::size_t i,
+              std::vector<std::size_t>& out) const {
+        if (levels[level][i] == other.levels[level][i])
+            return;
+        if (level == 0) {
+            out.push_back(i);
+            return;
+        }
+        for (auto c = 2 * i; c < 2 * i + 2 && c < levels[level - 1].size(); ++c)
+            diff(other, level - 1, c, out);
+    }
+
+    template <typename It, typename ForEach>
+    void rehash(It first, It last, std::size_t pos, std::size_t count,
+                ForEach&& forEach) {
+        if (count == 0 || levels[0].empty())
+            return;
+        auto lo = pos / chunkLen;
+        auto hi = std::min((pos + count - 1) / chunkLen, levels[0].size() - 1);
+        auto len = static_cast<std::size_t>(last - first);
+        forEach(hi - lo + 1, [&](std::size_t i) {
+            levels[0][lo + i] =
+                hash_detail::chunkHash(first, len, chunkLen, lo + i);
+        });
+        propagate(lo, hi);
+    }
+
+public:
+    // chunkSize must be positive
+    explicit MerkleHashTree(std::size_t chunkSize) : chunkLen(chunkSize) {}
+
+    // Hashes all the chunks of [first, last) on the pool
+    template <typename It>
+    void build(ThreadPool& pool, It first, It last) {
+        length = static_cast<std::size_t>(last - first);
+        levels.assign(1, std::vector<std::uint64_t>(
+                             hash_detail::numChunks(first, last, chunkLen)));
+        auto& leaves = levels[0];
+        parallelFor(pool, leaves.size(), [&](std::size_t i) {
+            leaves[i] = hash_detail::chunkHash(first, length, chunkLen, i);
+        });
+        buildLevels();
+    }
+
+    // Rehashes the chunks overlapping elements [pos, pos + count) after they
+    // were modified in place. [first, last) must be the range the tree was
+    // built from, with the same length; rebuild the tree if it changed.
+    template <typename It>
+    void update(It first, It last, std::size_t pos, std::size_t count) {
+        rehash(first, last, pos, count, [](std::size_t n, auto&& fn) {
+            for (std::size_t i = 0; i < n; ++i)
+                fn(i);
+        });
+    }
+
+    // Same, with the chunks rehashed on the pool
+    template <typename It>
+    void update(ThreadPool& pool, It first, It last, std::size_t pos,
+                std::size_t count) {
+        rehash(first, last, pos, count, [&pool](std::size_t n, auto&& fn) {
+            parallelFor(pool, n, fn);
+        });
+    }
+
+    // Equal to parallelHashRange(pool, first, last, chunkSize())
+    std::size_t root() const noexcept {
+        auto top = levels.empty() || levels.back().empty() ? 0
+                                                           : levels.back()[0];
+        return hash_detail::treeRoot(top, length);
+    }
+
+    std::size_t chunkSize() const noexcept { return chunkLen; }
+    std::size_t size() const noexcept { return length; }
+    std::size_t numChunks() const noexcept {
+        return levels.empty() ? 0 : levels[0].size();
+    }
+    std::uint64_t chunkHash(std::size_t i) const { return levels[0][i]; }
+
+    // The indices of the chunks that differ between two trees of the same
+    // shape, found by descending from the root through the differing nodes
+    // only
+    std::vector<std::size_t> changedChunks(const MerkleHashTree& other) const {
+        std::vector<std::size_t> ret;
+        if (numChunks() > 0)
+            diff(other, levels.size() - 1, 0, ret);
+        return ret;
+    }
+};
+
+} // namespace util
@@ -0,0 +1,511 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// perfect_hash_map<K, V, Hash, Eq> is a read-only map over a set of keys
+// known up front, such as enum names, command verbs or configuration keys.
+// It is built once, with a minimal perfect hash function in the style of CHD
+// ("hash, displace and compress"):
+//  - the keys are spread over about n / 4 buckets by their hash, unevenly
+//    on purpose (60% of them land in the first 30% of the buckets)
+//  - going from the largest bucket to the smallest, each bucket is given the
+//    first displacement d for which the slots its keys hash to, given d, are
+//    all distinct and still free
+// Every key then owns one of exactly n slots, so a lookup hashes the key,
+// reads the displacement of its bucket, and compares against the single slot
+// this gives. There are no empty slots and no collisions to walk through.
+// The table holds the n elements plus one 32-bit displacement per bucket.
+//
+// Building takes expected O(n) time for typical sets; it throws
+// std::invalid_argument if two keys are equal, or if Hash maps two distinct
+// keys to the same value, since no displacement can separate those.
+//
+// As in flat_hash_map, find, count, contains and at accept any key type Hash
+// and Eq accept when both define is_transparent.
+//
+// static_perfect_hash_map<K, V, N, Hash, Eq> is the same table over a fixed
+// number of keys, with no allocations, and its constructor is constexpr: for
+// a constexpr key list whose Hash and Eq can run at compile time (integers
+// and enums with EnumClassHasher, std::string_view with StringHasher<> since
+// C++17), the displacements are searched by the compiler and the table is a
+// constant. Keys that cannot be separated are then a compile error. Each
+// lookup compiles to the same single probe as with perfect_hash_map. The
+// search has to fit in the compiler's constexpr step limits, which GCC's
+// defaults allow for lists of up to about a thousand keys.
+//
+// Example:
+//
+//  static const perfect_hash_map<std::string, Verb, StringHasher<>,
+//                                std::equal_to<>>
+//      verbs{{"get", Verb::Get}, {"put", Verb::Put}, {"del", Verb::Delete}};
+//  auto it = verbs.find(token); // token may be a string_view
+//  if (it != verbs.end())
+//      run(it->second);
+//
+//  constexpr auto colors = make_static_perfect_hash_map<Color, const char*,
+//                                                       EnumClassHasher<Color>>(
+//      {{Color::Red, "red"}, {Color::Green, "green"}, {Color::Blue, "blue"}});
+//  static_assert(colors.contains(Color::Green), "");
+
+namespace perfect_hash_detail {
+
+// The per-seed key hash, from which both the bucket and the slot follow
+constexpr std::uint64_t keyHash(std::size_t h, std::uint64_t seed) noexcept {
+    return hash_mix(h ^ seed);
+}
+
+// 60% of the keys go to the first 30% of the buckets. Large buckets are
+// placed first, while most slots are free, and the many small buckets left
+// fill the last free slots easily.
+constexpr std::uint64_t kDenseKeys = 0x9999999999999999ULL; // 0.6 * 2^64
+
+constexpr std::size_t denseBuckets(std::size_t buckets) noexcept {
+    return buckets < 2 ? buckets : buckets * 3 / 10 + 1;
+}
+
+constexpr std::size_t bucketOf(std::uint64_t k, std::size_t buckets) noexcept {
+    // Selects the range rather than branching, since the choice is random
+    auto dense = denseBuckets(buckets);
+    bool inDense = k * hash_detail::kPrime2 < kDenseKeys || dense == buckets;
+    std::size_t first = inDense ? 0 : dense;
+    std::size_t count = inDense ? dense : buckets - dense;
+    return first + static_cast<std::size_t>(hash_detail::mulHigh(k, count));
+}
+
+constexpr std::size_t slotOf(std::uint64_t k, std::uint32_t displacement,
+                          std::size_t slots) noexcept {
+    auto mixed = hash_detail::mum(k ^ hash_detail::kPrime1,
+                                  hash_detail::kPrime3 + displacement);
+    return static_cast<std::size_t>(hash_detail::mulHigh(mixed, slots));
+}
+
+// Displacements tried for one bucket before giving up on the seed
+constexpr std::uint32_t kMaxDisplacement = 1u << 24;
+
+constexpr std::size_t numBuckets(std::size_t n) noexcept {
+    return (n + 3) / 4;
+}
+
+// The seed and displacements of a static_perfect_hash_map over N keys.
+// Arrays are sized for at least one element, since N may be 0.
+template <std::size_t N>
+struct StaticTable {
+    static constexpr std::size_t kBuckets = numBuckets(N);
+
+    std::uint64_t seed = 0;
+    std::uint32_t displacements[kBuckets > 0 ? kBuckets : 1] = {};
+};
+
+// A StaticTable with the slot order it was built with, which is only needed
+// to fill the slots
+template <std::size_t N>
+struct StaticBuild {
+    StaticTable<N> table;
+    // The input index of the key placed in each slot
+    std::size_t inputOfSlot[N > 0 ? N : 1] = {};
+};
+
+// perfect_hash_map::place, over arrays so that it can run at compile time.
+// The buckets are placed in the same order and given the same displacements.
+template <std::size_t N>
+constexpr bool placeStatic(const std::size_t (&hashes)[N],
+                           StaticBuild<N>& build) {
+    auto& table = build.table;
+    constexpr std::size_t kBuckets = StaticTable<N>::kBuckets;
+    constexpr std::size_t kKeys = N > 0 ? N : 1;
+    constexpr std::size_t kSlots = kBuckets > 0 ? kBuckets : 1;
+
+    // The keys of every bucket, grouped by a counting sort
+    std::uint64_t keys[kKeys] = {};
+    std::size_t bucketOfKey[kKeys] = {};
+    std::size_t first[kBuckets + 1] = {};
+    for (std::size_t i = 0; i < N; ++i) {
+        keys[i] = keyHash(hashes[i], table.seed);
+        bucketOfKey[i] = bucketOf(keys[i], kBuckets);
+        ++first[bucketOfKey[i] + 1];
+    }
+    for (std::size_t b = 0; b < kBuckets; ++b)
+        first[b + 1] += first[b];
+    std::size_t members[kKeys] = {};
+    std::size_t filled[kSlots] = {};
+    for (std::size_t i = 0; i < N; ++i) {
+        auto b = bucketOfKey[i];
+        members[first[b] + filled[b]++] = i;
+    }
+
+    // Largest buckets first, ties in bucket order, as std::stable_sort does
+    std::size_t order[kSlots] = {};
+    for (std::size_t b = 0; b < kBuckets; ++b) {
+        auto size = first[b + 1] - first[b];
+        auto j = b;
+        for (; j > 0 && first[order[j - 1] + 1] - first[order[j - 1]] < size;
+             --j)
+            order[j] = order[j - 1];
+        order[j] = b;
+    }
+
+    bool taken[kKeys] = {};
+    std::size_t candidate[kKeys] = {};
+    for (std::size_t o = 0; o < kBuckets; ++o) {
+        auto b = order[o];
+        auto size = first[b + 1] - first[b];
+        if (size == 0)
+            break;
+        std::uint32_t d = 0;
+        for (; d < kMaxDisplacement; ++d) {
+            bool ok = true;
+            for (std::size_t j = 0; j < size && ok; ++j) {
+                auto s = slotOf(keys[members[first[b] + j]], d, N);
+                ok = !taken[s];
+                for (std::size_t k = 0; k < j && ok; ++k)
+                    ok = candidate[k] != s;
+                candidate[j] = s;
+            }
+            if (ok)
+                break;
+        }
+        if (d == kMaxDisplacement)
+            return false;
+        table.displacements[b] = d;
+        for (std::size_t j = 0; j < size; ++j) {
+            taken[candidate[j]] = true;
+            build.inputOfSlot[candidate[j]] = members[first[b] + j];
+        }
+    }
+    return true;
+}
+
+template <std::size_t N, typename Entry, typename Hash, typename Eq>
+constexpr StaticBuild<N> buildStatic(const Entry (&entries)[N],
+                                     const Hash& hash, const Eq& eq) {
+    std::size_t hashes[N > 0 ? N : 1] = {};
+    for (std::size_t i = 0; i < N; ++i)
+        hashes[i] = hash(entries[i].first);
+    for (std::size_t i = 0; i < N; ++i) {
+        for (std::size_t j = 0; j < i; ++j) {
+            if (hashes[i] != hashes[j])
+                continue;
+            throw std::invalid_argument(
+                eq(entries[i].first, entries[j].first)
+                    ? "static_perfect_hash_map: duplicate key"
+                    : "static_perfect_hash_map: distinct keys with equal "
+                      "hashes");
+        }
+    }
+
+    StaticBuild<N> build{};
+    while (!placeStatic(hashes, build))
+        build.table.seed = hash_mix(build.table.seed + hash_detail::kPrime2);
+    return build;
+}
+
+} // namespace perfect_hash_detail
+
+template <typename Key, typename V, typename Hash = std::hash<Key>,
+          typename Eq = std::equal_to<Key>>
+class perfect_hash_map
+{
+public:
+    using key_type = Key;
+    using mapped_type = V;
+    using value_type = std::pair<const Key, V>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using const_iterator = typename std::vector<value_type>::const_iterator;
+    using iterator = const_iterator;
+
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, Key, Hash, Eq>;
+
+    std::vector<value_type> slots;
+    std::vector<std::uint32_t> displacements;
+    std::uint64_t seed = 0;
+    Hash hash;
+    Eq eq;
+
+    // Fills in displacements for the given seed, or returns false if some
+    // bucket could not be placed. slotOfInput receives the slot of every
+    // input element.
+    bool place(const std::vector<std::size_t>& hashes,
+               std::vector<std::size_t>& slotOfInput) {
+        using namespace perfect_hash_detail;
+        auto n = hashes.size();
+        auto numBuckets = displacements.size();
+
+        std::vector<std::uint64_t> keys(n);
+        std::vector<std::vector<std::size_t>> buckets(numBuckets);
+        for (std::size_t i = 0; i < n; ++i) {
+            keys[i] = keyHash(hashes[i], seed);
+            buckets[bucketOf(keys[i], numBuckets)].push_back(i);
+        }
+
+        std::vector<std::size_t> order(numBuckets);
+        for (std::size_t b = 0; b < numBuckets; ++b)
+            order[b] = b;
+        std::stable_sort(order.begin(), order.end(),
+                         [&](std::size_t a, std::size_t b) {
+                             return buckets[a].size() > buckets[b].size();
+                         });
+
+        std::vector<bool> taken(n, false);
+        std::vector<std::size_t> candidate;
+        for (auto b : order) {
+            const auto& members = buckets[b];
+            if (members.empty())
+                break;
+            std::uint32_t d = 0;
+            for (; d < kMaxDisplacement; ++d) {
+                candidate.clear();
+                bool ok = true;
+                for (auto i : members) {
+                    auto s = slotOf(keys[i], d, n);
+                    if (taken[s] ||
+                        std::find(candidate.begin(), candidate.end(), s) !=
+                            candidate.end()) {
+                        ok = false;
+                        break;
+                    }
+                    candidate.push_back(s);
+                }
+                if (ok)
+                    break;
+            }
+            if (d == kMaxDisplacement)
+                return false;
+            displacements[b] = d;
+            for (std::size_t j = 0; j < members.size(); ++j) {
+                taken[candidate[j]] = true;
+                slotOfInput[members[j]] = candidate[j];
+            }
+        }
+        return true;
+    }
+
+    template <typename InputIt>
+    void build(InputIt first, InputIt last) {
+        std::vector<value_type> input(first, last);
+        auto n = input.size();
+        if (n == 0)
+            return;
+        if (n > std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("perfect_hash_map: too many keys");
+
+        // Keys with equal hashes can never be told apart: catch them before
+        // searching for displacements
+        std::vector<std::size_t> hashes(n), byHash(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            hashes[i] = hash(input[i].first);
+            byHash[i] = i;
+        }
+        std::sort(byHash.begin(), byHash.end(),
+                  [&](std::size_t a, std::size_t b) {
+                      return hashes[a] < hashes[b];
+                  });
+        for (std::size_t i = 1; i < n; ++i) {
+            auto a = byHash[i - 1], b = byHash[i];
+            if (hashes[a] != hashes[b])
+                continue;
+            throw std::invalid_argument(
+                eq(input[a].first, input[b].first)
+                    ? "perfect_hash_map: duplicate key"
+                    : "perfect_hash_map: distinct keys with equal hashes");
+        }
+
+        displacements.assign((n + 3) / 4, 0);
+        std::vector<std::size_t> slotOfInput(n);
+        while (!place(hashes, slotOfInput))
+            seed = hash_mix(seed + hash_detail::kPrime2);
+
+        std::vector<std::size_t> inputOfSlot(n);
+        for (std::size_t i = 0; i < n; ++i)
+            inputOfSlot[slotOfInput[i]] = i;
+        slots.reserve(n);
+        for (auto i : inputOfSlot)
+            slots.emplace_back(std::move(input[i]));
+    }
+
+    template <typename K>
+    const value_type* lookup(const K& key) const {
+        using namespace perfect_hash_detail;
+        if (slots.empty())
+            return nullptr;
+        auto k = keyHash(hash(key), seed);
+        auto d = displacements[bucketOf(k, displacements.size())];
+        const auto& candidate = slots[slotOf(k, d, slots.size())];
+        return eq(candidate.first, key) ? &candidate : nullptr;
+    }
+
+public:
+    perfect_hash_map() = default;
+
+    template <typename InputIt>
+    perfect_hash_map(InputIt first, InputIt last, const Hash& hash = Hash(),
+                     const Eq& eq = Eq())
+        : hash(hash), eq(eq) {
+        build(first, last);
+    }
+
+    perfect_hash_map(std::initializer_list<value_type> init,
+                     const Hash& hash = Hash(), const Eq& eq = Eq())
+        : perfect_hash_map(init.begin(), init.end(), hash, eq) {}
+
+    const_iterator begin() const noexcept { return slots.begin(); }
+    const_iterator end() const noexcept { return slots.end(); }
+    const_iterator cbegin() const noexcept { return slots.begin(); }
+    const_iterator cend() const noexcept { return slots.end(); }
+
+    bool empty() const noexcept { return slots.empty(); }
+    size_type size() const noexcept { return slots.size(); }
+
+    // Number of buckets, each holding one 32-bit displacement
+    size_type bucket_count() const noexcept { return displacements.size(); }
+
+    hasher hash_function() const { return hash; }
+    key_equal key_eq() const { return eq; }
+
+    template <typename K = Key>
+    const_iterator find(const key_arg<K>& key) const {
+        auto p = lookup(key);
+        return p ? slots.begin() + (p - slots.data()) : slots.end();
+    }
+
+    template <typename K = Key>
+    bool contains(const key_arg<K>& key) const {
+        return lookup(key) != nullptr;
+    }
+
+    template <typename K = Key>
+    size_type count(const key_arg<K>& key) const {
+        return contains<K>(key) ? 1 : 0;
+    }
+
+    template <typename K = Key>
+    const V& at(const key_arg<K>& key) const {
+        auto p = lookup(key);
+        if (!p)
+            throw std::out_of_range("perfect_hash_map::at: key not found");
+        return p->second;
+    }
+};
+
+template <typename Key, typename V, std::size_t N,
+          typename Hash = std::hash<Key>, typename Eq = std::equal_to<Key>>
+class static_perfect_hash_map
+{
+public:
+    using key_type = Key;
+    using mapped_type = V;
+    using value_type = std::pair<const Key, V>;
+    using size_type = std::size_t;
+    using hasher = Hash;
+    using key_equal = Eq;
+    using const_iterator = const value_type*;
+    using iterator = const_iterator;
+
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, Key, Hash, Eq>;
+
+    static_assert(N > 0, "static_perfect_hash_map needs at least one key");
+
+    perfect_hash_detail::StaticTable<N> table;
+    value_type slots[N];
+    Hash hash;
+    Eq eq;
+
+    // The slot order only lives in the temporary build
+    template <std::size_t... Is>
+    constexpr static_perfect_hash_map(
+        const std::pair<Key, V> (&entries)[N],
+        const perfect_hash_detail::StaticBuild<N>& build, const Hash& hash,
+        const Eq& eq, std::index_sequence<Is...>)
+        : table(build.table), slots{entries[build.inputOfSlot[Is]]...},
+          hash(hash), eq(eq) {}
+
+    template <typename K>
+    constexpr const value_type* lookup(const K& key) const {
+        using namespace perfect_hash_detail;
+        auto k = keyHash(hash(key), table.seed);
+        auto d = table.displacements[bucketOf(k, StaticTable<N>::kBuckets)];
+        const auto& candidate = slots[slotOf(k, d, N)];
+        return eq(candidate.first, key) ? &candidate : nullptr;
+    }
+
+public:
+    // Throws std::invalid_argument, or fails to compile when evaluated at
+    // compile time, on keys that cannot be separated, as perfect_hash_map
+    constexpr explicit static_perfect_hash_map(
+        const std::pair<Key, V> (&entries)[N], const Hash& hash = Hash(),
+        const Eq& eq = Eq())
+        : static_perfect_hash_map(
+              entries, perfect_hash_detail::buildStatic(entries, hash, eq),
+              hash, eq, std::make_index_sequence<N>{}) {}
+
+    constexpr const_iterator begin() const noexcept { return slots; }
+    constexpr const_iterator end() const noexcept { return slots + N; }
+    constexpr const_iterator cbegin() const noexcept { return begin(); }
+    constexpr const_iterator cend() const noexcept { return end(); }
+
+    constexpr bool empty() const noexcept { return false; }
+    constexpr size_type size() const noexcept { return N; }
+
+    constexpr size_type bucket_count() const noexcept {
+        return perfect_hash_detail::StaticTable<N>::kBuckets;
+    }
+
+    constexpr hasher hash_function() const { return hash; }
+    constexpr key_equal key_eq() const { return eq; }
+
+    template <typename K = Key>
+    constexpr const_iterator find(const key_arg<K>& key) const {
+        auto p = lookup(key);
+        return p ? p : end();
+    }
+
+    template <typename K = Key>
+    constexpr bool contains(const key_arg<K>& key) const {
+        return lookup(key) != nullptr;
+    }
+
+    template <typename K = Key>
+    constexpr size_type count(const key_arg<K>& key) const {
+        return lookup(key) != nullptr ? 1 : 0;
+    }
+
+    template <typename K = Key>
+    constexpr const V& at(const key_arg<K>& key) const {
+        auto p = lookup(key);
+        if (!p)
+            throw std::out_of_range(
+                "static_perfect_hash_map::at: key not found");
+        return p->second;
+    }
+};
+
+// Builds a static_perfect_hash_map from a braced list of N entries, e.g.
+// make_static_perfect_hash_map<int, char>({{1, 'a'}, {2, 'b'}})
+template <typename Key, typename V, typename Hash = std::hash<Key>,
+          typename Eq = std::equal_to<Key>, std::size_t N>
+constexpr static_perfect_hash_map<Key, V, N, Hash, Eq>
+make_static_perfect_hash_map(const std::pair<Key, V> (&entries)[N],
+                             const Hash& hash = Hash(), const Eq& eq = Eq()) {
+    return static_perfect_hash_map<Key, V, N, Hash, Eq>(entries, hash, eq);
+}
+
+} // namespace util
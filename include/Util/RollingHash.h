@@ -0,0 +1,350 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// Rolling hashes of sliding windows over a sequence, updated in O(1) as one
+// element enters the window and another one leaves it:
+//  - PolynomialRollingHash is the Rabin-Karp hash modulo the Mersenne prime
+//    2^61 - 1. PolynomialPrefixHash precomputes the prefixes of a whole range
+//    so that the hash of any subrange is available in O(1), with the same
+//    value as the rolling hash of that subrange.
+//  - BuzHash rotates and xors per-element words, which is cheaper than the
+//    modular multiply but has weaker guarantees.
+//  - GearHash shifts its state left by one bit per element, so it only
+//    depends on the last 64 elements and never needs to remove any. It is the
+//    basis of ContentDefinedChunker.
+//
+// Like hashRange(first, last, func), each of them takes a projection functor
+// applied to the elements before they are hashed with std::hash. The
+// projected hash is then run through hash_mix, so identity hashes are fine.
+//
+// Example:
+//
+//  PolynomialRollingHash<> rolling(window);
+//  for (std::size_t i = 0; i < tokens.size(); ++i) {
+//      if (i < window)
+//          rolling.push(tokens[i]);
+//      else
+//          rolling.roll(tokens[i - window], tokens[i]);
+//      if (i + 1 >= window)
+//          seen.insert(rolling.value());
+//  }
+
+struct IdentityProjection {
+    template <typename T>
+    const T& operator()(const T& v) const noexcept {
+        return v;
+    }
+};
+
+namespace hash_detail {
+
+constexpr std::uint64_t kMersenne61 = (std::uint64_t(1) << 61) - 1;
+
+// The default base of the polynomial hash, an arbitrary residue
+constexpr std::uint64_t kPolynomialBase = 0x1f3d5b79a2c4e687ULL % kMersenne61;
+
+// a * b mod 2^61 - 1, for a and b already reduced
+inline std::uint64_t mulMod61(std::uint64_t a, std::uint64_t b) noexcept {
+#if defined __SIZEOF_INT128__
+    __extension__ using uint128 = unsigned __int128;
+    auto r = static_cast<uint128>(a) * b;
+    auto lo = static_cast<std::uint64_t>(r) & kMersenne61;
+    auto hi = static_cast<std::uint64_t>(r >> 61);
+#else
+    std::uint64_t ha = a >> 32, hb = b >> 32;
+    std::uint64_t la = static_cast<std::uint32_t>(a);
+    std::uint64_t lb = static_cast<std::uint32_t>(b);
+    std::uint64_t mid = ha * lb + la * hb;
+    // a and b are below 2^61, so mid < 2^62, and 2^64 = 8 mod 2^61 - 1
+    std::uint64_t lo = (la * lb & kMersenne61) + ((mid << 32) & kMersenne61);
+    std::uint64_t hi = (la * lb >> 61) + (mid >> 29) + ((ha * hb) << 3);
+#endif
+    auto s = lo + hi;
+    s = (s & kMersenne61) + (s >> 61);
+    return s >= kMersenne61 ? s - kMersenne61 : s;
+}
+
+inline std::uint64_t addMod61(std::uint64_t a, std::uint64_t b) noexcept {
+    auto s = a + b;
+    return s >= kMersenne61 ? s - kMersenne61 : s;
+}
+
+inline std::uint64_t subMod61(std::uint64_t a, std::uint64_t b) noexcept {
+    return a >= b ? a - b : a + kMersenne61 - b;
+}
+
+inline std::uint64_t rotl64(std::uint64_t x, unsigned b) noexcept {
+    b &= 63;
+    return b == 0 ? x : (x << b) | (x >> (64 - b));
+}
+
+// The well-mixed 64-bit word standing for element v
+template <typename F, typename T>
+std::uint64_t elementWord(const F& func, const T& v) {
+    using Projected = typename std::decay<decltype(func(v))>::type;
+    return hash_mix(std::hash<Projected>()(func(v)) ^ kPrime0);
+}
+
+} // namespace hash_detail
+
+template <typename F = IdentityProjection>
+class PolynomialRollingHash {
+private:
+    F func;
+    std::uint64_t base;
+    std::uint64_t outFactor = 1; // base^(window - 1)
+    std::uint64_t hash = 0;
+    std::size_t window;
+    std::size_t count = 0;
+
+    std::uint64_t residue(std::uint64_t w) const noexcept {
+        return w % hash_detail::kMersenne61;
+    }
+
+public:
+    // The base must be in [2, 2^61 - 1). Drawing it at random makes the
+    // collision probability of two distinct windows at most
+    // window / (2^61 - 1), whatever the input.
+    explicit PolynomialRollingHash(
+        std::size_t window, F func = F(),
+        std::uint64_t base = hash_detail::kPolynomialBase)
+        : func(std::move(func)), base(base), window(window) {
+        for (std::size_t i = 1; i < window; ++i)
+            outFactor = hash_detail::mulMod61(outFactor, base);
+    }
+
+    // Appends v, for filling the window up
+    template <typename T>
+    void push(const T& v) {
+        hash = hash_detail::addMod61(
+            hash_detail::mulMod61(hash, base),
+            residue(hash_detail::elementWord(func, v)));
+        ++count;
+    }
+
+    // Slides the full window by one: out is its oldest element and in the new
+    // one
+    template <typename T>
+    void roll(const T& out, const T& in) {
+        auto stripped = hash_detail::subMod61(
+            hash, hash_detail::mulMod61(
+                      outFactor, residue(hash_detail::elementWord(func, out))));
+        hash = hash_detail::addMod61(
+            hash_detail::mulMod61(stripped, base),
+            residue(hash_detail::elementWord(func, in)));
+    }
+
+    void reset() noexcept {
+        hash = 0;
+        count = 0;
+    }
+
+    // Number of elements pushed, capped at the window size
+    std::size_t size() const noexcept { return count < window ? count : window; }
+    bool full() const noexcept { return count >= window; }
+
+    // The hash of the current window, in [0, 2^61 - 1)
+    std::uint64_t value() const noexcept { return hash; }
+};
+
+// Polynomial hashes of every prefix of a range, from which the hash of any
+// subrange [i, j) follows in O(1). range(i, j) equals the value of a
+// PolynomialRollingHash with the same projection and base holding
+// elements i to j - 1.
+template <typename F = IdentityProjection>
+class PolynomialPrefixHash {
+private:
+    std::vector<std::uint64_t> prefix;
+    std::vector<std::uint64_t> powers;
+
+public:
+    template <typename It>
+    PolynomialPrefixHash(It first, It last, F func = F(),
+                         std::uint64_t base = hash_detail::kPolynomialBase) {
+        prefix.push_back(0);
+        powers.push_back(1);
+        for (; first != last; ++first) {
+            auto w = hash_detail::elementWord(func, *first) %
+                     hash_detail::kMersenne61;
+            prefix.push_back(hash_detail::addMod61(
+                hash_detail::mulMod61(prefix.back(), base), w));
+            powers.push_back(hash_detail::mulMod61(powers.back(), base));
+        }
+    }
+
+    std::size_t size() const noexcept { return prefix.size() - 1; }
+
+    std::uint64_t range(std::size_t i, std::size_t j) const noexcept {
+        return hash_detail::subMod61(
+            prefix[j], hash_detail::mulMod61(prefix[i], powers[j - i]));
+    }
+};
+
+// Buzhash: the xor of the element words, each rotated by its distance to the
+// end of the window
+template <typename F = IdentityProjection>
+class BuzHash {
+private:
+    F func;
+    std::uint64_t hash = 0;
+    std::size_t window;
+    std::size_t count = 0;
+
+public:
+    explicit BuzHash(std::size_t window, F func = F())
+        : func(std::move(func)), window(window) {}
+
+    template <typename T>
+    void push(const T& v) {
+        hash = hash_detail::rotl64(hash, 1) ^ hash_detail::elementWord(func, v);
+        ++count;
+    }
+
+    template <typename T>
+    void roll(const T& out, const T& in) {
+        hash = hash_detail::rotl64(hash, 1) ^
+               hash_detail::rotl64(hash_detail::elementWord(func, out),
+                                   static_cast<unsigned>(window)) ^
+               hash_detail::elementWord(func, in);
+    }
+
+    void reset() noexcept {
+        hash = 0;
+        count = 0;
+    }
+
+    std::size_t size() const noexcept { return count < window ? count : window; }
+    bool full() const noexcept { return count >= window; }
+
+    std::uint64_t value() const noexcept { return hash; }
+};
+
+// Gear hash: hash = (hash << 1) + word(v). Bit k of the hash depends on the
+// last k + 1 elements only, so the high bits cover a window of 64 elements.
+template <typename F = IdentityProjection>
+class GearHash {
+private:
+    F func;
+    std::uint64_t hash = 0;
+
+public:
+    explicit GearHash(F func = F()) : func(std::move(func)) {}
+
+    template <typename T>
+    void push(const T& v) {
+        hash = (hash << 1) + hash_detail::elementWord(func, v);
+    }
+
+    void reset() noexcept { hash = 0; }
+
+    std::uint64_t value() const noexcept { return hash; }
+};
+
+// Content-defined chunking in the style of FastCDC: splits a sequence where
+// the gear hash of the preceding elements has its top bits clear. Boundaries
+// depend on the content around them only, so inserting or removing elements
+// only changes the chunks near the edit, and the others can be deduplicated
+// by their hashes.
+//
+// No chunk is shorter than minSize elements (except the last one) or longer
+// than maxSize. The cut condition is stricter before avgSize elements and
+// looser after, which narrows the spread of chunk sizes around avgSize.
+//
+// Example:
+//
+//  ContentDefinedChunker<> chunker(2048, 8192, 65536);
+//  chunker.split(bytes.begin(), bytes.end(), [&](auto first, auto last) {
+//      store(hashRange(first, last), first, last);
+//  });
+template <typename F = IdentityProjection>
+class ContentDefinedChunker {
+private:
+    F func;
+    std::size_t minSize;
+    std::size_t avgSize;
+    std::size_t maxSize;
+    std::uint64_t strictMask;
+    std::uint64_t looseMask;
+
+    static unsigned log2(std::size_t n) noexcept {
+        unsigned ret = 0;
+        while (n > 1) {
+            n >>= 1;
+            ++ret;
+        }
+        return ret;
+    }
+
+    static std::uint64_t topBits(unsigned bits) noexcept {
+        if (bits == 0)
+            return 0;
+        if (bits >= 64)
+            return ~std::uint64_t(0);
+        return ~std::uint64_t(0) << (64 - bits);
+    }
+
+public:
+    // Throws std::invalid_argument unless 0 < minSize <= avgSize <= maxSize
+    ContentDefinedChunker(std::size_t minSize, std::size_t avgSize,
+                          std::size_t maxSize, F func = F())
+        : func(std::move(func)), minSize(minSize), avgSize(avgSize),
+          maxSize(maxSize), strictMask(topBits(log2(avgSize) + 1)),
+          looseMask(topBits(log2(avgSize) > 0 ? log2(avgSize) - 1 : 0)) {
+        if (minSize == 0 || minSize > avgSize || avgSize > maxSize)
+            throw std::invalid_argument("ContentDefinedChunker: sizes must "
+                                        "satisfy 0 < min <= avg <= max");
+    }
+
+    // The end of the chunk starting at first. Reads at most maxSize
+    // elements, so splitting a sequence is linear for any iterator category.
+    template <typename It>
+    It nextBoundary(It first, It last) const {
+        GearHash<const F&> gear(func);
+        auto itr = first;
+        std::size_t i = 0;
+        for (; i < minSize; ++i, ++itr) {
+            if (itr == last)
+                return itr;
+            gear.push(*itr);
+        }
+        for (; i < avgSize; ++i, ++itr) {
+            if (itr == last)
+                return itr;
+            gear.push(*itr);
+            if ((gear.value() & strictMask) == 0)
+                return ++itr;
+        }
+        for (; i < maxSize; ++i, ++itr) {
+            if (itr == last)
+                return itr;
+            gear.push(*itr);
+            if ((gear.value() & looseMask) == 0)
+                return ++itr;
+        }
+        return itr;
+    }
+
+    // Calls fn(chunkFirst, chunkLast) for every chunk of [first, last), in
+    // order
+    template <typename It, typename Fn>
+    void split(It first, It last, Fn&& fn) const {
+        while (first != last) {
+            auto next = nextBoundary(first, last);
+            fn(first, next);
+            first = next;
+        }
+    }
+};
+
+} // namespace util
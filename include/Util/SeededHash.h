@@ -0,0 +1,163 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <type_traits>
+
+namespace util {
+
+// Keyed hashing for tables whose keys come from untrusted sources. The
+// unseeded hashers of Hashing.h are deterministic, so anyone who can pick the
+// keys can also pick keys that collide and turn every lookup into a walk down
+// a single bucket. Plugging SeededHashPolicy into those hashers makes the
+// hashes depend on a secret key drawn once per process:
+//  - contiguous containers of uniquely represented values (std::string in
+//    particular) are hashed with SipHash-1-3, a keyed PRF
+//  - other values go through std::hash and are then mixed with the key using
+//    the same wide multiply as Hasher
+//
+// Example:
+//
+//  std::unordered_map<std::string, int, SeededHasher<std::string>> counts;
+//  std::unordered_set<std::pair<std::string, int>,
+//                     PairHasher<std::pair<std::string, int>,
+//                                SeededHashPolicy>> seen;
+//
+// Types whose std::hash is not injective keep the collisions of their
+// std::hash; hash the bytes that make up their value instead.
+
+struct HashKey {
+    std::uint64_t k0;
+    std::uint64_t k1;
+};
+
+namespace hash_detail {
+
+inline std::uint64_t rotl(std::uint64_t x, unsigned b) noexcept {
+    return (x << b) | (x >> (64 - b));
+}
+
+struct SipState {
+    std::uint64_t v0, v1, v2, v3;
+
+    void round() noexcept {
+        v0 += v1;
+        v1 = rotl(v1, 13);
+        v1 ^= v0;
+        v0 = rotl(v0, 32);
+        v2 += v3;
+        v3 = rotl(v3, 16);
+        v3 ^= v2;
+        v0 += v3;
+        v3 = rotl(v3, 21);
+        v3 ^= v0;
+        v2 += v1;
+        v1 = rotl(v1, 17);
+        v1 ^= v2;
+        v2 = rotl(v2, 32);
+    }
+};
+
+// SipHash-c-d of the len bytes at data, keyed by key. The input is read as
+// little-endian words, as in the reference implementation.
+template <unsigned CompressionRounds, unsigned FinalizationRounds>
+std::uint64_t sipHash(const HashKey& key, const void* data,
+                      std::size_t len) noexcept {
+    SipState s{key.k0 ^ 0x736f6d6570736575ULL, key.k1 ^ 0x646f72616e646f6dULL,
+               key.k0 ^ 0x6c7967656e657261ULL, key.k1 ^ 0x7465646279746573ULL};
+    auto p = static_cast<const unsigned char*>(data);
+    auto last = std::uint64_t(len) << 56;
+
+    for (; len >= 8; len -= 8, p += 8) {
+        auto m = read64(p);
+        s.v3 ^= m;
+        for (unsigned i = 0; i < CompressionRounds; ++i)
+            s.round();
+        s.v0 ^= m;
+    }
+    for (std::size_t i = 0; i < len; ++i)
+        last |= std::uint64_t(p[i]) << (8 * i);
+
+    s.v3 ^= last;
+    for (unsigned i = 0; i < CompressionRounds; ++i)
+        s.round();
+    s.v0 ^= last;
+    s.v2 ^= 0xff;
+    for (unsigned i = 0; i < FinalizationRounds; ++i)
+        s.round();
+    return s.v0 ^ s.v1 ^ s.v2 ^ s.v3;
+}
+
+// Draws the process key from std::random_device. The clock and the address
+// of a local are mixed in as well, in case random_device is deterministic
+// on this platform.
+inline HashKey makeRandomHashKey() {
+    std::random_device rd;
+    auto draw = [&rd] {
+        return (std::uint64_t(rd()) << 32) ^ std::uint64_t(rd());
+    };
+    auto now = static_cast<std::uint64_t>(
+        std::chrono::high_resolution_clock::now().time_since_epoch().count());
+    int local;
+    auto addr = static_cast<std::uint64_t>(
+        reinterpret_cast<std::uintptr_t>(&local));
+    return {hash_mix(draw() ^ now), hash_mix(draw() ^ addr)};
+}
+
+} // namespace hash_detail
+
+// SipHash-1-3, the variant used by Rust's HashMap and Python's str hash: one
+// compression round per word and three finalization rounds
+inline std::uint64_t sipHash13(const HashKey& key, const void* data,
+                               std::size_t len) noexcept {
+    return hash_detail::sipHash<1, 3>(key, data, len);
+}
+
+// The secret key of this process, drawn on first use
+inline const HashKey& processHashKey() {
+    static const HashKey key = hash_detail::makeRandomHashKey();
+    return key;
+}
+
+struct SeededHashPolicy {
+    static std::uint64_t seed() { return processHashKey().k0; }
+
+    template <typename T>
+    static std::uint64_t value(const T& v) {
+        return valueImpl(v, hash_detail::is_bulk_hashable<T>{});
+    }
+
+    static std::size_t bytes(const void* data, std::size_t len) {
+        return static_cast<std::size_t>(
+            sipHash13(processHashKey(), data, len));
+    }
+
+private:
+    template <typename T>
+    static std::uint64_t valueImpl(const T& v, std::true_type) {
+        return bytes(v.data(), v.size() * sizeof(typename T::value_type));
+    }
+
+    template <typename T>
+    static std::uint64_t valueImpl(const T& v, std::false_type) {
+        return hash_detail::combine(processHashKey().k1, std::hash<T>()(v));
+    }
+};
+
+// A drop-in replacement for std::hash<T> keyed with the process key
+template <typename T>
+struct SeededHasher
+{
+    std::size_t operator()(const T& v) const {
+        return static_cast<std::size_t>(
+            hash_mix(SeededHashPolicy::value(v) ^ SeededHashPolicy::seed()));
+    }
+};
+
+} // namespace util
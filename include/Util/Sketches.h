@@ -0,0 +1,369 @@
+#pragma once
+
+#include "Util/Hashing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+#include <emmintrin.h>
+#endif
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+#include <immintrin.h>
+#endif
+
+namespace util {
+
+// Streaming summaries of a sequence of keys, in memory independent of the
+// number of distinct keys:
+//  - count_min_sketch<T, Hash> estimates the frequency of every key. The
+//    estimate is never below the true count, and exceeds it by more than
+//    epsilon * total() with probability at most delta.
+//  - count_sketch<T, Hash> also estimates frequencies, without bias: the
+//    error is symmetric, and proportional to the L2 norm of the frequencies
+//    rather than to their sum, which is much tighter on skewed streams.
+//  - hyperloglog<T, Hash> estimates the number of distinct keys, with a
+//    relative standard error of 1.04 / sqrt(2^precision).
+//
+// All three hash each key once with Hash, which may be any of the util
+// hashers or std::hash, and derive what they need from that hash. Sketches
+// built with the same parameters can be merged, so a stream can be split
+// between threads, each filling its own sketch, and the sketches merged at
+// the end. The result is the same as if one sketch had seen the whole
+// stream.
+//
+// Example:
+//
+//  std::vector<hyperloglog<std::string, StringHasher<>>> perThread(
+//      numThreads, hyperloglog<std::string, StringHasher<>>(14));
+//  // ... each thread adds its keys to perThread[thread] ...
+//  for (std::size_t i = 1; i < numThreads; ++i)
+//      perThread[0].merge(perThread[i]);
+//  auto distinctUsers = perThread[0].estimate();
+
+namespace sketch_detail {
+
+// The word of row i derived from the key hash h. Rows must be independent
+// of each other for the error bounds to hold, so every row mixes the hash
+// again with its own constant.
+inline std::uint64_t rowHash(std::size_t h, std::size_t i) noexcept {
+    return hash_mix(h + (i + 1) * hash_detail::kPrime0);
+}
+
+inline void checkSameShape(std::size_t width, std::size_t depth,
+                           std::size_t otherWidth, std::size_t otherDepth,
+                           const char* what) {
+    if (width != otherWidth || depth != otherDepth)
+        throw std::invalid_argument(what);
+}
+
+// sigma and tau from Ertl, "New cardinality estimation algorithms for
+// HyperLogLog sketches" (2017), which correct the raw estimate at both ends
+// of the range without empirical bias tables
+inline double sigma(double x) noexcept {
+    if (x == 1)
+        return std::numeric_limits<double>::infinity();
+    double y = 1, z = x, prev;
+    do {
+        x *= x;
+        prev = z;
+        z += x * y;
+        y += y;
+    } while (z != prev);
+    return z;
+}
+
+inline double tau(double x) noexcept {
+    if (x == 0 || x == 1)
+        return 0;
+    double y = 1, z = 1 - x, prev;
+    do {
+        x = std::sqrt(x);
+        prev = z;
+        y *= 0.5;
+        z -= (1 - x) * (1 - x) * y;
+    } while (z != prev);
+    return z / 3;
+}
+
+inline void maxBytes(std::uint8_t* dst, const std::uint8_t* src,
+                     std::size_t n) noexcept {
+    std::size_t i = 0;
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+    for (; i + 32 <= n; i += 32) {
+        auto d = reinterpret_cast<__m256i*>(dst + i);
+        auto s = reinterpret_cast<const __m256i*>(src + i);
+        _mm256_storeu_si256(
+            d, _mm256_max_epu8(_mm256_loadu_si256(d), _mm256_loadu_si256(s)));
+    }
+#elif defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+    for (; i + 16 <= n; i += 16) {
+        auto d = reinterpret_cast<__m128i*>(dst + i);
+        auto s = reinterpret_cast<const __m128i*>(src + i);
+        _mm_storeu_si128(d,
+                         _mm_max_epu8(_mm_loadu_si128(d), _mm_loadu_si128(s)));
+    }
+#endif
+    for (; i < n; ++i)
+        dst[i] = std::max(dst[i], src[i]);
+}
+
+} // namespace sketch_detail
+
+template <typename T, typename Hash = std::hash<T>>
+class count_min_sketch
+{
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, T, Hash>;
+
+    std::vector<std::uint64_t> counters;
+    std::size_t width_;
+    std::size_t depth_;
+    std::uint64_t total_ = 0;
+    Hash hash;
+
+    template <typename F>
+    void forEachCounter(std::size_t h, F&& fn) const {
+        for (std::size_t i = 0; i < depth_; ++i)
+            fn(i * width_ + hash_detail::mulHigh(sketch_detail::rowHash(h, i),
+                                                 width_));
+    }
+
+public:
+    using key_type = T;
+    using hasher = Hash;
+
+    count_min_sketch(std::size_t width, std::size_t depth,
+                     const Hash& hash = Hash())
+        : counters(width * depth, 0), width_(width), depth_(depth),
+          hash(hash) {
+        if (width == 0 || depth == 0)
+            throw std::invalid_argument(
+                "count_min_sketch: width and depth must be positive");
+    }
+
+    // The smallest sketch whose estimates exceed the true counts by more
+    // than epsilon * total() with probability at most delta
+    static count_min_sketch with_error_bounds(double epsilon, double delta,
+                                              const Hash& hash = Hash()) {
+        if (!(epsilon > 0 && delta > 0 && delta < 1))
+            throw std::invalid_argument("count_min_sketch: epsilon must be "
+                                        "positive and delta in (0, 1)");
+        return count_min_sketch(
+            static_cast<std::size_t>(std::ceil(std::exp(1.0) / epsilon)),
+            static_cast<std::size_t>(std::ceil(std::log(1 / delta))), hash);
+    }
+
+    template <typename K = T>
+    void add(const key_arg<K>& key, std::uint64_t count = 1) {
+        forEachCounter(hash(key), [&](std::size_t c) { counters[c] += count; });
+        total_ += count;
+    }
+
+    template <typename K = T>
+    std::uint64_t estimate(const key_arg<K>& key) const {
+        auto ret = std::numeric_limits<std::uint64_t>::max();
+        forEachCounter(hash(key), [&](std::size_t c) {
+            ret = std::min(ret, counters[c]);
+        });
+        return ret;
+    }
+
+    void merge(const count_min_sketch& other) {
+        sketch_detail::checkSameShape(
+            width_, depth_, other.width_, other.depth_,
+            "count_min_sketch::merge: the sketches have different shapes");
+        for (std::size_t i = 0; i < counters.size(); ++i)
+            counters[i] += other.counters[i];
+        total_ += other.total_;
+    }
+
+    void clear() noexcept {
+        std::fill(counters.begin(), counters.end(), 0);
+        total_ = 0;
+    }
+
+    // The sum of all the counts added
+    std::uint64_t total() const noexcept { return total_; }
+    std::size_t width() const noexcept { return width_; }
+    std::size_t depth() const noexcept { return depth_; }
+};
+
+template <typename T, typename Hash = std::hash<T>>
+class count_sketch
+{
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, T, Hash>;
+
+    std::vector<std::int64_t> counters;
+    std::size_t width_;
+    std::size_t depth_;
+    Hash hash;
+
+    // Calls fn(counter, sign) for every row. The sign is the top bit of the
+    // row word, and the column comes from the bits below it.
+    template <typename F>
+    void forEachCounter(std::size_t h, F&& fn) const {
+        for (std::size_t i = 0; i < depth_; ++i) {
+            auto w = sketch_detail::rowHash(h, i);
+            std::int64_t sign = (w >> 63) ? -1 : 1;
+            fn(i * width_ + hash_detail::mulHigh(w << 1, width_), sign);
+        }
+    }
+
+public:
+    using key_type = T;
+    using hasher = Hash;
+
+    // An odd depth makes the median a single row
+    count_sketch(std::size_t width, std::size_t depth,
+                 const Hash& hash = Hash())
+        : counters(width * depth, 0), width_(width), depth_(depth),
+          hash(hash) {
+        if (width == 0 || depth == 0)
+            throw std::invalid_argument(
+                "count_sketch: width and depth must be positive");
+    }
+
+    template <typename K = T>
+    void add(const key_arg<K>& key, std::int64_t count = 1) {
+        forEachCounter(hash(key), [&](std::size_t c, std::int64_t sign) {
+            counters[c] += sign * count;
+        });
+    }
+
+    // The median of the row estimates
+    template <typename K = T>
+    std::int64_t estimate(const key_arg<K>& key) const {
+        std::int64_t small[16];
+        std::vector<std::int64_t> large;
+        auto rows = small;
+        if (depth_ > 16) {
+            large.resize(depth_);
+            rows = large.data();
+        }
+        std::size_t n = 0;
+        forEachCounter(hash(key), [&](std::size_t c, std::int64_t sign) {
+            rows[n++] = sign * counters[c];
+        });
+        std::nth_element(rows, rows + n / 2, rows + n);
+        if (n % 2)
+            return rows[n / 2];
+        auto upper = rows[n / 2];
+        auto lower = *std::max_element(rows, rows + n / 2);
+        return lower + (upper - lower) / 2;
+    }
+
+    void merge(const count_sketch& other) {
+        sketch_detail::checkSameShape(
+            width_, depth_, other.width_, other.depth_,
+            "count_sketch::merge: the sketches have different shapes");
+        for (std::size_t i = 0; i < counters.size(); ++i)
+            counters[i] += other.counters[i];
+    }
+
+    void clear() noexcept { std::fill(counters.begin(), counters.end(), 0); }
+
+    std::size_t width() const noexcept { return width_; }
+    std::size_t depth() const noexcept { return depth_; }
+};
+
+// HyperLogLog with 64-bit hashes, in 2^precision one-byte registers. The
+// estimate uses Ertl's improved estimator, which stays accurate from a
+// handful of keys up to far beyond 2^64 / 2^precision without the
+// empirical bias tables of HyperLogLog++.
+template <typename T, typename Hash = std::hash<T>>
+class hyperloglog
+{
+private:
+    template <typename K>
+    using key_arg = hash_detail::key_arg_t<K, T, Hash>;
+
+    std::vector<std::uint8_t> registers;
+    unsigned precision_;
+    Hash hash;
+
+    static unsigned leadingZeros(std::uint64_t x) noexcept {
+#if defined __GNUC__
+        return x ? unsigned(__builtin_clzll(x)) : 64;
+#else
+        unsigned n = 0;
+        for (; n < 64 && !(x >> 63); ++n)
+            x <<= 1;
+        return n;
+#endif
+    }
+
+public:
+    using key_type = T;
+    using hasher = Hash;
+
+    static constexpr unsigned kMinPrecision = 4;
+    static constexpr unsigned kMaxPrecision = 18;
+
+    explicit hyperloglog(unsigned precision = 14, const Hash& hash = Hash())
+        : precision_(precision), hash(hash) {
+        if (precision < kMinPrecision || precision > kMaxPrecision)
+            throw std::invalid_argument(
+                "hyperloglog: the precision must be in [4, 18]");
+        registers.assign(std::size_t(1) << precision, 0);
+    }
+
+    template <typename K = T>
+    void add(const key_arg<K>& key) {
+        // std::hash is the identity for integers, so the hash is mixed
+        // before its top bits pick the register
+        auto x = hash_mix(hash(key) ^ hash_detail::kPrime1);
+        auto index = x >> (64 - precision_);
+        auto rest = x << precision_;
+        auto rank = std::min(leadingZeros(rest), 64 - precision_) + 1;
+        auto& r = registers[index];
+        if (rank > r)
+            r = static_cast<std::uint8_t>(rank);
+    }
+
+    double estimate() const {
+        auto q = 64 - precision_;
+        double m = double(registers.size());
+        std::vector<std::size_t> histogram(q + 2, 0);
+        for (auto r : registers)
+            ++histogram[r];
+
+        double z = m * sketch_detail::tau(1 - histogram[q + 1] / m);
+        for (auto k = q; k >= 1; --k)
+            z = 0.5 * (z + double(histogram[k]));
+        z += m * sketch_detail::sigma(histogram[0] / m);
+        return m * m / (2 * std::log(2.0) * z);
+    }
+
+    // Register-wise maximum, vectorized
+    void merge(const hyperloglog& other) {
+        if (other.precision_ != precision_)
+            throw std::invalid_argument(
+                "hyperloglog::merge: the sketches have different precisions");
+        sketch_detail::maxBytes(registers.data(), other.registers.data(),
+                                registers.size());
+    }
+
+    void clear() noexcept {
+        std::fill(registers.begin(), registers.end(), std::uint8_t(0));
+    }
+
+    unsigned precision() const noexcept { return precision_; }
+
+    // The expected relative standard error of estimate()
+    double standard_error() const noexcept {
+        return 1.04 / std::sqrt(double(registers.size()));
+    }
+};
+
+} // namespace util
@@ -0,0 +1,139 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// A fixed-size pool of worker threads consuming a shared FIFO of tasks.
+//
+// Example:
+//
+//  ThreadPool pool(4);
+//  auto f = pool.submit([] { return compute(); });
+//  use(f.get());
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool stopping = false;
+
+    void run() {
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty())
+                    return;
+                task = std::move(tasks.front());
+                tasks.pop_front();
+            }
+            task();
+        }
+    }
+
+public:
+    // A pool with zero threads is valid: parallelFor() then runs everything
+    // on the calling thread
+    explicit ThreadPool(
+        std::size_t numThreads = std::max(1u, std::thread::hardware_concurrency())) {
+        workers.reserve(numThreads);
+        for (std::size_t i = 0; i < numThreads; ++i)
+            workers.emplace_back([this] { run(); });
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Finishes the queued tasks before joining
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto& worker : workers)
+            worker.join();
+    }
+
+    std::size_t size() const { return workers.size(); }
+
+    template <typename F>
+    std::future<typename std::result_of<F()>::type> submit(F&& f) {
+        using ResultType = typename std::result_of<F()>::type;
+        auto task = std::make_shared<std::packaged_task<ResultType()>>(
+            std::forward<F>(f));
+        auto ret = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace_back([task] { (*task)(); });
+        }
+        cv.notify_one();
+        return ret;
+    }
+};
+
+// Calls fn(i) for every i in [0, numChunks), spreading the calls over the pool
+// and the calling thread, and returns once all of them are done. The caller
+// takes part in the work, so this never deadlocks even if the pool is busy or
+// if it is called from one of the pool's own threads. The first exception
+// thrown by fn is rethrown here.
+template <typename F>
+void parallelFor(ThreadPool& pool, std::size_t numChunks, F&& fn) {
+    if (numChunks == 0)
+        return;
+
+    struct State {
+        std::atomic<std::size_t> next{0};
+        std::size_t done = 0;
+        std::exception_ptr error;
+        std::mutex mutex;
+        std::condition_variable cv;
+    };
+    auto state = std::make_shared<State>();
+
+    // Helpers that only start after all chunks have been claimed never touch
+    // fn, which may be gone by then
+    auto work = [state, numChunks, &fn] {
+        std::size_t i;
+        while ((i = state->next.fetch_add(1)) < numChunks) {
+            std::exception_ptr error;
+            try {
+                fn(i);
+            } catch (...) {
+                error = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(state->mutex);
+            if (error && !state->error)
+                state->error = error;
+            if (++state->done == numChunks)
+                state->cv.notify_all();
+        }
+    };
+
+    auto numHelpers = std::min(pool.size(), numChunks - 1);
+    for (std::size_t i = 0; i < numHelpers; ++i)
+        pool.submit(work);
+    work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->cv.wait(lock, [&] { return state->done == numChunks; });
+    if (state->error)
+        std::rethrow_exception(state->error);
+}
+}
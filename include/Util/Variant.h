@@ -35,6 +35,7 @@
 // OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
 // EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+#include "Util/Hashing.h"
 #include "Util/in_place.h"
 
 #include <limits.h>
@@ -2144,14 +2145,18 @@ namespace std {
 
 template <>
 struct hash<util::monostate> {
-    size_t operator()(util::monostate) noexcept { return 42; }
+    size_t operator()(util::monostate) const noexcept { return 42; }
 };
 
 template <typename... _Types>
 struct hash<util::variant<_Types...>> {
-    size_t operator()(util::variant<_Types...> const& v) noexcept {
-        return std::hash<ptrdiff_t>()(v.index()) ^
-               util::visit(util::__hash_visitor(), v);
+    size_t operator()(util::variant<_Types...> const& v) const noexcept {
+        // Fold the index in before mixing so that alternatives holding equal
+        // values (e.g. variant<int, long>{1} and {1L}) land far apart.
+        return static_cast<size_t>(util::hash_mix(
+            util::visit(util::__hash_visitor(), v) +
+            (static_cast<std::uint64_t>(v.index()) + 1) *
+                0x9e3779b97f4a7c15ULL));
     }
 };
 
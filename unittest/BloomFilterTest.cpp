@@ -0,0 +1,127 @@
+#include "Util/BloomFilter.h"
+
+#include "gtest/gtest.h"
+
+#include "UserId.h"
+
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+TEST(BloomFilterTest, Sizing) {
+    // A block holding few keys has few false positives
+    EXPECT_EQ(bloom_detail::blockFalsePositiveRate(0), 0.0);
+    EXPECT_LT(bloom_detail::blockFalsePositiveRate(1), 1e-11);
+    EXPECT_LT(bloom_detail::falsePositiveRate(4), 0.01);
+    EXPECT_GT(bloom_detail::falsePositiveRate(32), 0.01);
+
+    bloom_filter<int> small(1000, 0.01), large(1000, 0.001);
+    EXPECT_GT(large.block_count(), small.block_count());
+    EXPECT_EQ(small.memory_usage(), small.block_count() * 32);
+    EXPECT_LE(small.false_positive_rate(1000), 0.01);
+    EXPECT_GT(small.false_positive_rate(2000), 0.01);
+    EXPECT_THROW(bloom_filter<int>(10, 0.0), std::invalid_argument);
+    EXPECT_THROW(bloom_filter<int>(10, 1.0), std::invalid_argument);
+    EXPECT_EQ(bloom_filter<int>(0).block_count(), 1u);
+}
+
+TEST(BloomFilterTest, FalsePositiveRate) {
+    for (double target : {0.05, 0.01, 0.001}) {
+        const int n = 100000;
+        bloom_filter<std::uint64_t> filter(n, target);
+        std::mt19937_64 rng(1);
+        std::vector<std::uint64_t> keys(n);
+        for (auto& k : keys) {
+            k = rng() | 1;
+            filter.insert(k);
+        }
+        for (auto k : keys)
+            ASSERT_TRUE(filter.contains(k));
+
+        int falsePositives = 0;
+        const int trials = 1000000;
+        for (int i = 0; i < trials; ++i)
+            falsePositives += filter.contains(rng() & ~std::uint64_t(1));
+        double rate = double(falsePositives) / trials;
+        EXPECT_LT(rate, target * 1.2) << target;
+        EXPECT_GT(rate, target * 0.5) << target;
+    }
+}
+
+TEST(BloomFilterTest, Api) {
+    bloom_filter<std::string, StringHasher<>> names(100);
+    names.insert("alice");
+    names.insert(std::string("bob"));
+    EXPECT_TRUE(names.contains("alice"));
+    EXPECT_TRUE(names.contains(std::string("bob")));
+    EXPECT_FALSE(names.contains("carol"));
+
+    bloom_filter<std::string, StringHasher<>> other(100);
+    other.insert("carol");
+    names.merge(other);
+    EXPECT_TRUE(names.contains("carol"));
+    EXPECT_TRUE(names.contains("alice"));
+    EXPECT_THROW(names.merge(bloom_filter<std::string, StringHasher<>>(10000)),
+                 std::invalid_argument);
+
+    names.clear();
+    EXPECT_FALSE(names.contains("alice"));
+}
+
+TEST(BloomFilterTest, HeterogeneousKeys) {
+    static_assert(!std::is_convertible<int, UserId>::value, "");
+    bloom_filter<UserId, UserIdHasher> users(100);
+    users.insert(UserId{7, "ann"});
+    users.insert(9);
+    EXPECT_TRUE(users.contains(7));
+    EXPECT_TRUE(users.contains(UserId{9, "bob"}));
+
+    counting_bloom_filter<UserId, UserIdHasher> counted(100);
+    counted.insert(7);
+    EXPECT_TRUE(counted.contains(UserId{7, "ann"}));
+    EXPECT_TRUE(counted.erase(7));
+    EXPECT_FALSE(counted.contains(7));
+}
+
+TEST(BloomFilterTest, Counting) {
+    counting_bloom_filter<int> filter(10000, 0.01);
+    EXPECT_EQ(filter.block_count(), bloom_filter<int>(10000, 0.01).block_count());
+    EXPECT_EQ(filter.memory_usage(), filter.block_count() * 128);
+
+    for (int i = 0; i < 10000; ++i)
+        filter.insert(i);
+    for (int i = 0; i < 10000; ++i)
+        ASSERT_TRUE(filter.contains(i));
+
+    // Erasing half of the keys keeps the other half, and brings the false
+    // positive rate on the erased ones down to what it would be without them
+    for (int i = 0; i < 10000; i += 2)
+        EXPECT_TRUE(filter.erase(i));
+    int stillThere = 0;
+    for (int i = 0; i < 10000; ++i) {
+        if (i % 2)
+            ASSERT_TRUE(filter.contains(i));
+        else
+            stillThere += filter.contains(i);
+    }
+    EXPECT_LT(stillThere, 50);
+
+    // A key inserted twice needs two erasures
+    filter.insert(-1);
+    filter.insert(-1);
+    EXPECT_TRUE(filter.erase(-1));
+    EXPECT_TRUE(filter.contains(-1));
+    EXPECT_TRUE(filter.erase(-1));
+
+    filter.clear();
+    EXPECT_FALSE(filter.contains(1));
+    EXPECT_FALSE(filter.erase(1));
+}
+}
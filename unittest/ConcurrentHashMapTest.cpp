@@ -0,0 +1,128 @@
+#include "Util/ConcurrentHashMap.h"
+
+#include "gtest/gtest.h"
+
+#include "UserId.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+using Edge = std::pair<int, int>;
+
+TEST(ConcurrentHashMapTest, Basic) {
+    concurrent_hash_map<Edge, double, PairHasher<Edge>> weights;
+    EXPECT_TRUE(weights.empty());
+    EXPECT_EQ(weights.shard_count(), 64u);
+
+    EXPECT_TRUE(weights.insert_or_assign({1, 2}, 0.5));
+    EXPECT_FALSE(weights.insert_or_assign({1, 2}, 0.25));
+    EXPECT_TRUE(weights.insert_or_assign({2, 1}, 1.0));
+    EXPECT_EQ(weights.size(), 2u);
+
+    auto w = weights.find(Edge{1, 2});
+    ASSERT_TRUE(w);
+    EXPECT_EQ(*w, 0.25);
+    EXPECT_FALSE(weights.find(Edge{3, 3}));
+    EXPECT_TRUE(weights.contains(Edge{2, 1}));
+
+    EXPECT_TRUE(weights.modify(Edge{1, 2}, [](double& v) { v *= 4; }));
+    EXPECT_FALSE(weights.modify(Edge{5, 5}, [](double& v) { v = 0; }));
+    EXPECT_EQ(*weights.find(Edge{1, 2}), 1.0);
+
+    double sum = 0;
+    weights.for_each([&](const Edge&, double v) { sum += v; });
+    EXPECT_EQ(sum, 2.0);
+
+    EXPECT_EQ(weights.erase(Edge{1, 2}), 1u);
+    EXPECT_EQ(weights.erase(Edge{1, 2}), 0u);
+    EXPECT_EQ(weights.size(), 1u);
+    weights.clear();
+    EXPECT_TRUE(weights.empty());
+}
+
+TEST(ConcurrentHashMapTest, HashesOnce) {
+    std::atomic<int> calls(0);
+    concurrent_hash_map<UserId, int, UserIdHasher, UserIdEq> logins(
+        4, UserIdHasher{&calls});
+    logins.reserve(100);
+
+    // One call per operation, inserting as well as looking up
+    EXPECT_TRUE(logins.insert_or_assign(UserId{7, "ann"}, 1));
+    EXPECT_EQ(calls, 1);
+    EXPECT_FALSE(logins.insert_or_assign(UserId{7, "ann"}, 2));
+    EXPECT_EQ(calls, 2);
+
+    // Looked up by the int itself
+    static_assert(!std::is_convertible<int, UserId>::value, "");
+    EXPECT_EQ(*logins.find(7), 2);
+    EXPECT_TRUE(logins.contains(7));
+    EXPECT_TRUE(logins.modify(7, [](int& n) { ++n; }));
+    EXPECT_EQ(*logins.find(7), 3);
+    EXPECT_EQ(calls, 6);
+    EXPECT_EQ(logins.erase(7), 1u);
+    EXPECT_TRUE(logins.empty());
+}
+
+TEST(ConcurrentHashMapTest, ManyKeys) {
+    concurrent_hash_map<std::string, int, StringHasher<>, std::equal_to<>>
+        counts(5);
+    EXPECT_EQ(counts.shard_count(), 8u);
+    counts.reserve(20000);
+    for (int i = 0; i < 20000; ++i)
+        counts.insert_or_assign("key" + std::to_string(i), i);
+    EXPECT_EQ(counts.size(), 20000u);
+    for (int i = 0; i < 20000; i += 7)
+        ASSERT_EQ(*counts.find("key" + std::to_string(i)), i);
+    for (int i = 0; i < 20000; i += 2)
+        counts.erase("key" + std::to_string(i));
+    EXPECT_EQ(counts.size(), 10000u);
+    EXPECT_FALSE(counts.contains("key0"));
+    EXPECT_TRUE(counts.contains("key1"));
+
+    concurrent_hash_map<int, int> single(1);
+    single.insert_or_assign(1, 1);
+    EXPECT_EQ(single.shard_count(), 1u);
+    EXPECT_EQ(*single.find(1), 1);
+}
+
+TEST(ConcurrentHashMapTest, Concurrent) {
+    concurrent_hash_map<Edge, long, PairHasher<Edge>> map;
+    const int numThreads = 8, numKeys = 1000, rounds = 20;
+    for (int k = 0; k < numKeys; ++k)
+        map.insert_or_assign({k, -k}, 0);
+
+    std::atomic<long> misses(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t)
+        threads.emplace_back([&, t] {
+            for (int r = 0; r < rounds; ++r)
+                for (int k = 0; k < numKeys; ++k) {
+                    map.modify(Edge{k, -k}, [](long& v) { ++v; });
+                    // Keys private to this thread come and go
+                    Edge mine{numKeys + t, r};
+                    map.insert_or_assign(mine, r);
+                    if (!map.find(mine))
+                        ++misses;
+                    map.erase(mine);
+                    if (!map.contains(Edge{k, -k}))
+                        ++misses;
+                }
+        });
+    for (auto& th : threads)
+        th.join();
+
+    EXPECT_EQ(misses, 0);
+    EXPECT_EQ(map.size(), std::size_t(numKeys));
+    map.for_each([&](const Edge&, long v) {
+        EXPECT_EQ(v, long(numThreads) * rounds);
+    });
+}
+}
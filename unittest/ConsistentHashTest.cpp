@@ -0,0 +1,265 @@
+#include "Util/ConsistentHash.h"
+
+#include "gtest/gtest.h"
+
+#include "UserId.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+constexpr std::uint64_t kKeys = 20000;
+
+// Checks that every one of the n nodes got its share of the keys, within
+// tolerance
+void expectBalanced(const std::vector<std::size_t>& counts, double tolerance) {
+    double expected = double(kKeys) / counts.size();
+    for (std::size_t i = 0; i < counts.size(); ++i) {
+        EXPECT_GT(counts[i], expected * (1 - tolerance)) << i;
+        EXPECT_LT(counts[i], expected * (1 + tolerance)) << i;
+    }
+}
+
+template <typename Map>
+std::vector<std::uint64_t> assign(const Map& map) {
+    std::vector<std::uint64_t> ret;
+    for (std::uint64_t k = 0; k < kKeys; ++k)
+        ret.push_back(map.node_for(k));
+    return ret;
+}
+
+// Adding a node only moves keys to it, and about 1 / n of them
+template <typename Map>
+void checkAddNode(Map& map, std::uint64_t id) {
+    auto before = assign(map);
+    ASSERT_TRUE(map.add_node(id));
+    auto after = assign(map);
+    std::size_t moved = 0;
+    for (std::size_t k = 0; k < kKeys; ++k) {
+        if (before[k] != after[k]) {
+            ASSERT_EQ(after[k], id) << k;
+            ++moved;
+        }
+    }
+    double expected = double(kKeys) / map.node_count();
+    EXPECT_GT(moved, expected * 0.7);
+    EXPECT_LT(moved, expected * 1.3);
+}
+
+// Removing a node only moves its keys
+template <typename Map>
+void checkRemoveNode(Map& map, std::uint64_t id) {
+    auto before = assign(map);
+    ASSERT_TRUE(map.remove_node(id));
+    EXPECT_FALSE(map.remove_node(id));
+    auto after = assign(map);
+    for (std::size_t k = 0; k < kKeys; ++k) {
+        if (before[k] != id)
+            ASSERT_EQ(after[k], before[k]) << k;
+        else
+            ASSERT_NE(after[k], id) << k;
+    }
+}
+
+} // namespace
+
+TEST(ConsistentHashTest, JumpHash) {
+    EXPECT_THROW(jumpHash(1, 0), std::invalid_argument);
+    EXPECT_THROW(jump_hash<int>(0), std::invalid_argument);
+    for (std::uint64_t k = 0; k < 100; ++k)
+        EXPECT_EQ(jumpHash(k, 1), 0u);
+
+    // Growing from n to n + 1 buckets moves keys to the new bucket only
+    for (std::uint32_t n = 1; n < 40; ++n) {
+        jump_hash<std::uint64_t> a(n), b(n + 1);
+        std::size_t moved = 0;
+        for (std::uint64_t k = 0; k < kKeys; ++k) {
+            auto x = a(k), y = b(k);
+            ASSERT_LT(x, n);
+            if (x != y) {
+                ASSERT_EQ(y, n);
+                ++moved;
+            }
+        }
+        double expected = double(kKeys) / (n + 1);
+        EXPECT_GT(moved, expected * 0.8) << n;
+        EXPECT_LT(moved, expected * 1.2) << n;
+    }
+
+    jump_hash<std::uint64_t> jump(16);
+    std::vector<std::size_t> counts(16);
+    for (std::uint64_t k = 0; k < kKeys; ++k)
+        ++counts[jump(k)];
+    expectBalanced(counts, 0.1);
+}
+
+TEST(ConsistentHashTest, JumpHashTransparent) {
+    jump_hash<std::string, StringHasher<>> jump(10);
+    std::string s = "user-1234";
+    EXPECT_EQ(jump(s), jump("user-1234"));
+    EXPECT_EQ(jump(s), jumpHash(hash_mix(StringHasher<>()(s)), 10));
+}
+
+TEST(ConsistentHashTest, HeterogeneousKeys) {
+    static_assert(!std::is_convertible<int, UserId>::value, "");
+    UserId ann{7, "ann"};
+
+    jump_hash<UserId, UserIdHasher> jump(10);
+    EXPECT_EQ(jump(7), jump(ann));
+
+    rendezvous_hash<UserId, UserIdHasher> hrw;
+    hash_ring<UserId, UserIdHasher> ring;
+    for (std::uint64_t id = 0; id < 5; ++id) {
+        hrw.add_node(id);
+        ring.add_node(id);
+    }
+    EXPECT_EQ(hrw.node_for(7), hrw.node_for(ann));
+    EXPECT_EQ(hrw.nodes_for(7, 2), hrw.nodes_for(ann, 2));
+    EXPECT_EQ(ring.node_for(7), ring.node_for(ann));
+}
+
+TEST(ConsistentHashTest, Rendezvous) {
+    rendezvous_hash<std::uint64_t> hrw;
+    EXPECT_TRUE(hrw.empty());
+    EXPECT_THROW(hrw.node_for(1), std::out_of_range);
+    for (std::uint64_t id = 0; id < 10; ++id)
+        EXPECT_TRUE(hrw.add_node(100 + id));
+    EXPECT_FALSE(hrw.add_node(105));
+    EXPECT_EQ(hrw.node_count(), 10u);
+    EXPECT_TRUE(hrw.contains_node(109));
+    EXPECT_FALSE(hrw.contains_node(110));
+
+    std::vector<std::size_t> counts(10);
+    for (auto node : assign(hrw))
+        ++counts[node - 100];
+    expectBalanced(counts, 0.1);
+
+    checkAddNode(hrw, 42);
+    checkRemoveNode(hrw, 104);
+    checkRemoveNode(hrw, 42);
+}
+
+TEST(ConsistentHashTest, RendezvousOrderIndependent) {
+    rendezvous_hash<std::uint64_t> a, b;
+    for (std::uint64_t id = 0; id < 50; ++id) {
+        a.add_node(id * 7919);
+        b.add_node((49 - id) * 7919);
+    }
+    EXPECT_EQ(assign(a), assign(b));
+}
+
+TEST(ConsistentHashTest, RendezvousRejectsCollidingSeeds) {
+    // Two ids with the same 32-bit seed, found by the birthday bound
+    std::unordered_map<std::uint32_t, std::uint64_t> idOfSeed;
+    std::uint64_t first = 0, second = 0;
+    for (std::uint64_t id = 0; second == 0; ++id) {
+        auto inserted =
+            idOfSeed.emplace(consistent_hash_detail::nodeSeed(id), id);
+        if (!inserted.second) {
+            first = inserted.first->second;
+            second = id;
+        }
+    }
+
+    rendezvous_hash<std::uint64_t> hrw;
+    EXPECT_TRUE(hrw.add_node(first));
+    EXPECT_THROW(hrw.add_node(second), std::invalid_argument);
+    EXPECT_EQ(hrw.node_count(), 1u);
+    EXPECT_TRUE(hrw.remove_node(first));
+    EXPECT_TRUE(hrw.add_node(second));
+}
+
+TEST(ConsistentHashTest, RendezvousScoreLoop) {
+    // The vectorized loop against a plain one, for node counts around its
+    // block size and up to the many nodes it is meant for
+    for (std::size_t n : {1u, 7u, 15u, 16u, 17u, 23u, 24u, 31u, 32u, 40u, 100u,
+                          1024u}) {
+        std::vector<std::uint32_t> seeds;
+        for (std::size_t i = 0; i < n; ++i)
+            seeds.push_back(consistent_hash_detail::nodeSeed(i));
+        // Equal scores go to the lowest index, also when a later block has
+        // it in the same lane
+        if (n > 20)
+            seeds[n - 1] = seeds[n / 2] = seeds[19] = seeds[11];
+        for (std::uint64_t k = 0; k < 2000; ++k) {
+            auto key = hash_mix(k);
+            ASSERT_EQ(consistent_hash_detail::bestScore(key, seeds.data(), n),
+                      consistent_hash_detail::bestScoreScalar(key, seeds.data(),
+                                                              n))
+                << n << " " << k;
+        }
+    }
+}
+
+TEST(ConsistentHashTest, RendezvousReplicas) {
+    rendezvous_hash<std::string, StringHasher<>> hrw;
+    for (std::uint64_t id = 0; id < 20; ++id)
+        hrw.add_node(id);
+    for (int i = 0; i < 1000; ++i) {
+        auto key = "key" + std::to_string(i);
+        auto nodes = hrw.nodes_for(key, 3);
+        ASSERT_EQ(nodes.size(), 3u);
+        EXPECT_EQ(nodes[0], hrw.node_for(key));
+        EXPECT_EQ(std::set<std::uint64_t>(nodes.begin(), nodes.end()).size(),
+                  3u);
+
+        // Without the first node, the second one takes over
+        auto without = hrw;
+        without.remove_node(nodes[0]);
+        EXPECT_EQ(without.node_for(key.c_str()), nodes[1]);
+    }
+    EXPECT_EQ(hrw.nodes_for("key", 100).size(), 20u);
+}
+
+TEST(ConsistentHashTest, Ring) {
+    EXPECT_THROW(hash_ring<int>(0), std::invalid_argument);
+    hash_ring<std::uint64_t> ring;
+    EXPECT_THROW(ring.node_for(1), std::out_of_range);
+    EXPECT_THROW(ring.add_node(1, 0), std::invalid_argument);
+    for (std::uint64_t id = 0; id < 8; ++id)
+        EXPECT_TRUE(ring.add_node(id << 40));
+    EXPECT_FALSE(ring.add_node(0));
+    EXPECT_EQ(ring.node_count(), 8u);
+    EXPECT_EQ(ring.point_count(), 8u * 160);
+
+    std::vector<std::size_t> counts(8);
+    for (auto node : assign(ring))
+        ++counts[node >> 40];
+    expectBalanced(counts, 0.25);
+
+    checkAddNode(ring, 12345);
+    checkRemoveNode(ring, std::uint64_t(3) << 40);
+    checkRemoveNode(ring, 12345);
+    EXPECT_EQ(ring.point_count(), 7u * 160);
+}
+
+TEST(ConsistentHashTest, RingWeights) {
+    hash_ring<std::uint64_t> ring(100);
+    ring.add_node(1, 100);
+    ring.add_node(2, 300);
+    std::size_t heavy = 0;
+    for (auto node : assign(ring))
+        heavy += node == 2;
+    EXPECT_GT(heavy, kKeys * 0.65);
+    EXPECT_LT(heavy, kKeys * 0.85);
+}
+
+TEST(ConsistentHashTest, RingOrderIndependent) {
+    hash_ring<std::uint64_t> a, b;
+    for (std::uint64_t id = 0; id < 20; ++id) {
+        a.add_node(id);
+        b.add_node(19 - id);
+    }
+    b.add_node(100);
+    b.remove_node(100);
+    EXPECT_EQ(assign(a), assign(b));
+}
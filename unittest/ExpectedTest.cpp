@@ -0,0 +1,191 @@
+#include "Util/Expected.h"
+
+#include "gtest/gtest.h"
+
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+using namespace util;
+
+namespace {
+
+enum class ParseError { Empty, BadDigit, Overflow };
+
+expected<int, ParseError> parseDigit(const std::string& s) {
+    if (s.empty())
+        return make_unexpected(ParseError::Empty);
+    if (s.size() > 1)
+        return make_unexpected(ParseError::Overflow);
+    if (s[0] < '0' || s[0] > '9')
+        return make_unexpected(ParseError::BadDigit);
+    return s[0] - '0';
+}
+
+struct Counted {
+    static int alive;
+    int v;
+
+    Counted(int v) : v(v) { ++alive; }
+    Counted(const Counted& o) : v(o.v) { ++alive; }
+    Counted(Counted&& o) : v(o.v) { ++alive; }
+    Counted& operator=(const Counted&) = default;
+    Counted& operator=(Counted&&) = default;
+    ~Counted() { --alive; }
+};
+int Counted::alive = 0;
+
+// Counted, with copies that throw on demand
+struct ThrowingCopy {
+    static bool throwOnCopy;
+    Counted c;
+
+    ThrowingCopy(int v) : c(v) {}
+    ThrowingCopy(const ThrowingCopy& o) : c(o.c) {
+        if (throwOnCopy)
+            throw std::runtime_error("copy");
+    }
+    ThrowingCopy& operator=(const ThrowingCopy&) = default;
+};
+bool ThrowingCopy::throwOnCopy = false;
+
+TEST(ExpectedTest, ValueAndError) {
+    auto r = parseDigit("7");
+    EXPECT_TRUE(r.has_value());
+    EXPECT_TRUE(bool(r));
+    EXPECT_EQ(*r, 7);
+    EXPECT_EQ(r.value(), 7);
+    EXPECT_EQ(r.value_or(-1), 7);
+
+    auto e = parseDigit("x");
+    EXPECT_FALSE(e.has_value());
+    EXPECT_EQ(e.error(), ParseError::BadDigit);
+    EXPECT_EQ(e.value_or(-1), -1);
+    EXPECT_TRUE(e == make_unexpected(ParseError::BadDigit));
+    EXPECT_TRUE(e != make_unexpected(ParseError::Empty));
+    EXPECT_FALSE(e.to_optional());
+    EXPECT_EQ(*r.to_optional(), 7);
+}
+
+TEST(ExpectedTest, ValueThrowsCarryingError) {
+    auto e = parseDigit("");
+    try {
+        e.value();
+        FAIL();
+    } catch (const bad_expected_access<ParseError>& ex) {
+        EXPECT_EQ(ex.error(), ParseError::Empty);
+    }
+}
+
+TEST(ExpectedTest, TriviallyCopyable) {
+    static_assert(std::is_trivially_copyable<expected<int, ParseError>>::value,
+                  "expected of trivial types should be trivially copyable");
+    static_assert(
+        std::is_trivially_destructible<expected<double, int>>::value,
+        "expected of trivial types should be trivially destructible");
+    static_assert(
+        !std::is_trivially_copyable<expected<std::string, int>>::value,
+        "expected<string, int> cannot be trivially copyable");
+
+    constexpr expected<int, ParseError> c{3};
+    static_assert(c.has_value() && *c == 3, "constexpr value");
+    constexpr expected<int, ParseError> ce{unexpect, ParseError::Overflow};
+    static_assert(!ce && ce.error() == ParseError::Overflow, "constexpr error");
+}
+
+TEST(ExpectedTest, Assignment) {
+    expected<std::string, int> a{"abc"};
+    expected<std::string, int> b{unexpect, 42};
+
+    a = b;
+    EXPECT_FALSE(a);
+    EXPECT_EQ(a.error(), 42);
+
+    a = std::string("def");
+    EXPECT_EQ(*a, "def");
+    EXPECT_EQ(a->size(), 3u);
+
+    b = a;
+    EXPECT_TRUE(a == b);
+
+    b = make_unexpected(7);
+    EXPECT_EQ(b.error(), 7);
+
+    b.emplace(3, 'x');
+    EXPECT_EQ(*b, "xxx");
+
+    expected<std::string, int> c{std::move(b)};
+    EXPECT_EQ(*c, "xxx");
+}
+
+TEST(ExpectedTest, Lifetime) {
+    {
+        expected<Counted, std::string> a{in_place, 1};
+        EXPECT_EQ(Counted::alive, 1);
+
+        auto b = a;
+        EXPECT_EQ(Counted::alive, 2);
+
+        b = make_unexpected(std::string("err"));
+        EXPECT_EQ(Counted::alive, 1);
+
+        a = b;
+        EXPECT_EQ(Counted::alive, 0);
+        EXPECT_EQ(a.error(), "err");
+
+        a = Counted(5);
+        EXPECT_EQ(Counted::alive, 1);
+        EXPECT_EQ(a->v, 5);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(ExpectedTest, MoveOnly) {
+    expected<std::unique_ptr<int>, int> p{std::unique_ptr<int>(new int(4))};
+    auto q = std::move(p);
+    EXPECT_EQ(**q, 4);
+
+    std::unique_ptr<int> r = std::move(q).value();
+    EXPECT_EQ(*r, 4);
+}
+
+TEST(ExpectedTest, ThrowingConstructionKeepsOldAlternative) {
+    {
+        ThrowingCopy v(1), w(2);
+        auto err = make_unexpected(w);
+        EXPECT_EQ(Counted::alive, 3);
+        ThrowingCopy::throwOnCopy = true;
+
+        expected<ThrowingCopy, Counted> a{in_place, 3};
+        EXPECT_THROW(a.emplace(v), std::runtime_error);
+        ASSERT_TRUE(a.has_value());
+        EXPECT_EQ(a->c.v, 3);
+
+        expected<ThrowingCopy, Counted> b{unexpect, 4};
+        EXPECT_THROW(b.emplace(v), std::runtime_error);
+        EXPECT_THROW(b = w, std::runtime_error);
+        ASSERT_FALSE(b.has_value());
+        EXPECT_EQ(b.error().v, 4);
+
+        expected<Counted, ThrowingCopy> c{in_place, 5};
+        EXPECT_THROW(c = err, std::runtime_error);
+        ASSERT_TRUE(c.has_value());
+        EXPECT_EQ(c->v, 5);
+
+        ThrowingCopy::throwOnCopy = false;
+        expected<ThrowingCopy, Counted> d{in_place, 6};
+        ThrowingCopy::throwOnCopy = true;
+        EXPECT_THROW(b = d, std::runtime_error);
+        ASSERT_FALSE(b.has_value());
+        EXPECT_EQ(b.error().v, 4);
+        ThrowingCopy::throwOnCopy = false;
+
+        b = d;
+        EXPECT_EQ(b->c.v, 6);
+        // 2 locals, a, c, d and b, plus the copy of w in err
+        EXPECT_EQ(Counted::alive, 7);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+}
+}
@@ -0,0 +1,260 @@
+#include "Util/FlatHashMap.h"
+
+#include "gtest/gtest.h"
+
+#include "UserId.h"
+
+#include <cstdint>
+#include <memory>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+struct Counted {
+    static int alive;
+    int v;
+
+    Counted(int v) : v(v) { ++alive; }
+    Counted(const Counted& o) : v(o.v) { ++alive; }
+    Counted(Counted&& o) : v(o.v) { ++alive; }
+    Counted& operator=(const Counted&) = default;
+    ~Counted() { --alive; }
+};
+int Counted::alive = 0;
+
+// Sends every key to the same probe sequence
+struct ConstantHasher {
+    std::size_t operator()(int) const { return 0; }
+};
+
+TEST(FlatHashMapTest, Basic) {
+    flat_hash_map<int, std::string> map;
+    EXPECT_TRUE(map.empty());
+    EXPECT_EQ(map.find(1), map.end());
+    EXPECT_EQ(map.begin(), map.end());
+
+    EXPECT_TRUE(map.insert({1, "one"}).second);
+    EXPECT_FALSE(map.insert({1, "uno"}).second);
+    EXPECT_TRUE(map.emplace(2, "two").second);
+    EXPECT_TRUE(map.try_emplace(3, 3, 'x').second);
+    map[4] = "four";
+
+    EXPECT_EQ(map.size(), 4u);
+    EXPECT_EQ(map.at(1), "one");
+    EXPECT_EQ(map[3], "xxx");
+    EXPECT_EQ(map.find(2)->second, "two");
+    EXPECT_TRUE(map.contains(4));
+    EXPECT_EQ(map.count(5), 0u);
+    EXPECT_THROW(map.at(5), std::out_of_range);
+
+    EXPECT_FALSE(map.insert_or_assign(4, "FOUR").second);
+    EXPECT_EQ(map[4], "FOUR");
+
+    EXPECT_EQ(map.erase(1), 1u);
+    EXPECT_EQ(map.erase(1), 0u);
+    EXPECT_FALSE(map.contains(1));
+    EXPECT_EQ(map.size(), 3u);
+
+    std::size_t seen = 0;
+    for (const auto& kv : map) {
+        EXPECT_EQ(map.at(kv.first), kv.second);
+        ++seen;
+    }
+    EXPECT_EQ(seen, 3u);
+
+    map.clear();
+    EXPECT_TRUE(map.empty());
+    EXPECT_FALSE(map.contains(2));
+}
+
+TEST(FlatHashMapTest, MatchesUnorderedMap) {
+    std::mt19937 rng(5);
+    flat_hash_map<std::uint32_t, std::uint32_t> map;
+    std::unordered_map<std::uint32_t, std::uint32_t> ref;
+    for (int i = 0; i < 200000; ++i) {
+        auto k = rng() % 5000;
+        switch (rng() % 3) {
+        case 0:
+            map[k] = i;
+            ref[k] = i;
+            break;
+        case 1:
+            EXPECT_EQ(map.erase(k), ref.erase(k));
+            break;
+        default:
+            EXPECT_EQ(map.count(k), ref.count(k));
+        }
+    }
+    EXPECT_EQ(map.size(), ref.size());
+    for (const auto& kv : ref)
+        EXPECT_EQ(map.at(kv.first), kv.second);
+    EXPECT_LE(map.load_factor(), map.max_load_factor());
+}
+
+TEST(FlatHashMapTest, CollidingKeys) {
+    // Every key shares the same probe sequence and most share H2 as well
+    flat_hash_set<int, ConstantHasher> set;
+    for (int i = 0; i < 100; ++i)
+        EXPECT_TRUE(set.insert(i).second);
+    for (int i = 0; i < 100; i += 2)
+        EXPECT_EQ(set.erase(i), 1u);
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(set.contains(i), i % 2 == 1);
+    for (int i = 0; i < 100; i += 2)
+        EXPECT_TRUE(set.insert(i).second);
+    EXPECT_EQ(set.size(), 100u);
+}
+
+TEST(FlatHashMapTest, EraseDoesNotGrow) {
+    // A sliding window of keys: the table never holds more than 1000
+    // elements, so churning through a million of them must not grow it
+    flat_hash_set<int> set;
+    set.reserve(1000);
+    auto capacity = set.capacity();
+    for (int i = 0; i < 1000000; ++i) {
+        set.insert(i);
+        if (i >= 1000)
+            set.erase(i - 1000);
+    }
+    EXPECT_EQ(set.size(), 1000u);
+    EXPECT_EQ(set.capacity(), capacity);
+    for (int i = 1000000 - 1000; i < 1000000; ++i)
+        EXPECT_TRUE(set.contains(i));
+}
+
+TEST(FlatHashMapTest, Reserve) {
+    flat_hash_map<int, int> map;
+    map.reserve(1000);
+    auto capacity = map.capacity();
+    EXPECT_GE(capacity * 7 / 8, 1000u);
+    std::vector<const int*> addresses;
+    for (int i = 0; i < 1000; ++i)
+        addresses.push_back(&map.emplace(i, i).first->second);
+    EXPECT_EQ(map.capacity(), capacity);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(&map.at(i), addresses[i]);
+
+    map.rehash(0);
+    EXPECT_EQ(map.size(), 1000u);
+    EXPECT_EQ(map.capacity(), capacity);
+    map.clear();
+    map.rehash(0);
+    EXPECT_EQ(map.capacity(), 0u);
+}
+
+TEST(FlatHashMapTest, HeterogeneousLookup) {
+    flat_hash_map<std::string, int, StringHasher<>, std::equal_to<>> map;
+    map["apple"] = 1;
+    map["pear"] = 2;
+    EXPECT_EQ(map.find("apple")->second, 1);
+    EXPECT_TRUE(map.contains("pear"));
+    EXPECT_EQ(map.at("pear"), 2);
+    EXPECT_EQ(map.count("plum"), 0u);
+    EXPECT_EQ(map.erase("apple"), 1u);
+    EXPECT_EQ(map.size(), 1u);
+
+    EXPECT_EQ(StringHasher<>()("pear"), hashContainer(std::string("pear")));
+}
+
+TEST(FlatHashMapTest, TryEmplaceWithHash) {
+    flat_hash_map<std::string, int, StringHasher<>> map;
+    std::string key = "apple";
+    auto h = map.hash_function()(key);
+    EXPECT_TRUE(map.try_emplace_with_hash(h, key, 1).second);
+    EXPECT_FALSE(map.try_emplace_with_hash(h, std::string(key), 2).second);
+    EXPECT_EQ(map.at("apple"), 1);
+    EXPECT_EQ(map.try_emplace_with_hash(map.hash_function()("pear"),
+                                        std::string("pear"), 3)
+                  .first->second,
+              3);
+    EXPECT_EQ(map.at("pear"), 3);
+}
+
+TEST(FlatHashMapTest, HeterogeneousLookupWithoutConversion) {
+    static_assert(!std::is_convertible<int, UserId>::value, "");
+    flat_hash_set<UserId, UserIdHasher, UserIdEq> users;
+    users.insert(UserId{7, "ann"});
+    users.insert(UserId{9, "bob"});
+    EXPECT_EQ(users.find(7)->name, "ann");
+    EXPECT_TRUE(users.contains(9));
+    EXPECT_EQ(users.count(8), 0u);
+    EXPECT_EQ(users.erase(9), 1u);
+    EXPECT_EQ(users.size(), 1u);
+
+    flat_hash_map<UserId, int, UserIdHasher, UserIdEq> logins;
+    logins.try_emplace(UserId{7, "ann"}, 3);
+    EXPECT_EQ(logins.at(7), 3);
+    EXPECT_THROW(logins.at(8), std::out_of_range);
+}
+
+TEST(FlatHashMapTest, UtilHashers) {
+    using Key = std::pair<int, int>;
+    flat_hash_map<Key, int, PairHasher<Key>> pairs;
+    for (int i = 0; i < 100; ++i)
+        for (int j = 0; j < 100; ++j)
+            pairs[{i, j}] = i * j;
+    EXPECT_EQ(pairs.size(), 10000u);
+    EXPECT_EQ(pairs.at({7, 9}), 63);
+
+    flat_hash_set<std::vector<int>, ContainerHasher<std::vector<int>>> vectors{
+        {1, 2}, {2, 1}, {1, 2}};
+    EXPECT_EQ(vectors.size(), 2u);
+}
+
+TEST(FlatHashMapTest, CopyAndMove) {
+    flat_hash_map<int, std::unique_ptr<int>> owned;
+    owned.emplace(1, std::unique_ptr<int>(new int(10)));
+    auto moved = std::move(owned);
+    EXPECT_TRUE(owned.empty());
+    EXPECT_EQ(*moved.at(1), 10);
+
+    flat_hash_set<std::string> a{"x", "y", "z"};
+    auto b = a;
+    EXPECT_TRUE(a == b);
+    b.erase("x");
+    EXPECT_TRUE(a != b);
+    b = a;
+    EXPECT_TRUE(a == b);
+    swap(a, b);
+    EXPECT_EQ(a.size(), 3u);
+}
+
+TEST(FlatHashMapTest, Lifetime) {
+    {
+        flat_hash_map<int, Counted> map;
+        for (int i = 0; i < 1000; ++i)
+            map.try_emplace(i, i);
+        EXPECT_EQ(Counted::alive, 1000);
+        for (int i = 0; i < 500; ++i)
+            map.erase(i);
+        EXPECT_EQ(Counted::alive, 500);
+        auto copy = map;
+        EXPECT_EQ(Counted::alive, 1000);
+        copy.clear();
+        EXPECT_EQ(Counted::alive, 500);
+    }
+    EXPECT_EQ(Counted::alive, 0);
+}
+
+TEST(FlatHashMapTest, EraseWhileIterating) {
+    flat_hash_set<int> set;
+    for (int i = 0; i < 1000; ++i)
+        set.insert(i);
+    for (auto it = set.begin(); it != set.end();) {
+        if (*it % 3 == 0)
+            it = set.erase(it);
+        else
+            ++it;
+    }
+    EXPECT_EQ(set.size(), 666u);
+    for (int i = 0; i < 1000; ++i)
+        EXPECT_EQ(set.contains(i), i % 3 != 0);
+}
+}
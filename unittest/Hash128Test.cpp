@@ -0,0 +1,168 @@
+#include "Util/Hash128.h"
+
+#include "Util/FlatHashMap.h"
+
+#include "gtest/gtest.h"
+
+#include <array>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+TEST(Hash128Test, Fingerprint) {
+    constexpr fingerprint128 a(1, 2), b(2, 1), c(1, 2);
+    static_assert(a == c && a != b, "");
+    static_assert(b < a && a > b && b <= a && a >= c && a <= c, "");
+    EXPECT_EQ(fingerprint128(), fingerprint128(0, 0));
+    EXPECT_EQ(std::hash<fingerprint128>()(a), 1u);
+    static_assert(is_uniquely_represented<fingerprint128>::value, "");
+
+    flat_hash_set<fingerprint128> set;
+    for (std::uint64_t i = 0; i < 1000; ++i)
+        set.insert(hashValues128(i));
+    EXPECT_EQ(set.size(), 1000u);
+    EXPECT_TRUE(set.count(hashValues128(std::uint64_t(42))));
+}
+
+TEST(Hash128Test, BytesLowWordIs64BitHash) {
+    std::string s;
+    for (std::size_t len = 0; len < 2100; ++len) {
+        auto f = hashBytes128(s.data(), s.size());
+        ASSERT_EQ(f.lo, hashBytes(s.data(), s.size())) << len;
+        ASSERT_NE(f.lo, f.hi) << len;
+        ASSERT_EQ(hashBytes128(s.data(), s.size(), 7).lo,
+                  hashBytes(s.data(), s.size(), 7))
+            << len;
+        s.push_back(char('a' + len * 7 % 26));
+    }
+}
+
+TEST(Hash128Test, BytesHighWord) {
+    // Every length and every single-byte change gives a different high word
+    std::set<std::uint64_t> seen;
+    std::string s(300, 'x');
+    for (std::size_t len = 0; len <= s.size(); ++len)
+        EXPECT_TRUE(seen.insert(hashBytes128(s.data(), len).hi).second) << len;
+    for (std::size_t i = 0; i < s.size(); ++i) {
+        auto t = s;
+        t[i] = 'y';
+        EXPECT_TRUE(seen.insert(hashBytes128(t.data(), t.size()).hi).second)
+            << i;
+    }
+    EXPECT_NE(hashBytes128(s.data(), s.size(), 1).hi,
+              hashBytes128(s.data(), s.size(), 2).hi);
+
+    // About half the bits of the high word flip with one input bit
+    std::size_t flipped = 0, trials = 0;
+    for (std::size_t i = 0; i < 100; ++i) {
+        for (int bit = 0; bit < 8; ++bit, ++trials) {
+            auto t = s;
+            t[i] ^= char(1 << bit);
+            flipped += __builtin_popcountll(
+                hashBytes128(s.data(), 100).hi ^ hashBytes128(t.data(), 100).hi);
+        }
+    }
+    EXPECT_NEAR(double(flipped) / trials, 32, 1);
+}
+
+TEST(Hash128Test, Hasher) {
+    Hasher h64;
+    Hasher128 h128;
+    for (std::uint64_t w : {1u, 2u, 3u}) {
+        h64.addHash(w);
+        h128.addHash(w);
+    }
+    EXPECT_EQ(h128.finish().lo, h64.finish());
+    EXPECT_NE(Hasher128(1).addHash(1).finish(),
+              Hasher128(2).addHash(1).finish());
+
+    constexpr auto f = Hasher128().addHash(7).finish();
+    static_assert(f.lo != 0 && f.hi != 0, "");
+}
+
+TEST(Hash128Test, Values) {
+    EXPECT_EQ(hashValues128(1, 2, 3).lo, hashValues(1, 2, 3));
+    EXPECT_NE(hashValues128(1, 2), hashValues128(2, 1));
+    EXPECT_EQ(hashValues128(std::string("ab"), 1),
+              Hasher128().add(std::string("ab")).add(1).finish());
+    // Strings are added as their 128-bit hash
+    EXPECT_EQ(hashValues128(std::string("ab")),
+              Hasher128().addHash(hashBytes128("ab", 2)).finish());
+    EXPECT_EQ(hashValues128(std::make_pair(1, std::string("x"))),
+              hashValues128(1, std::string("x")));
+}
+
+TEST(Hash128Test, Containers) {
+    std::vector<int> v{1, 2, 3, 4, 5};
+    EXPECT_EQ(hashContainer128(v), hashBytes128(v.data(), 5 * sizeof(int)));
+    EXPECT_EQ(hashContainer128(v).lo, hashContainer(v));
+    EXPECT_EQ(hashContainer128(v), hashRange128(v.data(), v.data() + 5));
+    EXPECT_EQ(hashContainer128(v), hashRange128(v.begin(), v.end()));
+    EXPECT_EQ(hashRange128(v.begin(), v.end()).lo,
+              hashRange(v.begin(), v.end()));
+    EXPECT_EQ(hashContainer128(std::string("hello")),
+              hashBytes128("hello", 5));
+
+    std::list<int> l(v.begin(), v.end());
+    EXPECT_EQ(hashContainer128(l), hashRange128(l.begin(), l.end()));
+    EXPECT_EQ(hashContainer128(l).lo, hashContainer(l));
+    EXPECT_EQ(hashContainer128(l), hashValues128(1, 2, 3, 4, 5));
+
+    // Nested containers, element boundaries included
+    using Doc = std::vector<std::string>;
+    EXPECT_NE(hashContainer128(Doc{"ab", "c"}),
+              hashContainer128(Doc{"a", "bc"}));
+    EXPECT_NE(hashContainer128(Doc{"ab", ""}), hashContainer128(Doc{"ab"}));
+    EXPECT_EQ(ContainerFingerprinter<Doc>()(Doc{"a"}),
+              hashContainer128(Doc{"a"}));
+    std::vector<Doc> docs{{"a", "b"}, {"c"}};
+    EXPECT_EQ(hashContainer128(docs),
+              hashValues128(Doc{"a", "b"}, Doc{"c"}));
+
+    std::map<int, std::string> m{{1, "one"}, {2, "two"}};
+    EXPECT_EQ(hashContainer128(m),
+              hashValues128(1, std::string("one"), 2, std::string("two")));
+
+    std::array<fingerprint128, 2> fs{{{1, 2}, {3, 4}}};
+    EXPECT_EQ(hashContainer128(fs), hashBytes128(fs.data(), sizeof(fs)));
+}
+
+TEST(Hash128Test, RangeWithProjection) {
+    std::vector<std::pair<int, std::string>> v{{1, "a"}, {2, "b"}};
+    auto byName = hashRange128(
+        v.begin(), v.end(),
+        [](const std::pair<int, std::string>& p) { return p.second; });
+    EXPECT_EQ(byName, hashValues128(std::string("a"), std::string("b")));
+}
+
+TEST(Hash128Test, Combine) {
+    fingerprint128 a, b;
+    hash_combine128(a, 1);
+    hash_combine128(a, std::string("x"));
+    hash_combine128(b, std::string("x"));
+    hash_combine128(b, 1);
+    EXPECT_NE(a, b);
+    // hash_combine128 leaves the state unfinalized, as hash_combine does
+    std::size_t seed64 = 0;
+    hash_combine(seed64, 1);
+    fingerprint128 seed128;
+    hash_combine128(seed128, 1);
+    EXPECT_EQ(seed128.lo, seed64);
+}
+
+TEST(Hash128Test, NoCollisions) {
+    // Short keys differing in a few bits: no two fingerprints share either
+    // word
+    std::set<std::uint64_t> los, his;
+    for (std::uint32_t i = 0; i < 200000; ++i) {
+        auto f = hashBytes128(&i, sizeof(i));
+        EXPECT_TRUE(los.insert(f.lo).second);
+        EXPECT_TRUE(his.insert(f.hi).second);
+    }
+}
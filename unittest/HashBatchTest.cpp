@@ -0,0 +1,88 @@
+#include "Util/HashBatch.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+template <typename T>
+std::vector<T> randomColumn(std::size_t n) {
+    std::mt19937_64 rng(5);
+    std::vector<T> keys(n);
+    for (auto& k : keys)
+        k = static_cast<T>(rng());
+    // Small and negative values too, which sign extension must get right
+    for (std::size_t i = 0; i < n && i < 16; ++i)
+        keys[i] = static_cast<T>(int(i) - 8);
+    return keys;
+}
+
+template <typename T>
+void checkIntegers() {
+    // Lengths that leave every possible tail after the vector loop
+    for (std::size_t n : {0u, 1u, 3u, 4u, 5u, 7u, 8u, 1001u}) {
+        auto keys = randomColumn<T>(n);
+        std::vector<std::uint64_t> out(n + 1, 42);
+        hash_batch(keys.data(), n, out.data());
+        for (std::size_t i = 0; i < n; ++i)
+            ASSERT_EQ(out[i], hashValues(keys[i])) << i;
+        EXPECT_EQ(out[n], 42u);
+    }
+}
+
+TEST(HashBatchTest, Integers) {
+    checkIntegers<std::int64_t>();
+    checkIntegers<std::uint64_t>();
+    checkIntegers<std::int32_t>();
+    checkIntegers<std::uint32_t>();
+    checkIntegers<std::int16_t>();
+    checkIntegers<char>();
+    checkIntegers<long long>();
+}
+
+template <typename A, typename B>
+void checkPairs() {
+    using Pair = std::pair<A, B>;
+    for (std::size_t n : {0u, 2u, 4u, 6u, 999u}) {
+        auto firsts = randomColumn<A>(n);
+        auto seconds = randomColumn<B>(n + 3);
+        std::vector<Pair> keys;
+        for (std::size_t i = 0; i < n; ++i)
+            keys.emplace_back(firsts[i], seconds[i + 3]);
+        std::vector<std::uint64_t> out(n);
+        hash_batch(keys.data(), n, out.data());
+        for (std::size_t i = 0; i < n; ++i)
+            ASSERT_EQ(out[i], PairHasher<Pair>()(keys[i])) << i;
+    }
+}
+
+TEST(HashBatchTest, Pairs) {
+    checkPairs<std::int32_t, std::int32_t>();
+    checkPairs<std::uint32_t, std::int32_t>();
+    checkPairs<std::int32_t, std::uint32_t>();
+    checkPairs<std::int64_t, std::int32_t>();
+    checkPairs<std::int16_t, std::uint8_t>();
+}
+
+TEST(HashBatchTest, FixedWidthStrings) {
+    std::mt19937_64 rng(7);
+    for (std::size_t width = 0; width <= 80; ++width) {
+        std::size_t n = 37;
+        std::string data(width * n, '\0');
+        for (auto& c : data)
+            c = static_cast<char>(rng());
+        std::vector<std::uint64_t> out(n);
+        hash_batch(data.data(), width, n, out.data());
+        for (std::size_t i = 0; i < n; ++i)
+            ASSERT_EQ(out[i], StringHasher<>()(data.substr(i * width, width)))
+                << width << " " << i;
+    }
+}
+}
@@ -0,0 +1,168 @@
+#include "Util/Hashed.h"
+#include "Util/FlatHashMap.h"
+#include "Util/Hashing.h"
+
+#include "gtest/gtest.h"
+
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+using Path = std::vector<std::string>;
+
+// Counts its calls, to check that the hash is computed once per value
+struct CountingHasher {
+    static int calls;
+    std::size_t operator()(const Path& p) const {
+        ++calls;
+        return ContainerHasher<Path>()(p);
+    }
+};
+int CountingHasher::calls = 0;
+
+// Every value collides, so equality has to fall back to the values
+struct ConstantHasher {
+    std::size_t operator()(const std::string&) const { return 42; }
+};
+
+// Throws while fail is set
+struct ThrowingHasher {
+    static bool fail;
+    std::size_t operator()(const std::string& s) const {
+        if (fail)
+            throw std::runtime_error("ThrowingHasher");
+        return std::hash<std::string>()(s);
+    }
+};
+bool ThrowingHasher::fail = false;
+
+TEST(HashedTest, CachesTheHash) {
+    CountingHasher::calls = 0;
+    std::unordered_map<hashed<Path, CountingHasher>, int> index;
+    for (int i = 0; i < 1000; ++i)
+        index.emplace(Path{"dir", std::to_string(i)}, i);
+    EXPECT_EQ(CountingHasher::calls, 1000);
+
+    hashed<Path, CountingHasher> key(Path{"dir", "500"});
+    EXPECT_EQ(key.hash(), ContainerHasher<Path>()(*key));
+    for (int i = 0; i < 10; ++i)
+        EXPECT_EQ(index.at(key), 500);
+    index.rehash(10000);
+    EXPECT_EQ(CountingHasher::calls, 1001);
+    EXPECT_EQ(index.count(Path{"dir", "1000"}), 0u);
+}
+
+TEST(HashedTest, Api) {
+    hashed<std::string> empty;
+    EXPECT_EQ(empty.hash(), std::hash<std::string>()(""));
+
+    hashed<std::string> a("abc"), b(in_place, 3, 'x');
+    EXPECT_EQ(*b, "xxx");
+    EXPECT_EQ(b->size(), 3u);
+    EXPECT_EQ(std::hash<hashed<std::string>>()(a),
+              std::hash<std::string>()("abc"));
+    const std::string& ref = a;
+    EXPECT_EQ(ref, "abc");
+    EXPECT_NE(a, b);
+
+    b = "abc";
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.hash(), b.hash());
+
+    auto size = a.modify([](std::string& s) {
+        s += "def";
+        return s.size();
+    });
+    EXPECT_EQ(size, 6u);
+    EXPECT_EQ(a.hash(), std::hash<std::string>()("abcdef"));
+    EXPECT_THROW(a.modify([](std::string& s) {
+        s = "changed";
+        throw std::runtime_error("oops");
+    }),
+                 std::runtime_error);
+    EXPECT_EQ(a.hash(), std::hash<std::string>()("changed"));
+
+    swap(a, b);
+    EXPECT_EQ(*a, "abc");
+    EXPECT_EQ(b.hash(), std::hash<std::string>()("changed"));
+    auto moved = std::move(a).value();
+    EXPECT_EQ(moved, "abc");
+
+    hashed<std::vector<int>, ContainerHasher<std::vector<int>>> list(
+        in_place, {1, 2, 3});
+    EXPECT_EQ(list.hash(), hashContainer(std::vector<int>{1, 2, 3}));
+}
+
+TEST(HashedTest, StaleAfterThrow) {
+    // fn throwing leaves the cache stale instead of rehashing, and hash()
+    // computes the hash until the next update
+    CountingHasher::calls = 0;
+    hashed<Path, CountingHasher> path(Path{"a"});
+    EXPECT_THROW(path.modify([](Path& p) {
+        p.push_back("b");
+        throw std::runtime_error("oops");
+    }),
+                 std::runtime_error);
+    EXPECT_EQ(CountingHasher::calls, 1);
+    EXPECT_EQ(path.hash(), ContainerHasher<Path>()(Path{"a", "b"}));
+    path.modify([](Path& p) { p.pop_back(); });
+    EXPECT_EQ(CountingHasher::calls, 3);
+    EXPECT_EQ(path.hash(), ContainerHasher<Path>()(Path{"a"}));
+    EXPECT_EQ(CountingHasher::calls, 3);
+
+    // A throwing hasher propagates out of modify and assignments
+    using Throwing = hashed<std::string, ThrowingHasher>;
+    static_assert(!noexcept(std::declval<const Throwing&>().hash()), "");
+    static_assert(noexcept(std::declval<const hashed<std::string>&>().hash()),
+                  "");
+    Throwing s("abc");
+    ThrowingHasher::fail = true;
+    EXPECT_THROW(s.modify([](std::string& v) { v += "d"; }),
+                 std::runtime_error);
+    EXPECT_THROW(s = "x", std::runtime_error);
+    ThrowingHasher::fail = false;
+    EXPECT_EQ(*s, "x");
+    EXPECT_EQ(s.hash(), std::hash<std::string>()("x"));
+
+    // References returned by fn are passed through
+    std::string& ref = s.modify([](std::string& v) -> std::string& {
+        return v += "y";
+    });
+    EXPECT_EQ(&ref, &*s);
+    EXPECT_EQ(s.hash(), std::hash<std::string>()("xy"));
+}
+
+TEST(HashedTest, EqualityOnCollisions) {
+    hashed<std::string, ConstantHasher> x("x"), y("y"), x2("x");
+    EXPECT_EQ(x.hash(), y.hash());
+    EXPECT_NE(x, y);
+    EXPECT_EQ(x, x2);
+}
+
+TEST(HashedTest, WithUtilHashers) {
+    using Key = hashed<Path, ContainerHasher<Path>>;
+    Key k(Path{"a", "b"});
+    EXPECT_EQ(hashValues(k, 1), hashValues(k.hash(), 1));
+    std::list<std::size_t> hashes{k.hash()};
+    EXPECT_EQ(hashContainer(std::vector<Key>{k}),
+              hashRange(hashes.begin(), hashes.end()));
+
+    std::unordered_set<std::pair<Key, int>, PairHasher<std::pair<Key, int>>>
+        pairs;
+    pairs.emplace(k, 1);
+    EXPECT_EQ(pairs.count(std::make_pair(k, 1)), 1u);
+
+    flat_hash_map<Key, int> map;
+    map[k] = 3;
+    map[Key(Path{"a"})] = 4;
+    EXPECT_EQ(map.at(Key(Path{"a", "b"})), 3);
+    EXPECT_EQ(map.size(), 2u);
+}
+}
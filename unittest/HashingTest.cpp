@@ -0,0 +1,440 @@
+#include "Util/Hashing.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <random>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+// Flips every input bit of random keys and records how often each output bit
+// flips in response. Returns the worst deviation from the ideal 50%, as in
+// SMHasher's avalanche test.
+template <typename F>
+double worstAvalancheBias(F&& hash, unsigned inputBits, unsigned samples) {
+    std::mt19937_64 rng(1);
+    std::vector<unsigned> flips(inputBits * 64, 0);
+    for (unsigned s = 0; s < samples; ++s) {
+        auto key = rng();
+        if (inputBits < 64)
+            key &= (std::uint64_t(1) << inputBits) - 1;
+        std::uint64_t h = hash(key);
+        for (unsigned i = 0; i < inputBits; ++i) {
+            std::uint64_t diff = h ^ hash(key ^ (std::uint64_t(1) << i));
+            for (unsigned j = 0; j < 64; ++j)
+                flips[i * 64 + j] += (diff >> j) & 1;
+        }
+    }
+
+    double worst = 0;
+    for (auto f : flips) {
+        auto bias = double(f) / samples - 0.5;
+        worst = std::max(worst, bias < 0 ? -bias : bias);
+    }
+    return worst;
+}
+
+// Chi-square statistic of the low bits of the hashes over 2^bits buckets,
+// normalized so that a uniform distribution gives about 1
+template <typename It>
+double normalizedChiSquare(It first, It last, unsigned bits) {
+    std::vector<double> buckets(std::size_t(1) << bits, 0);
+    std::size_t n = 0;
+    for (; first != last; ++first, ++n)
+        buckets[*first & (buckets.size() - 1)] += 1;
+
+    auto expected = double(n) / buckets.size();
+    double chi = 0;
+    for (auto b : buckets)
+        chi += (b - expected) * (b - expected) / expected;
+    return chi / (buckets.size() - 1);
+}
+
+struct PackedKey {
+    std::uint32_t id;
+    std::uint16_t kind;
+    std::uint64_t stamp;
+    UTIL_HASHABLE_FIELDS(PackedKey, id, kind, stamp)
+};
+
+struct NamedKey {
+    std::string name;
+    int version;
+    double weight; // not part of the value
+    UTIL_HASHABLE_FIELDS(NamedKey, name, version)
+};
+
+TEST(HashingTest, Api) {
+    std::vector<int> v{1, 2, 3};
+    std::list<int> l{1, 2, 3};
+    EXPECT_EQ(hashContainer(v), hashContainer(v));
+    EXPECT_EQ(hashContainer(v), hashRange(v.data(), v.data() + v.size()));
+    EXPECT_EQ(hashContainer(l), hashRange(l.begin(), l.end()));
+    // Iterators of contiguous containers take the same bulk path as the
+    // containers themselves
+    EXPECT_EQ(hashContainer(v), hashRange(v.begin(), v.end()));
+    EXPECT_EQ(hashContainer(v), hashRange(v.cbegin(), v.cend()));
+    std::string s = "hello";
+    EXPECT_EQ(hashContainer(s), hashRange(s.begin(), s.end()));
+    EXPECT_EQ(hashContainer(std::vector<int>{}), hashRange(v.end(), v.end()));
+    std::vector<std::string> strings{"a", "b"};
+    EXPECT_EQ(hashContainer(strings),
+              hashRange(strings.begin(), strings.end()));
+    EXPECT_NE(hashContainer(v), hashContainer(std::vector<int>{3, 2, 1}));
+    EXPECT_NE(hashContainer(std::vector<int>{}),
+              hashContainer(std::vector<int>{0}));
+    EXPECT_NE(hashContainer(std::vector<int>{0}),
+              hashContainer(std::vector<int>{0, 0}));
+
+    EXPECT_EQ(hashRange(v.begin(), v.end(), [](int x) { return x * 2; }),
+              hashRange(l.begin(), l.end(), [](int x) { return x * 2; }));
+
+    PairHasher<std::pair<int, int>> pairHasher;
+    EXPECT_EQ(hashPair(1, 2), pairHasher(std::make_pair(1, 2)));
+    EXPECT_NE(hashPair(1, 2), hashPair(2, 1));
+    EXPECT_NE(hashTriple(1, 2, 3), hashTriple(1, 3, 2));
+    EXPECT_NE(hashQuadraple(1, 2, 3, 4), hashQuadraple(1, 2, 4, 3));
+    EXPECT_EQ(hashPair(std::string("a"), 1), hashPair(std::string("a"), 1));
+
+    std::size_t seed = 0;
+    hash_combine(seed, 1);
+    hash_combine(seed, 2);
+    std::size_t seed2 = 0;
+    hash_combine(seed2, 2);
+    hash_combine(seed2, 1);
+    EXPECT_NE(seed, seed2);
+
+    std::unordered_set<std::vector<int>, ContainerHasher<std::vector<int>>> set;
+    set.insert(v);
+    EXPECT_EQ(set.count(v), 1u);
+}
+
+TEST(HashingTest, Variadic) {
+    EXPECT_EQ(hashValues(1, 2), hashPair(1, 2));
+    EXPECT_EQ(hashValues(1, 2, 3), hashTriple(1, 2, 3));
+    EXPECT_EQ(hashValues(1, 2, 3, 4), hashQuadraple(1, 2, 3, 4));
+    EXPECT_NE(hashValues(1, 2, 3, 4, 5), hashValues(1, 2, 3, 5, 4));
+    EXPECT_NE(hashValues(), hashValues(0));
+
+    EXPECT_EQ(hashTuple(std::make_tuple(1, std::string("a"), 'c')),
+              hashValues(1, std::string("a"), 'c'));
+    EXPECT_EQ(hashTuple(std::make_pair(1, 2)), hashPair(1, 2));
+    EXPECT_EQ(hashTuple(std::array<int, 3>{{1, 2, 3}}), hashTriple(1, 2, 3));
+
+    std::unordered_set<std::tuple<int, int>, TupleHasher<std::tuple<int, int>>>
+        set;
+    set.emplace(1, 2);
+    EXPECT_EQ(set.count(std::make_tuple(1, 2)), 1u);
+    EXPECT_EQ(set.count(std::make_tuple(2, 1)), 0u);
+}
+
+TEST(HashingTest, StructFields) {
+    PackedKey a{1, 2, 3}, b{1, 2, 3}, c{1, 3, 2};
+    EXPECT_TRUE(a == b);
+    EXPECT_TRUE(a != c);
+
+    // Padding between kind and stamp does not take part in the hash
+    PackedKey d, e;
+    std::memset(&d, 0x00, sizeof(d));
+    std::memset(&e, 0xff, sizeof(e));
+    d.id = e.id = 7;
+    d.kind = e.kind = 8;
+    d.stamp = e.stamp = 9;
+    EXPECT_EQ(hashStruct(d), hashStruct(e));
+
+    // All fields are plain integers: hashed as one packed block
+    std::uint32_t id = 7;
+    std::uint16_t kind = 8;
+    std::uint64_t stamp = 9;
+    unsigned char block[14];
+    std::memcpy(block, &id, 4);
+    std::memcpy(block + 4, &kind, 2);
+    std::memcpy(block + 6, &stamp, 8);
+    EXPECT_EQ(hashStruct(d), hashBytes(block, sizeof(block)));
+    EXPECT_NE(hashStruct(a), hashStruct(c));
+
+    // Otherwise field by field
+    NamedKey n{"x", 1, 0.5}, m{"x", 1, 2.5};
+    EXPECT_TRUE(n == m);
+    EXPECT_EQ(hashStruct(n), hashValues(std::string("x"), 1));
+    EXPECT_EQ(StructHasher<NamedKey>()(n), StructHasher<NamedKey>()(m));
+
+    std::unordered_set<PackedKey, StructHasher<PackedKey>> keys{a, c};
+    EXPECT_EQ(keys.count(b), 1u);
+}
+
+TEST(HashingTest, Avalanche) {
+    EXPECT_LT(worstAvalancheBias([](std::uint64_t k) { return hash_mix(k); },
+                                 64, 2000),
+              0.05);
+    EXPECT_LT(worstAvalancheBias(
+                  [](std::uint64_t k) {
+                      return hashPair(std::uint32_t(k), std::uint32_t(k >> 32));
+                  },
+                  64, 2000),
+              0.05);
+    EXPECT_LT(worstAvalancheBias(
+                  [](std::uint64_t k) {
+                      return hashContainer(std::vector<std::uint16_t>{
+                          std::uint16_t(k), std::uint16_t(k >> 16)});
+                  },
+                  32, 2000),
+              0.05);
+}
+
+TEST(HashingTest, SequentialPairsDistribution) {
+    // Dense grids of small integers are the worst case for identity-based
+    // std::hash<int>; they must spread evenly over power-of-two tables
+    std::vector<std::size_t> hashes;
+    for (int i = 0; i < 256; ++i)
+        for (int j = 0; j < 256; ++j)
+            hashes.push_back(hashPair(i, j));
+
+    EXPECT_LT(normalizedChiSquare(hashes.begin(), hashes.end(), 10), 1.2);
+    EXPECT_LT(normalizedChiSquare(hashes.begin(), hashes.end(), 16), 1.2);
+
+    std::unordered_set<std::size_t> distinct(hashes.begin(), hashes.end());
+    EXPECT_EQ(distinct.size(), hashes.size());
+}
+
+TEST(HashingTest, SparseKeys) {
+    // Keys with at most two bits set, as in SMHasher's sparse test
+    std::vector<std::size_t> hashes;
+    for (unsigned i = 0; i < 64; ++i) {
+        for (unsigned j = i; j < 64; ++j) {
+            auto key = (std::uint64_t(1) << i) | (std::uint64_t(1) << j);
+            hashes.push_back(hashContainer(std::vector<std::uint64_t>{key}));
+            hashes.push_back(hashPair(key, 0));
+        }
+    }
+    std::unordered_set<std::size_t> distinct(hashes.begin(), hashes.end());
+    EXPECT_EQ(distinct.size(), hashes.size());
+}
+
+TEST(HashingTest, ContiguousTraits) {
+    static_assert(is_contiguous_container<std::vector<int>>::value, "");
+    static_assert(is_contiguous_container<std::string>::value, "");
+    static_assert(is_contiguous_container<std::array<char, 4>>::value, "");
+    static_assert(!is_contiguous_container<std::list<int>>::value, "");
+    static_assert(!is_contiguous_container<std::vector<bool>>::value, "");
+
+    static_assert(is_uniquely_represented<std::uint32_t>::value, "");
+    static_assert(is_uniquely_represented<const char*>::value, "");
+    static_assert(!is_uniquely_represented<double>::value, "");
+}
+
+TEST(HashingTest, BulkKernelsAgree) {
+    std::mt19937_64 rng(7);
+    std::vector<unsigned char> bytes(64 * 16);
+    for (auto& b : bytes)
+        b = static_cast<unsigned char>(rng());
+
+    for (std::size_t stripes : {0, 1, 3, 15, 16}) {
+        alignas(32) std::uint64_t ref[8], acc[8];
+        for (std::size_t i = 0; i < 8; ++i)
+            ref[i] = acc[i] = rng();
+
+        hash_detail::accumulateScalar(ref, bytes.data(), stripes);
+        hash_detail::scrambleScalar(ref);
+#if defined __SSE2__ && !defined UTIL_HASHING_NO_SIMD
+        alignas(32) std::uint64_t sseAcc[8];
+        std::memcpy(sseAcc, acc, sizeof(acc));
+        hash_detail::accumulateSse2(sseAcc, bytes.data(), stripes);
+        hash_detail::scrambleSse2(sseAcc);
+        EXPECT_EQ(0, std::memcmp(ref, sseAcc, sizeof(ref)));
+#endif
+#if defined __AVX2__ && !defined UTIL_HASHING_NO_SIMD
+        alignas(32) std::uint64_t avxAcc[8];
+        std::memcpy(avxAcc, acc, sizeof(acc));
+        hash_detail::accumulateAvx2(avxAcc, bytes.data(), stripes);
+        hash_detail::scrambleAvx2(avxAcc);
+        EXPECT_EQ(0, std::memcmp(ref, avxAcc, sizeof(ref)));
+#endif
+        hash_detail::accumulate(acc, bytes.data(), stripes);
+        hash_detail::scramble(acc);
+        EXPECT_EQ(0, std::memcmp(ref, acc, sizeof(ref)));
+    }
+}
+
+TEST(HashingTest, HashBytes) {
+    std::mt19937_64 rng(3);
+    std::vector<unsigned char> bytes(3000);
+    for (auto& b : bytes)
+        b = static_cast<unsigned char>(rng());
+
+    // Every length hashes differently, and flipping a single byte anywhere,
+    // in the short path, in a stripe, a block or the tail, changes the hash
+    std::unordered_set<std::size_t> distinct;
+    for (std::size_t len = 0; len <= bytes.size(); len += 7) {
+        auto h = hashBytes(bytes.data(), len);
+        EXPECT_EQ(h, hashBytes(bytes.data(), len));
+        distinct.insert(h);
+        for (std::size_t pos = 0; pos < len; pos += 61) {
+            bytes[pos] ^= 1;
+            EXPECT_NE(h, hashBytes(bytes.data(), len)) << len << " " << pos;
+            bytes[pos] ^= 1;
+        }
+    }
+    EXPECT_EQ(distinct.size(), bytes.size() / 7 + 1);
+    EXPECT_NE(hashBytes(bytes.data(), 100, 1), hashBytes(bytes.data(), 100, 2));
+
+    // Swapping two stripes, or two whole blocks, is detected
+    std::vector<unsigned char> swapped(bytes.begin(), bytes.begin() + 2048);
+    std::swap_ranges(swapped.begin(), swapped.begin() + 64,
+                     swapped.begin() + 64);
+    EXPECT_NE(hashBytes(bytes.data(), 2048), hashBytes(swapped.data(), 2048));
+    swapped.assign(bytes.begin(), bytes.begin() + 2048);
+    std::swap_ranges(swapped.begin(), swapped.begin() + 1024,
+                     swapped.begin() + 1024);
+    EXPECT_NE(hashBytes(bytes.data(), 2048), hashBytes(swapped.data(), 2048));
+
+    std::vector<std::uint32_t> big(100000);
+    for (auto& x : big)
+        x = static_cast<std::uint32_t>(rng());
+    EXPECT_EQ(hashContainer(big),
+              hashBytes(big.data(), big.size() * sizeof(std::uint32_t)));
+    EXPECT_EQ(hashContainer(std::string("hello")), hashBytes("hello", 5));
+}
+
+TEST(HashingTest, Unordered) {
+    std::unordered_set<int> a, b;
+    for (int i = 0; i < 1000; ++i)
+        a.insert(i);
+    for (int i = 999; i >= 0; --i)
+        b.insert(i);
+    b.reserve(5000);
+    EXPECT_EQ(hashUnordered(a), hashUnordered(b));
+    std::vector<int> sorted(a.begin(), a.end());
+    std::sort(sorted.begin(), sorted.end());
+    EXPECT_EQ(hashUnordered(a), hashUnordered(sorted));
+    b.erase(500);
+    EXPECT_NE(hashUnordered(a), hashUnordered(b));
+
+    // Duplicates cancel out in a plain xor, not here
+    std::unordered_multiset<int> once{1, 2}, twice{1, 2, 2, 2};
+    EXPECT_NE(hashUnordered(once), hashUnordered(twice));
+    EXPECT_NE(hashUnordered(std::vector<int>{}),
+              hashUnordered(std::vector<int>{7, 7}));
+
+    std::unordered_map<std::string, int> m1{{"a", 1}, {"b", 2}};
+    std::unordered_map<std::string, int> m2{{"b", 2}, {"a", 1}};
+    std::unordered_map<std::string, int> m3{{"a", 2}, {"b", 1}};
+    EXPECT_EQ(hashUnordered(m1), hashUnordered(m2));
+    EXPECT_NE(hashUnordered(m1), hashUnordered(m3));
+
+    std::unordered_set<std::unordered_set<int>,
+                       UnorderedContainerHasher<std::unordered_set<int>>>
+        sets{a, b};
+    EXPECT_EQ(sets.size(), 2u);
+    EXPECT_EQ(sets.count(a), 1u);
+}
+
+TEST(HashingTest, Constexpr) {
+    constexpr auto h = Hasher(3).addHash(1).addHash(2).finish();
+    static_assert(h == Hasher(3).addHash(1).addHash(2).finish(), "");
+    static_assert(hash_detail::mum(0x123456789abcdefULL, 0xfedcba987654321ULL) !=
+                      0,
+                  "");
+    EXPECT_NE(h, Hasher(3).addHash(2).addHash(1).finish());
+}
+
+struct Text {
+    char data[2100];
+};
+
+constexpr Text makeText() {
+    Text t{};
+    std::uint64_t x = 1;
+    for (auto& c : t.data) {
+        x = hash_mix(x + hash_detail::kPrime0);
+        c = static_cast<char>(x);
+    }
+    return t;
+}
+
+constexpr Text kText = makeText();
+
+enum class Color : std::uint8_t { Red, Green, Blue };
+
+constexpr std::size_t combineTwo(int a, long b) {
+    std::size_t seed = 0;
+    hash_combine(seed, a);
+    hash_combine(seed, b);
+    return seed;
+}
+
+int dispatch(const std::string& key) {
+    switch (StringHasher<>()(key)) {
+    case "cache.size"_h:
+        return key == "cache.size" ? 1 : 0;
+    case "cache.ttl"_h:
+        return key == "cache.ttl" ? 2 : 0;
+    default:
+        return 0;
+    }
+}
+
+TEST(HashingTest, CompileTimeKeys) {
+    constexpr auto size = "cache.size"_h;
+    EXPECT_EQ(size, StringHasher<>()("cache.size"));
+    EXPECT_EQ(size, hashContainer(std::string("cache.size")));
+    EXPECT_EQ(""_h, StringHasher<>()(""));
+    EXPECT_EQ("a\0b"_h, StringHasher<>()(std::string("a\0b", 3)));
+    constexpr auto fromPointer = hashString("cache.size");
+    static_assert(fromPointer == size, "");
+    EXPECT_EQ(dispatch("cache.size"), 1);
+    EXPECT_EQ(dispatch("cache.ttl"), 2);
+    EXPECT_EQ(dispatch("cache"), 0);
+
+    // Every path of hashBytes: short keys, whole stripes, blocks and tails
+    constexpr std::size_t k3 = hashString(kText.data, 3);
+    constexpr std::size_t k7 = hashString(kText.data, 7);
+    constexpr std::size_t k8 = hashString(kText.data, 8);
+    constexpr std::size_t k63 = hashString(kText.data, 63);
+    constexpr std::size_t k64 = hashString(kText.data, 64);
+    constexpr std::size_t k200 = hashString(kText.data, 200);
+    constexpr std::size_t k1024 = hashString(kText.data, 1024);
+    constexpr std::size_t k2100 = hashString(kText.data, 2100);
+    EXPECT_EQ(k3, hashBytes(kText.data, 3));
+    EXPECT_EQ(k7, hashBytes(kText.data, 7));
+    EXPECT_EQ(k8, hashBytes(kText.data, 8));
+    EXPECT_EQ(k63, hashBytes(kText.data, 63));
+    EXPECT_EQ(k64, hashBytes(kText.data, 64));
+    EXPECT_EQ(k200, hashBytes(kText.data, 200));
+    EXPECT_EQ(k1024, hashBytes(kText.data, 1024));
+    EXPECT_EQ(k2100, hashBytes(kText.data, 2100));
+    for (std::size_t len = 0; len <= sizeof(kText.data); ++len)
+        ASSERT_EQ(hash_detail::hashBytesConstexpr(kText.data, len),
+                  hashBytes(kText.data, len))
+            << len;
+
+    // Integers and enums, through the same words as at run time
+    constexpr auto values = hashValues(1, 2u, 'c', std::int64_t(-4));
+    constexpr auto pair =
+        PairHasher<std::pair<int, int>>()(std::make_pair(5, 6));
+    constexpr auto combined = combineTwo(7, 8);
+    constexpr auto blue = hashEnumClass(Color::Blue);
+    constexpr auto green = EnumClassHasher<Color>()(Color::Green);
+    volatile int one = 1, five = 5, seven = 7;
+    EXPECT_EQ(values, hashValues(int(one), 2u, 'c', std::int64_t(-4)));
+    EXPECT_EQ(pair, hashPair(int(five), 6));
+    std::size_t seed = 0;
+    hash_combine(seed, int(seven));
+    hash_combine(seed, 8L);
+    EXPECT_EQ(combined, seed);
+    EXPECT_EQ(blue, std::hash<std::uint8_t>()(2));
+    EXPECT_EQ(green, EnumClassHasher<Color>()(Color::Green));
+}
+}
@@ -0,0 +1,126 @@
+#include "Util/Interner.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+using Path = std::vector<std::string>;
+
+TEST(InternerTest, Canonical) {
+    interner<Path, ContainerHasher<Path>> paths;
+    EXPECT_TRUE(paths.empty());
+    EXPECT_EQ(paths.shard_count(), 64u);
+
+    Path usrLib{"usr", "lib"};
+    auto a = paths.intern(usrLib);
+    auto b = paths.intern(Path{"usr", "lib"});
+    auto c = paths.intern(Path{"usr", "bin"});
+    EXPECT_EQ(a, b);
+    EXPECT_NE(a, c);
+    EXPECT_EQ(*a, usrLib);
+    EXPECT_NE(a.as_nullable(), &usrLib);
+    EXPECT_EQ(paths.size(), 2u);
+
+    EXPECT_EQ(paths.find(usrLib), a.as_nullable());
+    EXPECT_EQ(paths.find(Path{"etc"}), nullptr);
+    EXPECT_TRUE(paths.contains(Path{"usr", "bin"}));
+    EXPECT_FALSE(paths.contains(Path{}));
+
+    // Canonical copies do not move as the interner grows
+    for (int i = 0; i < 10000; ++i)
+        paths.intern(Path{"dir", std::to_string(i)});
+    EXPECT_EQ(paths.size(), 10002u);
+    EXPECT_EQ(paths.intern(usrLib), a);
+    EXPECT_EQ(*a, usrLib);
+    EXPECT_GT(paths.memory_usage(), 10002 * sizeof(Path));
+
+    // Handles hash by address
+    flat_hash_set<nn<const Path*>> seen;
+    seen.insert(a);
+    EXPECT_TRUE(seen.contains(b));
+    EXPECT_FALSE(seen.contains(c));
+}
+
+TEST(InternerTest, MoveOnly) {
+    using Ptr = std::unique_ptr<int>;
+    struct DerefHash {
+        std::size_t operator()(const Ptr& p) const { return hashValues(*p); }
+    };
+    struct DerefEq {
+        bool operator()(const Ptr& a, const Ptr& b) const { return *a == *b; }
+    };
+
+    interner<Ptr, DerefHash, DerefEq> ptrs(1);
+    EXPECT_EQ(ptrs.shard_count(), 1u);
+    Ptr five(new int(5));
+    auto raw = five.get();
+    auto a = ptrs.intern(std::move(five));
+    EXPECT_EQ(a->get(), raw);
+    EXPECT_EQ(ptrs.intern(Ptr(new int(5))), a);
+    EXPECT_NE(ptrs.intern(Ptr(new int(6))), a);
+}
+
+struct Fragile {
+    int value;
+    explicit Fragile(int v) : value(v) {}
+    Fragile(const Fragile& other) : value(other.value) {
+        if (value < 0)
+            throw std::runtime_error("copy");
+    }
+    bool operator==(const Fragile& other) const {
+        return value == other.value;
+    }
+};
+
+struct FragileHash {
+    std::size_t operator()(const Fragile& f) const {
+        return hashValues(f.value);
+    }
+};
+
+TEST(InternerTest, ThrowingCopy) {
+    interner<Fragile, FragileHash> values;
+    EXPECT_THROW(values.intern(Fragile(-1)), std::runtime_error);
+    EXPECT_EQ(values.size(), 0u);
+    EXPECT_EQ(values.find(Fragile(-1)), nullptr);
+    auto one = values.intern(Fragile(1));
+    EXPECT_EQ(one->value, 1);
+    EXPECT_EQ(values.size(), 1u);
+}
+
+TEST(InternerTest, Concurrent) {
+    interner<std::string, StringHasher<>> strings(8);
+    const int numThreads = 8, numValues = 2000;
+    std::vector<std::vector<const std::string*>> results(numThreads);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < numThreads; ++t)
+        threads.emplace_back([&, t] {
+            // Every thread interns the same values, in a different order
+            for (int i = 0; i < numValues; ++i) {
+                auto v = (i * 7 + t * 131) % numValues;
+                results[t].push_back(
+                    strings.intern("value " + std::to_string(v))
+                        .as_nullable());
+            }
+        });
+    for (auto& th : threads)
+        th.join();
+
+    EXPECT_EQ(strings.size(), std::size_t(numValues));
+    for (int t = 0; t < numThreads; ++t)
+        for (int i = 0; i < numValues; ++i) {
+            auto v = (i * 7 + t * 131) % numValues;
+            ASSERT_EQ(results[t][i],
+                      strings.find("value " + std::to_string(v)));
+        }
+}
+}
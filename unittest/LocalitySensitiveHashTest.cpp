@@ -0,0 +1,192 @@
+#include "Util/LocalitySensitiveHash.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+std::vector<int> range(int first, int last) {
+    std::vector<int> ret;
+    for (int i = first; i < last; ++i)
+        ret.push_back(i);
+    return ret;
+}
+
+template <typename MinHasher>
+double similarity(const MinHasher& minhash, const std::vector<int>& a,
+                  const std::vector<int>& b) {
+    return minhashSimilarity(minhash.signature(a.begin(), a.end()),
+                             minhash.signature(b.begin(), b.end()));
+}
+
+template <typename MinHasher>
+void checkMinHasher() {
+    EXPECT_THROW(MinHasher(0), std::invalid_argument);
+    MinHasher minhash(256);
+    EXPECT_EQ(minhash.num_hashes(), 256u);
+
+    // J = 1000 / 3000
+    auto a = range(0, 2000), b = range(1000, 3000);
+    EXPECT_NEAR(similarity(minhash, a, b), 1.0 / 3, 0.08);
+    EXPECT_EQ(similarity(minhash, a, a), 1.0);
+    EXPECT_LT(similarity(minhash, range(0, 1000), range(1000, 2000)), 0.03);
+
+    // Order and duplicates don't matter
+    auto shuffled = a;
+    shuffled.insert(shuffled.end(), a.begin(), a.begin() + 100);
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+    EXPECT_EQ(minhash.signature(a.begin(), a.end()),
+              minhash.signature(shuffled.begin(), shuffled.end()));
+
+    // Projections, hashed as the values they return
+    std::vector<std::pair<int, std::string>> named{{1, "x"}, {2, "y"}};
+    std::vector<std::string> names{"x", "y"};
+    auto second = [](const std::pair<int, std::string>& p) {
+        return p.second;
+    };
+    EXPECT_EQ(minhash.signature(named.begin(), named.end(), second),
+              minhash.signature(names.begin(), names.end()));
+
+    std::vector<int> empty;
+    auto sig = minhash.signature(empty.begin(), empty.end());
+    EXPECT_EQ(std::count(sig.begin(), sig.end(), 0xffffffffU), 256);
+
+    MinHasher other(256, 1);
+    EXPECT_NE(minhash.signature(a.begin(), a.end()),
+              other.signature(a.begin(), a.end()));
+
+    // Sets smaller than the signature, averaged over seeds to see the bias
+    double sum = 0;
+    for (std::uint64_t seed = 0; seed < 100; ++seed) {
+        MinHasher small(128, seed);
+        sum += similarity(small, range(0, 20), range(10, 30));
+    }
+    EXPECT_NEAR(sum / 100, 1.0 / 3, 0.03);
+}
+
+} // namespace
+
+TEST(LocalitySensitiveHashTest, MinHasher) { checkMinHasher<minhasher>(); }
+
+TEST(LocalitySensitiveHashTest, OnePermutationMinHasher) {
+    checkMinHasher<one_permutation_minhasher>();
+}
+
+TEST(LocalitySensitiveHashTest, SignatureKernel) {
+    // The vectorized kernel against a plain loop, for every remainder of the
+    // blocks of 16 and 8 hash functions
+    std::mt19937 rng(3);
+    std::vector<std::uint32_t> keys(300), seeds(70);
+    for (auto& k : keys)
+        k = rng();
+    for (auto& s : seeds)
+        s = rng();
+    for (std::size_t k : {1u, 7u, 8u, 9u, 15u, 16u, 17u, 24u, 25u, 70u}) {
+        for (std::size_t n : {0u, 1u, 300u}) {
+            std::vector<std::uint32_t> fast(k), slow(k);
+            lsh_detail::minHashes(keys.data(), n, seeds.data(), k, fast.data());
+            lsh_detail::minHashesScalar(keys.data(), n, seeds.data(), k,
+                                        slow.data());
+            EXPECT_EQ(fast, slow) << k << " " << n;
+        }
+    }
+}
+
+TEST(LocalitySensitiveHashTest, Similarity) {
+    EXPECT_EQ(minhashSimilarity({1, 2, 3, 4}, {1, 2, 0, 0}), 0.5);
+    EXPECT_THROW(minhashSimilarity({1}, {1, 2}), std::invalid_argument);
+    EXPECT_THROW(minhashSimilarity({}, {}), std::invalid_argument);
+}
+
+TEST(LocalitySensitiveHashTest, Index) {
+    EXPECT_THROW(lsh_index(0, 4), std::invalid_argument);
+    EXPECT_THROW(lsh_index(4, 0), std::invalid_argument);
+
+    // 100 unrelated sets and, for each, a near duplicate with J = 0.9
+    one_permutation_minhasher minhash(128);
+    lsh_index index(32, 4);
+    std::vector<std::vector<std::uint32_t>> signatures;
+    for (int d = 0; d < 200; ++d) {
+        int base = (d % 100) * 10000;
+        auto set = d < 100 ? range(base, base + 1000)
+                           : range(base + 53, base + 1053);
+        signatures.push_back(minhash.signature(set.begin(), set.end()));
+        index.insert(d, signatures.back());
+    }
+    EXPECT_EQ(index.size(), 200u);
+    EXPECT_THROW(index.insert(0, {1, 2, 3}), std::invalid_argument);
+
+    std::vector<std::pair<std::uint64_t, std::uint64_t>> expected;
+    for (std::uint64_t d = 0; d < 100; ++d)
+        expected.emplace_back(d, d + 100);
+    EXPECT_EQ(index.candidate_pairs(), expected);
+    EXPECT_EQ(index.candidates(signatures[7]),
+              (std::vector<std::uint64_t>{7, 107}));
+}
+
+TEST(LocalitySensitiveHashTest, IndexForThreshold) {
+    EXPECT_THROW(lsh_index::for_threshold(128, 1.5), std::invalid_argument);
+    for (double t : {0.5, 0.7, 0.9}) {
+        auto index = lsh_index::for_threshold(120, t);
+        EXPECT_EQ(index.bands() * index.rows(), 120u);
+        EXPECT_NEAR(std::pow(1.0 / index.bands(), 1.0 / index.rows()), t,
+                    0.06);
+    }
+}
+
+TEST(LocalitySensitiveHashTest, SimHash) {
+    auto a = range(0, 1000), b = range(100, 1100), c = range(5000, 6000);
+    auto ha = simhash(a.begin(), a.end());
+    auto shuffled = a;
+    std::shuffle(shuffled.begin(), shuffled.end(), std::mt19937(1));
+    EXPECT_EQ(simhash(shuffled.begin(), shuffled.end()), ha);
+
+    // Similar sets are close, unrelated ones about 32 bits apart
+    EXPECT_LT(simhashDistance(ha, simhash(b.begin(), b.end())), 16u);
+    EXPECT_GT(simhashDistance(ha, simhash(c.begin(), c.end())), 20u);
+    EXPECT_EQ(simhashDistance(0, ~std::uint64_t(0)), 64u);
+
+    // Against a plain majority vote on every bit, for counts around the
+    // flushes of the byte counters
+    for (int n : {0, 1, 254, 255, 256, 511, 1000}) {
+        auto set = range(0, n);
+        std::uint64_t expected = 0;
+        for (unsigned bit = 0; bit < 64; ++bit) {
+            int ones = 0;
+            for (int x : set)
+                ones += (hashValues(x) >> bit) & 1;
+            if (2 * ones > n)
+                expected |= std::uint64_t(1) << bit;
+        }
+        EXPECT_EQ(simhash(set.begin(), set.end()), expected) << n;
+    }
+
+    std::vector<std::pair<int, std::string>> named{{1, "x"}, {2, "y"}};
+    std::vector<std::string> names{"x", "y"};
+    auto second = [](const std::pair<int, std::string>& p) {
+        return p.second;
+    };
+    EXPECT_EQ(simhash(named.begin(), named.end(), second),
+              simhash(names.begin(), names.end()));
+}
+
+TEST(LocalitySensitiveHashTest, SimHashWeighted) {
+    auto a = range(0, 100);
+    auto id = [](int x) { return x; };
+    EXPECT_EQ(simhashWeighted(a.begin(), a.end(), id, [](int) { return 1; }),
+              simhash(a.begin(), a.end()));
+    // One element outweighing all the others
+    EXPECT_EQ(simhashWeighted(a.begin(), a.end(), id,
+                              [](int x) { return x == 42 ? 1000.0 : 1.0; }),
+              hashValues(42));
+}
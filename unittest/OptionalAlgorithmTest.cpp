@@ -0,0 +1,96 @@
+#include "Util/OptionalAlgorithm.h"
+
+#include "gtest/gtest.h"
+
+#include <list>
+#include <string>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+std::vector<optional<double>> makeReadings(std::size_t n) {
+    std::vector<optional<double>> ret;
+    ret.reserve(n);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (i % 3 == 1)
+            ret.emplace_back();
+        else
+            ret.emplace_back(double(i % 1000) - 500.0);
+    }
+    return ret;
+}
+
+TEST(OptionalAlgorithmTest, Sequential) {
+    std::vector<optional<int>> v{{3}, {}, {-2}, {7}, {}, {1}};
+
+    EXPECT_EQ(sum_engaged(v.begin(), v.end()), 9);
+    EXPECT_EQ(*min_engaged(v.begin(), v.end()), -2);
+    EXPECT_EQ(*max_engaged(v.begin(), v.end()), 7);
+
+    auto squares = transform_reduce_engaged(
+        v.begin(), v.end(), 0, [](int x, int y) { return x + y; },
+        [](int x) { return x * x; });
+    EXPECT_EQ(squares, 63);
+
+    std::vector<int> out;
+    filter_engaged(v.begin(), v.end(), std::back_inserter(out));
+    EXPECT_EQ(out, (std::vector<int>{3, -2, 7, 1}));
+}
+
+TEST(OptionalAlgorithmTest, Empty) {
+    std::vector<optional<double>> none{{}, {}, {}};
+    EXPECT_EQ(sum_engaged(none.begin(), none.end()), 0.0);
+    EXPECT_FALSE(min_engaged(none.begin(), none.end()));
+    EXPECT_FALSE(max_engaged(none.begin(), none.end()));
+
+    ThreadPool pool(2);
+    EXPECT_FALSE(max_engaged(pool, none.begin(), none.end()));
+    EXPECT_EQ(sum_engaged(pool, none.end(), none.end()), 0.0);
+}
+
+TEST(OptionalAlgorithmTest, NonRandomAccessAndNonArithmetic) {
+    std::list<optional<std::string>> l{{"b"}, {}, {"a"}, {"c"}};
+    EXPECT_EQ(*min_engaged(l.begin(), l.end()), "a");
+    EXPECT_EQ(*max_engaged(l.begin(), l.end()), "c");
+    EXPECT_EQ(sum_engaged(l.begin(), l.end()), "bac");
+
+    std::list<optional<int>> li{{}, {4}, {}, {5}};
+    EXPECT_EQ(sum_engaged(li.begin(), li.end()), 9);
+}
+
+TEST(OptionalAlgorithmTest, ParallelMatchesSequential) {
+    auto readings = makeReadings(300000);
+    ThreadPool pool(4);
+
+    EXPECT_DOUBLE_EQ(sum_engaged(pool, readings.begin(), readings.end()),
+                     sum_engaged(readings.begin(), readings.end()));
+    EXPECT_EQ(*min_engaged(pool, readings.begin(), readings.end()), -500.0);
+    EXPECT_EQ(*max_engaged(pool, readings.begin(), readings.end()), 499.0);
+
+    auto count = transform_reduce_engaged(
+        pool, readings.begin(), readings.end(), std::size_t(0),
+        [](std::size_t x, std::size_t y) { return x + y; },
+        [](double) { return std::size_t(1); });
+    EXPECT_EQ(count, 200000u);
+
+    std::vector<double> seq, par(readings.size());
+    filter_engaged(readings.begin(), readings.end(), std::back_inserter(seq));
+    auto end = filter_engaged(pool, readings.begin(), readings.end(),
+                              par.begin());
+    par.erase(end, par.end());
+    EXPECT_EQ(seq, par);
+}
+
+TEST(OptionalAlgorithmTest, ParallelIsDeterministic) {
+    auto readings = makeReadings(500000);
+    for (auto& r : readings)
+        if (r)
+            *r = *r / 7.0;
+
+    ThreadPool one(1), many(8);
+    EXPECT_EQ(sum_engaged(one, readings.begin(), readings.end()),
+              sum_engaged(many, readings.begin(), readings.end()));
+}
+}
@@ -0,0 +1,111 @@
+#include "Util/Optional.h"
+
+#include "gtest/gtest.h"
+
+#include <cstddef>
+
+using namespace util;
+
+namespace {
+
+static_assert(OPTIONAL_HAS_CONSTEXPR_MUTATION == 1,
+              "this test must be compiled as C++17 or later");
+
+struct Point {
+    int x;
+    int y;
+
+    constexpr Point() : x(0), y(0) {}
+    constexpr Point(int x, int y) : x(x), y(y) {}
+};
+
+constexpr bool operator==(const Point& lhs, const Point& rhs) {
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+}
+
+constexpr optional<int> assign_and_reset() {
+    optional<int> o;
+    o = 3;
+    o = 4;
+    o.reset();
+    o = 5;
+    return o;
+}
+
+constexpr optional<Point> emplace_twice() {
+    optional<Point> o;
+    o.emplace(1, 2);
+    o.emplace(3, 4);
+    return o;
+}
+
+constexpr int swap_all() {
+    optional<int> a{1};
+    optional<int> b;
+    a.swap(b);
+    if (a || *b != 1)
+        return -1;
+
+    optional<int> c{2};
+    swap(b, c);
+    return *b * 10 + *c;
+}
+
+constexpr optional<int> copy_and_move() {
+    optional<int> a{7};
+    optional<int> b{a};
+    optional<int> c{constexpr_move(b)};
+    optional<int> d;
+    d = c;
+    d = nullopt;
+    d = constexpr_move(c);
+    return d;
+}
+
+// A lookup table of squares below 16, with nullopt for everything else
+struct SquareTable {
+    optional<int> roots[17];
+
+    constexpr SquareTable() : roots{} {
+        for (int i = 0; i * i <= 16; ++i)
+            roots[i * i] = i;
+    }
+};
+
+constexpr SquareTable squares{};
+
+TEST(OptionalConstexprTest, AssignAndReset) {
+    constexpr auto o = assign_and_reset();
+    static_assert(o && *o == 5, "bad assignment");
+    EXPECT_EQ(*o, 5);
+}
+
+TEST(OptionalConstexprTest, Emplace) {
+    constexpr auto o = emplace_twice();
+    static_assert(o && *o == Point(3, 4), "bad emplace");
+    EXPECT_EQ(o->x, 3);
+}
+
+TEST(OptionalConstexprTest, Swap) {
+    static_assert(swap_all() == 21, "bad swap");
+    EXPECT_EQ(swap_all(), 21);
+}
+
+TEST(OptionalConstexprTest, CopyAndMove) {
+    constexpr auto o = copy_and_move();
+    static_assert(o == 7, "bad copy or move");
+    EXPECT_EQ(o, 7);
+}
+
+TEST(OptionalConstexprTest, LookupTable) {
+    static_assert(squares.roots[9] == 3, "bad table");
+    static_assert(!squares.roots[10], "bad table");
+
+    for (std::size_t i = 0; i < 17; ++i) {
+        if (i == 0 || i == 1 || i == 4 || i == 9 || i == 16)
+            EXPECT_EQ(*squares.roots[i] * *squares.roots[i], int(i));
+        else
+            EXPECT_FALSE(squares.roots[i]);
+    }
+}
+}
@@ -992,13 +992,21 @@ TEST(OptionalTest, optional_hashing) {
     std::hash<string> hs;
     std::hash<optional<string>> hos;
 
-    EXPECT_TRUE(hi(0) == hoi(optional<int>{0}));
-    EXPECT_TRUE(hi(1) == hoi(optional<int>{1}));
-    EXPECT_TRUE(hi(3198) == hoi(optional<int>{3198}));
-
-    EXPECT_TRUE(hs("") == hos(optional<string>{""}));
-    EXPECT_TRUE(hs("0") == hos(optional<string>{"0"}));
-    EXPECT_TRUE(hs("Qa1#") == hos(optional<string>{"Qa1#"}));
+    EXPECT_TRUE(hoi(optional<int>{0}) == hoi(optional<int>{0}));
+    EXPECT_TRUE(hoi(optional<int>{0}) != hoi(optional<int>{}));
+    EXPECT_TRUE(hoi(optional<int>{1}) != hi(1));
+    EXPECT_TRUE(hoi(optional<int>{}) == hoi(nullopt));
+
+    EXPECT_TRUE(hos(optional<string>{""}) != hos(optional<string>{}));
+    EXPECT_TRUE(hos(optional<string>{"0"}) == hos(optional<string>{"0"}));
+    EXPECT_TRUE(hos(optional<string>{"Qa1#"}) != hs("Qa1#"));
+
+    // Consecutive keys should spread over the low bits used by power-of-two
+    // tables instead of clustering next to each other
+    std::unordered_set<std::size_t> lowBits;
+    for (int i = 0; i < 64; ++i)
+        lowBits.insert(hoi(optional<int>{i}) & 0xff);
+    EXPECT_TRUE(lowBits.size() > 32);
 
     std::unordered_set<optional<string>> set;
     EXPECT_TRUE(set.find({"Qa1#"}) == set.end());
@@ -1010,6 +1018,31 @@ TEST(OptionalTest, optional_hashing) {
     EXPECT_TRUE(set.find({"Qa1#"}) != set.end());
 };
 
+TEST(OptionalTest, optional_hash_many) {
+
+    using std::string;
+
+    std::vector<optional<int>> ints;
+    for (int i = 0; i < 200; ++i)
+        ints.push_back(i % 3 == 0 ? optional<int>{} : optional<int>{i});
+
+    std::vector<std::size_t> out(ints.size());
+    hash_many(ints.data(), ints.size(), out.data());
+
+    std::hash<optional<int>> hoi;
+    for (std::size_t i = 0; i < ints.size(); ++i)
+        EXPECT_TRUE(out[i] == hoi(ints[i]));
+
+    std::vector<optional<string>> strs{{"a"}, {}, {"bc"}, {""}, {}};
+    std::vector<std::size_t> strOut(strs.size());
+    hash_many(strs.data(), strs.size(), strOut.data());
+
+    std::hash<optional<string>> hos;
+    for (std::size_t i = 0; i < strs.size(); ++i)
+        EXPECT_TRUE(strOut[i] == hos(strs[i]));
+    EXPECT_TRUE(strOut[1] == strOut[4]);
+};
+
 // optional_ref_emulation
 template <class T>
 struct generic {
@@ -1087,17 +1120,23 @@ TEST(OptionalTest, optional_ref_hashing) {
     std::hash<string> hs;
     std::hash<optional<string&>> hos;
 
+    std::hash<optional<int>> hoiv;
+    std::hash<optional<string>> hosv;
+
     int i0 = 0;
     int i1 = 1;
-    EXPECT_TRUE(hi(0) == hoi(optional<int&>{i0}));
-    EXPECT_TRUE(hi(1) == hoi(optional<int&>{i1}));
+    EXPECT_TRUE(hoiv(optional<int>{0}) == hoi(optional<int&>{i0}));
+    EXPECT_TRUE(hoiv(optional<int>{1}) == hoi(optional<int&>{i1}));
+    EXPECT_TRUE(hoiv(optional<int>{}) == hoi(optional<int&>{}));
+    EXPECT_TRUE(hi(1) != hoi(optional<int&>{i1}));
 
     string s{""};
     string s0{"0"};
     string sCAT{"CAT"};
-    EXPECT_TRUE(hs("") == hos(optional<string&>{s}));
-    EXPECT_TRUE(hs("0") == hos(optional<string&>{s0}));
-    EXPECT_TRUE(hs("CAT") == hos(optional<string&>{sCAT}));
+    EXPECT_TRUE(hosv(optional<string>{""}) == hos(optional<string&>{s}));
+    EXPECT_TRUE(hosv(optional<string>{"0"}) == hos(optional<string&>{s0}));
+    EXPECT_TRUE(hosv(optional<string>{"CAT"}) == hos(optional<string&>{sCAT}));
+    EXPECT_TRUE(hs("CAT") != hos(optional<string&>{sCAT}));
 
     std::unordered_set<optional<string&>> set;
     EXPECT_TRUE(set.find({sCAT}) == set.end());
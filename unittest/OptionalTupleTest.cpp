@@ -0,0 +1,122 @@
+#include "Util/OptionalTuple.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+
+using namespace util;
+
+namespace {
+
+struct Tracked {
+    static int alive;
+    static int copies;
+    int v;
+
+    Tracked(int v) : v(v) { ++alive; }
+    Tracked(const Tracked& o) : v(o.v) {
+        ++alive;
+        ++copies;
+    }
+    Tracked(Tracked&& o) : v(o.v) { ++alive; }
+    Tracked& operator=(const Tracked&) = default;
+    ~Tracked() { --alive; }
+};
+int Tracked::alive = 0;
+int Tracked::copies = 0;
+
+TEST(OptionalTupleTest, Layout) {
+    // One padded bool per field is gone, and reordering removes the padding
+    // in between the fields
+    using Record = optional_tuple<char, double, std::int16_t, std::int32_t, char>;
+    EXPECT_EQ(sizeof(Record), 24u);
+    EXPECT_LT(sizeof(Record), sizeof(optional<char>) + sizeof(optional<double>) +
+                                  sizeof(optional<std::int16_t>) +
+                                  sizeof(optional<std::int32_t>) +
+                                  sizeof(optional<char>));
+
+    using Ordered =
+        ordered_optional_tuple<char, double, std::int16_t, std::int32_t, char>;
+    EXPECT_GT(sizeof(Ordered), sizeof(Record));
+
+    static_assert(sizeof(optional_tuple<std::uint8_t>::mask_type) == 1, "");
+    static_assert(
+        sizeof(optional_tuple<int, int, int, int, int, int, int, int,
+                              int>::mask_type) == 2,
+        "");
+}
+
+TEST(OptionalTupleTest, GetAndSet) {
+    optional_tuple<int, std::string, double> t;
+    EXPECT_EQ(t.mask(), 0u);
+    EXPECT_FALSE(t.get<0>());
+    EXPECT_FALSE(get<1>(t));
+
+    t.emplace<1>("abc");
+    t.set<2>(2.5);
+    EXPECT_EQ(t.mask(), 6u);
+    EXPECT_EQ(*t.get<1>(), "abc");
+    EXPECT_EQ(*t.get<2>(), 2.5);
+
+    // get() hands out references into the tuple
+    *t.get<1>() += "d";
+    EXPECT_EQ(*get<1>(t), "abcd");
+
+    t.set<1>(std::string("x"));
+    EXPECT_EQ(*t.get<1>(), "x");
+
+    t.reset<2>();
+    EXPECT_FALSE(t.get<2>());
+    EXPECT_EQ(t.mask(), 2u);
+
+    const auto& ct = t;
+    EXPECT_EQ(*ct.get<1>(), "x");
+    EXPECT_FALSE(ct.get<0>());
+}
+
+TEST(OptionalTupleTest, OnlyEngagedFieldsAreTouched) {
+    Tracked::alive = 0;
+    Tracked::copies = 0;
+    {
+        optional_tuple<Tracked, Tracked, Tracked, std::string> a;
+        a.emplace<0>(1);
+        a.emplace<2>(3);
+        EXPECT_EQ(Tracked::alive, 2);
+
+        auto b = a;
+        EXPECT_EQ(Tracked::alive, 4);
+        EXPECT_EQ(Tracked::copies, 2);
+        EXPECT_EQ(b.mask(), a.mask());
+        EXPECT_EQ(b.get<2>()->v, 3);
+        EXPECT_FALSE(b.get<1>());
+
+        auto c = std::move(b);
+        EXPECT_EQ(c.get<0>()->v, 1);
+
+        a.reset<0>();
+        EXPECT_EQ(Tracked::alive, 5);
+
+        c = a;
+        EXPECT_EQ(Tracked::alive, 4);
+        EXPECT_FALSE(c.get<0>());
+
+        c.reset();
+        EXPECT_EQ(Tracked::alive, 3);
+        EXPECT_EQ(c.mask(), 0u);
+    }
+    EXPECT_EQ(Tracked::alive, 0);
+}
+
+TEST(OptionalTupleTest, TriviallyCopyable) {
+    optional_tuple<int, char, double> a;
+    a.set<0>(7);
+    a.set<2>(1.5);
+
+    optional_tuple<int, char, double> b;
+    b = a;
+    EXPECT_EQ(*b.get<0>(), 7);
+    EXPECT_FALSE(b.get<1>());
+    EXPECT_EQ(*b.get<2>(), 1.5);
+}
+}
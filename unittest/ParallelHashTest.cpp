@@ -0,0 +1,119 @@
+#include "Util/ParallelHash.h"
+
+#include "gtest/gtest.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <list>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+using namespace util;
+
+namespace {
+TEST(ParallelHashTest, UnorderedMatchesSequential) {
+    std::mt19937_64 rng(5);
+    std::unordered_set<std::uint64_t> set;
+    std::vector<std::uint64_t> vec;
+    std::deque<std::uint64_t> deq;
+    std::list<std::uint64_t> lst;
+    for (int i = 0; i < 100000; ++i) {
+        auto v = rng();
+        set.insert(v);
+        vec.push_back(v);
+        deq.push_front(v);
+        lst.push_back(v);
+    }
+
+    ThreadPool empty(0), pool(4);
+    auto expected = hashUnordered(set);
+    for (auto* p : {&empty, &pool}) {
+        EXPECT_EQ(hashUnordered(*p, set), expected);
+        EXPECT_EQ(hashUnordered(*p, vec), expected);
+        EXPECT_EQ(hashUnordered(*p, deq), expected);
+        EXPECT_EQ(hashUnordered(*p, lst), expected);
+    }
+
+    std::unordered_map<std::string, int> map;
+    for (int i = 0; i < 50000; ++i)
+        map.emplace(std::to_string(i), i);
+    EXPECT_EQ(hashUnordered(pool, map), hashUnordered(map));
+
+    // Small containers take the sequential path
+    std::vector<int> small{3, 1, 2};
+    EXPECT_EQ(hashUnordered(pool, small), hashUnordered(small));
+}
+
+TEST(ParallelHashTest, TreeIsDeterministic) {
+    std::mt19937_64 rng(7);
+    std::vector<std::uint32_t> data(300001);
+    for (auto& x : data)
+        x = static_cast<std::uint32_t>(rng());
+
+    ThreadPool empty(0), two(2), eight(8);
+    auto first = data.data(), last = first + data.size();
+    auto expected = parallelHashRange(empty, first, last, 4096);
+    EXPECT_EQ(parallelHashRange(two, first, last, 4096), expected);
+    EXPECT_EQ(parallelHashRange(eight, first, last, 4096), expected);
+    EXPECT_EQ(parallelHashContainer(eight, data, 4096), expected);
+    EXPECT_NE(parallelHashRange(eight, first, last, 8192), expected);
+
+    // Iterators take the per-element path, with the same tree shape
+    std::deque<std::uint32_t> deq(data.begin(), data.end());
+    EXPECT_EQ(parallelHashContainer(two, deq, 4096),
+              parallelHashContainer(eight, deq, 4096));
+
+    // Chunk order matters, and the length is part of the hash
+    std::vector<std::uint32_t> swapped(data);
+    std::swap_ranges(swapped.begin(), swapped.begin() + 4096,
+                     swapped.begin() + 4096);
+    EXPECT_NE(parallelHashContainer(two, swapped, 4096), expected);
+    std::vector<std::uint32_t> padded(data);
+    padded.push_back(0);
+    EXPECT_NE(parallelHashContainer(two, padded, 4096), expected);
+
+    std::vector<std::uint32_t> none;
+    std::vector<std::uint32_t> one{1};
+    EXPECT_NE(parallelHashContainer(two, none, 16),
+              parallelHashContainer(two, one, 16));
+}
+
+TEST(ParallelHashTest, Merkle) {
+    std::mt19937_64 rng(11);
+    std::string text(100000, ' ');
+    for (auto& c : text)
+        c = static_cast<char>('a' + rng() % 26);
+
+    ThreadPool pool(4);
+    auto first = text.data(), last = first + text.size();
+    for (std::size_t chunk : {1000u, 1024u, 99999u, 100000u, 200000u}) {
+        MerkleHashTree tree(chunk);
+        tree.build(pool, first, last);
+        EXPECT_EQ(tree.root(), parallelHashRange(pool, first, last, chunk));
+        EXPECT_EQ(tree.size(), text.size());
+        EXPECT_EQ(tree.numChunks(), (text.size() + chunk - 1) / chunk);
+    }
+
+    MerkleHashTree before(1000), after(1000);
+    before.build(pool, first, last);
+    after.build(pool, first, last);
+    EXPECT_TRUE(after.changedChunks(before).empty());
+
+    // A write straddling chunks 4 and 5, then one in the last chunk
+    text.replace(4990, 20, "xxxxxxxxxxxxxxxxxxxx");
+    after.update(first, last, 4990, 20);
+    text[99999] = '#';
+    after.update(pool, first, last, 99999, 1);
+    EXPECT_EQ(after.root(), parallelHashRange(pool, first, last, 1000));
+    EXPECT_EQ(after.changedChunks(before),
+              (std::vector<std::size_t>{4, 5, 99}));
+    EXPECT_EQ(after.chunkHash(3), before.chunkHash(3));
+
+    after.update(first, last, 0, 0);
+    EXPECT_EQ(after.root(), parallelHashRange(pool, first, last, 1000));
+}
+}
@@ -0,0 +1,199 @@
+#include "Util/PerfectHashMap.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <functional>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+enum class Verb { Get, Put, Delete };
+
+// The identity, as std::hash, but usable at compile time
+struct IntHasher {
+    constexpr std::size_t operator()(int v) const {
+        return static_cast<std::size_t>(v);
+    }
+};
+
+// Maps "a" and "b" to the same hash
+struct CollidingHasher {
+    std::size_t operator()(const std::string& s) const {
+        return s == "b" ? std::hash<std::string>()("a")
+                        : std::hash<std::string>()(s);
+    }
+};
+
+TEST(PerfectHashMapTest, Basic) {
+    perfect_hash_map<std::string, Verb> verbs{
+        {"get", Verb::Get}, {"put", Verb::Put}, {"del", Verb::Delete}};
+    EXPECT_EQ(verbs.size(), 3u);
+    EXPECT_EQ(verbs.bucket_count(), 1u);
+    EXPECT_EQ(verbs.at("put"), Verb::Put);
+    EXPECT_EQ(verbs.find("del")->second, Verb::Delete);
+    EXPECT_EQ(verbs.find("post"), verbs.end());
+    EXPECT_TRUE(verbs.contains("get"));
+    EXPECT_EQ(verbs.count("gett"), 0u);
+    EXPECT_THROW(verbs.at(""), std::out_of_range);
+
+    std::size_t seen = 0;
+    for (const auto& kv : verbs) {
+        EXPECT_EQ(verbs.find(kv.first)->second, kv.second);
+        ++seen;
+    }
+    EXPECT_EQ(seen, 3u);
+
+    perfect_hash_map<int, int> empty;
+    EXPECT_TRUE(empty.empty());
+    EXPECT_FALSE(empty.contains(0));
+    EXPECT_EQ(empty.begin(), empty.end());
+
+    perfect_hash_map<Verb, std::string> names{{Verb::Get, "get"},
+                                              {Verb::Put, "put"}};
+    EXPECT_EQ(names.at(Verb::Put), "put");
+    EXPECT_FALSE(names.contains(Verb::Delete));
+}
+
+TEST(PerfectHashMapTest, Large) {
+    std::mt19937_64 rng(3);
+    std::unordered_map<std::uint64_t, int> ref;
+    while (ref.size() < 100000)
+        ref.emplace(rng(), int(ref.size()));
+
+    perfect_hash_map<std::uint64_t, int> map(ref.begin(), ref.end());
+    EXPECT_EQ(map.size(), ref.size());
+    EXPECT_EQ(map.bucket_count(), 25000u);
+    for (const auto& kv : ref)
+        ASSERT_EQ(map.at(kv.first), kv.second);
+    for (int i = 0; i < 100000; ++i) {
+        auto k = rng();
+        EXPECT_EQ(map.contains(k), ref.count(k) == 1);
+    }
+
+    // Dense integers, which std::hash leaves as they are
+    std::vector<std::pair<int, int>> dense;
+    for (int i = 0; i < 5000; ++i)
+        dense.emplace_back(i, -i);
+    perfect_hash_map<int, int> denseMap(dense.begin(), dense.end());
+    for (int i = 0; i < 5000; ++i)
+        ASSERT_EQ(denseMap.at(i), -i);
+    EXPECT_FALSE(denseMap.contains(5000));
+}
+
+TEST(PerfectHashMapTest, Heterogeneous) {
+    std::vector<std::pair<std::string, int>> keys;
+    for (int i = 0; i < 1000; ++i)
+        keys.emplace_back("config.key." + std::to_string(i), i);
+    perfect_hash_map<std::string, int, StringHasher<>, std::equal_to<>> map(
+        keys.begin(), keys.end());
+    EXPECT_EQ(map.at("config.key.10"), 10);
+    EXPECT_TRUE(map.contains(std::string("config.key.999")));
+    EXPECT_EQ(map.count("config.key.1000"), 0u);
+}
+
+TEST(PerfectHashMapTest, HeterogeneousWithoutConversion) {
+    // The probe is hashed and compared as it is: a std::string is never built
+    struct Hash {
+        using is_transparent = void;
+        std::size_t operator()(const std::string& s) const {
+            return std::hash<std::string>()(s);
+        }
+        std::size_t operator()(const char* s) const {
+            ++calls;
+            return std::hash<std::string>()(s);
+        }
+        int& calls;
+    };
+    int calls = 0;
+    std::vector<std::pair<std::string, int>> keys{{"a", 1}, {"b", 2}};
+    perfect_hash_map<std::string, int, Hash, std::equal_to<>> map(
+        keys.begin(), keys.end(), Hash{calls});
+    const char* b = "b";
+    EXPECT_EQ(map.at(b), 2);
+    EXPECT_TRUE(map.contains(b));
+    EXPECT_EQ(calls, 2);
+}
+
+constexpr std::pair<Verb, int> kVerbCodes[] = {
+    {Verb::Get, 200}, {Verb::Put, 201}, {Verb::Delete, 204}};
+
+constexpr static_perfect_hash_map<Verb, int, 3, EnumClassHasher<Verb>>
+    kVerbMap(kVerbCodes);
+
+TEST(PerfectHashMapTest, CompileTime) {
+    static_assert(kVerbMap.size() == 3 && kVerbMap.bucket_count() == 1, "");
+    static_assert(kVerbMap.at(Verb::Put) == 201, "");
+    static_assert(kVerbMap.find(Verb::Delete)->second == 204, "");
+
+    // Enough keys for several buckets and, most likely, retried seeds
+    constexpr auto codes = make_static_perfect_hash_map<int, int, IntHasher>(
+        {{100, 1}, {101, 2}, {200, 3}, {201, 4}, {202, 5}, {204, 6},
+         {301, 7}, {302, 8}, {304, 9}, {400, 10}, {401, 11}, {403, 12},
+         {404, 13}, {409, 14}, {500, 15}, {502, 16}, {503, 17}});
+    static_assert(codes.bucket_count() == 5, "");
+    static_assert(codes.at(404) == 13 && !codes.contains(405), "");
+    // The elements and one displacement per bucket, plus the seed and padding
+    static_assert(sizeof(codes) <= sizeof(std::pair<const int, int>) * 17 +
+                                       sizeof(std::uint32_t) * 5 + 24,
+                  "");
+    std::size_t seen = 0;
+    for (const auto& kv : codes) {
+        EXPECT_EQ(codes.at(kv.first), kv.second);
+        ++seen;
+    }
+    EXPECT_EQ(seen, 17u);
+    EXPECT_THROW(codes.at(999), std::out_of_range);
+    EXPECT_EQ(codes.find(999), codes.end());
+
+    // The same table as perfect_hash_map builds at run time
+    std::vector<std::pair<int, int>> entries(codes.begin(), codes.end());
+    perfect_hash_map<int, int, IntHasher> runtime(entries.begin(),
+                                                  entries.end());
+    for (const auto& kv : runtime)
+        EXPECT_EQ(kv, *codes.find(kv.first));
+
+    // Built at run time as well, where inseparable keys throw
+    const std::pair<int, int> duplicates[] = {{1, 1}, {2, 2}, {1, 3}};
+    using Map = static_perfect_hash_map<int, int, 3, IntHasher>;
+    EXPECT_THROW(Map{duplicates}, std::invalid_argument);
+}
+
+#ifdef UTIL_HASHING_HAS_STRING_VIEW
+TEST(PerfectHashMapTest, CompileTimeStrings) {
+    constexpr auto verbs =
+        make_static_perfect_hash_map<std::string_view, Verb, StringHasher<>,
+                                     std::equal_to<>>(
+            {{"get", Verb::Get}, {"put", Verb::Put}, {"del", Verb::Delete}});
+    static_assert(verbs.at(std::string_view("put")) == Verb::Put, "");
+    static_assert(!verbs.contains(std::string_view("post")), "");
+    std::string token = "del";
+    EXPECT_EQ(verbs.at(token), Verb::Delete);
+    EXPECT_EQ(verbs.at("get"), Verb::Get);
+
+    // The example of perfect_hash_map, looked up by string_view
+    perfect_hash_map<std::string, Verb, StringHasher<>, std::equal_to<>>
+        runtime{{"get", Verb::Get}, {"put", Verb::Put}};
+    EXPECT_EQ(runtime.find(std::string_view(token).substr(0, 1)),
+              runtime.end());
+    EXPECT_EQ(runtime.find(std::string_view("put"))->second, Verb::Put);
+}
+#endif
+
+TEST(PerfectHashMapTest, RejectsInseparableKeys) {
+    using Map = perfect_hash_map<std::string, int>;
+    EXPECT_THROW(Map({{"a", 1}, {"b", 2}, {"a", 3}}), std::invalid_argument);
+
+    using Colliding = perfect_hash_map<std::string, int, CollidingHasher>;
+    EXPECT_THROW(Colliding({{"a", 1}, {"b", 2}}), std::invalid_argument);
+    Colliding fine{{"a", 1}, {"c", 2}};
+    EXPECT_EQ(fine.at("c"), 2);
+}
+}
@@ -0,0 +1,223 @@
+#include "Util/RollingHash.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <list>
+#include <stdexcept>
+#include <random>
+#include <string>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+struct Token {
+    int id;
+    std::string text;
+};
+
+struct TokenId {
+    int operator()(const Token& t) const { return t.id; }
+};
+
+std::vector<int> randomInts(std::size_t n, unsigned seed, int range) {
+    std::mt19937 rng(seed);
+    std::vector<int> ret(n);
+    for (auto& v : ret)
+        v = static_cast<int>(rng() % range);
+    return ret;
+}
+
+template <typename Rolling, typename Make>
+void checkRollingMatchesFresh(Make&& make) {
+    auto data = randomInts(500, 1, 1000);
+    const std::size_t window = 17;
+    auto rolling = make(window);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        if (i < window)
+            rolling.push(data[i]);
+        else
+            rolling.roll(data[i - window], data[i]);
+        if (i + 1 < window)
+            continue;
+
+        auto fresh = make(window);
+        for (std::size_t j = i + 1 - window; j <= i; ++j)
+            fresh.push(data[j]);
+        EXPECT_EQ(rolling.value(), fresh.value()) << i;
+        EXPECT_TRUE(rolling.full());
+    }
+}
+
+TEST(RollingHashTest, MulMod61) {
+    using hash_detail::kMersenne61;
+    using hash_detail::mulMod61;
+    EXPECT_EQ(mulMod61(0, 12345), 0u);
+    EXPECT_EQ(mulMod61(1, kMersenne61 - 1), kMersenne61 - 1);
+    // (-1) * (-1) = 1
+    EXPECT_EQ(mulMod61(kMersenne61 - 1, kMersenne61 - 1), 1u);
+    // 2^60 * 2 = 2^61 = 1
+    EXPECT_EQ(mulMod61(std::uint64_t(1) << 60, 2), 1u);
+}
+
+TEST(RollingHashTest, PolynomialMatchesFresh) {
+    checkRollingMatchesFresh<PolynomialRollingHash<>>(
+        [](std::size_t w) { return PolynomialRollingHash<>(w); });
+}
+
+TEST(RollingHashTest, BuzHashMatchesFresh) {
+    checkRollingMatchesFresh<BuzHash<>>(
+        [](std::size_t w) { return BuzHash<>(w); });
+    // Windows longer than 64 make the rotations wrap around
+    auto data = randomInts(300, 2, 50);
+    BuzHash<> rolling(100);
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        if (i < 100)
+            rolling.push(data[i]);
+        else
+            rolling.roll(data[i - 100], data[i]);
+    }
+    BuzHash<> fresh(100);
+    for (std::size_t i = data.size() - 100; i < data.size(); ++i)
+        fresh.push(data[i]);
+    EXPECT_EQ(rolling.value(), fresh.value());
+}
+
+TEST(RollingHashTest, PrefixHash) {
+    auto data = randomInts(200, 3, 10);
+    PolynomialPrefixHash<> prefix(data.begin(), data.end());
+    EXPECT_EQ(prefix.size(), data.size());
+    for (std::size_t i = 0; i < data.size(); i += 7) {
+        for (std::size_t j = i; j <= data.size(); j += 5) {
+            PolynomialRollingHash<> fresh(j - i);
+            for (std::size_t k = i; k < j; ++k)
+                fresh.push(data[k]);
+            EXPECT_EQ(prefix.range(i, j), fresh.value());
+        }
+    }
+    EXPECT_EQ(prefix.range(4, 4), 0u);
+}
+
+TEST(RollingHashTest, Projection) {
+    std::vector<Token> tokens{{1, "a"}, {2, "b"}, {3, "c"}, {1, "x"},
+                              {2, "y"}, {3, "z"}};
+    PolynomialRollingHash<TokenId> rolling(3);
+    std::vector<std::uint64_t> values;
+    for (std::size_t i = 0; i < tokens.size(); ++i) {
+        if (i < 3)
+            rolling.push(tokens[i]);
+        else
+            rolling.roll(tokens[i - 3], tokens[i]);
+        if (rolling.full())
+            values.push_back(rolling.value());
+    }
+    // Only the ids are hashed, so the windows {1, 2, 3} match
+    ASSERT_EQ(values.size(), 4u);
+    EXPECT_EQ(values[0], values[3]);
+    EXPECT_NE(values[0], values[1]);
+
+    PolynomialPrefixHash<TokenId> prefix(tokens.begin(), tokens.end());
+    EXPECT_EQ(prefix.range(0, 3), values[0]);
+}
+
+TEST(RollingHashTest, DistinctWindows) {
+    // All 4-windows over a de Bruijn-like random sequence hash differently
+    // unless their contents are equal
+    auto data = randomInts(20000, 4, 1 << 30);
+    PolynomialRollingHash<> rolling(4);
+    std::unordered_set<std::uint64_t> seen;
+    for (std::size_t i = 0; i < data.size(); ++i) {
+        if (i < 4)
+            rolling.push(data[i]);
+        else
+            rolling.roll(data[i - 4], data[i]);
+        if (rolling.full())
+            seen.insert(rolling.value());
+    }
+    EXPECT_EQ(seen.size(), data.size() - 3);
+}
+
+TEST(RollingHashTest, ChunkerBounds) {
+    auto data = randomInts(200000, 5, 256);
+    ContentDefinedChunker<> chunker(64, 256, 1024);
+    std::size_t total = 0, chunks = 0;
+    chunker.split(data.begin(), data.end(),
+                  [&](std::vector<int>::iterator first,
+                      std::vector<int>::iterator last) {
+                      auto n = static_cast<std::size_t>(last - first);
+                      EXPECT_EQ(first - data.begin(), std::ptrdiff_t(total));
+                      EXPECT_LE(n, 1024u);
+                      if (last != data.end()) {
+                          EXPECT_GE(n, 64u);
+                      }
+                      total += n;
+                      ++chunks;
+                  });
+    EXPECT_EQ(total, data.size());
+    // Average chunk size in the right ballpark
+    auto avg = double(total) / chunks;
+    EXPECT_GT(avg, 128);
+    EXPECT_LT(avg, 512);
+}
+
+TEST(RollingHashTest, ChunkerRejectsBadSizes) {
+    EXPECT_THROW(ContentDefinedChunker<>(0, 256, 1024), std::invalid_argument);
+    EXPECT_THROW(ContentDefinedChunker<>(0, 0, 0), std::invalid_argument);
+    EXPECT_THROW(ContentDefinedChunker<>(512, 256, 1024),
+                 std::invalid_argument);
+    EXPECT_THROW(ContentDefinedChunker<>(64, 2048, 1024),
+                 std::invalid_argument);
+    EXPECT_NO_THROW(ContentDefinedChunker<>(16, 16, 16));
+}
+
+TEST(RollingHashTest, ChunkerForwardIterators) {
+    auto data = randomInts(20000, 7, 256);
+    std::list<int> list(data.begin(), data.end());
+    ContentDefinedChunker<> chunker(64, 256, 1024);
+    std::vector<std::size_t> vectorSizes, listSizes;
+    chunker.split(data.begin(), data.end(),
+                  [&](std::vector<int>::iterator first,
+                      std::vector<int>::iterator last) {
+                      vectorSizes.push_back(std::size_t(last - first));
+                  });
+    chunker.split(list.begin(), list.end(),
+                  [&](std::list<int>::iterator first,
+                      std::list<int>::iterator last) {
+                      std::size_t n = 0;
+                      for (; first != last; ++first)
+                          ++n;
+                      listSizes.push_back(n);
+                  });
+    EXPECT_EQ(vectorSizes, listSizes);
+}
+
+TEST(RollingHashTest, ChunkerResynchronizes) {
+    auto data = randomInts(100000, 6, 256);
+    auto edited = data;
+    edited.insert(edited.begin() + 1000, {7, 7, 7});
+
+    ContentDefinedChunker<> chunker(64, 256, 1024);
+    auto chunkHashes = [&](const std::vector<int>& v) {
+        std::vector<std::size_t> ret;
+        chunker.split(v.begin(), v.end(),
+                      [&](std::vector<int>::const_iterator first,
+                          std::vector<int>::const_iterator last) {
+                          ret.push_back(hashRange(&*first, &*first + (last - first)));
+                      });
+        return ret;
+    };
+    auto before = chunkHashes(data);
+    auto after = chunkHashes(edited);
+    std::unordered_set<std::size_t> common(before.begin(), before.end());
+    std::size_t shared = 0;
+    for (auto h : after)
+        shared += common.count(h);
+    // Only the chunks around the edit differ
+    EXPECT_GE(shared + 4, after.size());
+    EXPECT_GE(shared + 4, before.size());
+}
+}
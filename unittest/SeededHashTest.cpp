@@ -0,0 +1,96 @@
+#include "Util/SeededHash.h"
+
+#include "gtest/gtest.h"
+
+#include <cstdint>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+enum class Color { Red, Green };
+
+struct Key {
+    std::uint32_t id;
+    std::uint16_t kind;
+    UTIL_HASHABLE_FIELDS(Key, id, kind)
+};
+
+TEST(SeededHashTest, SipHashReferenceVector) {
+    // From the SipHash paper: key 00..0f, message 00..0e
+    HashKey key{0x0706050403020100ULL, 0x0f0e0d0c0b0a0908ULL};
+    unsigned char msg[15];
+    for (unsigned i = 0; i < sizeof(msg); ++i)
+        msg[i] = static_cast<unsigned char>(i);
+    auto sip24 = [&key](const void* data, std::size_t len) {
+        return hash_detail::sipHash<2, 4>(key, data, len);
+    };
+    EXPECT_EQ(sip24(msg, sizeof(msg)), 0xa129ca6149be45e5ULL);
+    EXPECT_EQ(sip24(msg, 0), 0x726fdb47dd0e0e31ULL);
+}
+
+TEST(SeededHashTest, SipHash13) {
+    HashKey key{1, 2}, other{1, 3};
+    std::string s = "the quick brown fox";
+    EXPECT_EQ(sipHash13(key, s.data(), s.size()),
+              sipHash13(key, s.data(), s.size()));
+    EXPECT_NE(sipHash13(key, s.data(), s.size()),
+              sipHash13(other, s.data(), s.size()));
+    for (std::size_t len = 0; len < s.size(); ++len)
+        EXPECT_NE(sipHash13(key, s.data(), len),
+                  sipHash13(key, s.data(), len + 1));
+}
+
+TEST(SeededHashTest, ProcessKey) {
+    const auto& key = processHashKey();
+    EXPECT_EQ(&key, &processHashKey());
+    EXPECT_NE(key.k0, key.k1);
+
+    // The process key takes part in every seeded hash
+    std::string s = "abc";
+    EXPECT_EQ(SeededHashPolicy::value(s),
+              sipHash13(key, s.data(), s.size()));
+    EXPECT_NE(SeededHasher<int>()(1), std::hash<int>()(1));
+}
+
+TEST(SeededHashTest, PolicyPerHasher) {
+    using StringPair = std::pair<std::string, int>;
+    PairHasher<StringPair, SeededHashPolicy> seeded;
+    PairHasher<StringPair> unseeded;
+    StringPair p{"a", 1};
+    EXPECT_EQ(seeded(p), seeded(StringPair{"a", 1}));
+    EXPECT_NE(seeded(p), seeded(StringPair{"a", 2}));
+    EXPECT_NE(seeded(p), unseeded(p));
+    EXPECT_EQ(unseeded(p), hashPair(std::string("a"), 1));
+
+    ContainerHasher<std::vector<std::string>, SeededHashPolicy> strings;
+    EXPECT_NE(strings({"a", "b"}), strings({"b", "a"}));
+    ContainerHasher<std::vector<int>, SeededHashPolicy> ints;
+    EXPECT_NE(ints({1, 2}), ints({2, 1}));
+    EXPECT_NE(ints({1, 2}), ContainerHasher<std::vector<int>>()({1, 2}));
+
+    TupleHasher<std::tuple<int, std::string>, SeededHashPolicy> tuples;
+    EXPECT_NE(tuples(std::make_tuple(1, "x")), tuples(std::make_tuple(2, "x")));
+
+    StructHasher<Key, SeededHashPolicy> structs;
+    EXPECT_EQ(structs(Key{1, 2}), structs(Key{1, 2}));
+    EXPECT_NE(structs(Key{1, 2}), structs(Key{2, 1}));
+
+    EnumClassHasher<Color, SeededHashPolicy> colors;
+    EXPECT_NE(colors(Color::Red), colors(Color::Green));
+    EXPECT_EQ(EnumClassHasher<Color>()(Color::Green), 1u);
+}
+
+TEST(SeededHashTest, Map) {
+    std::unordered_map<std::string, int, SeededHasher<std::string>> counts;
+    for (int i = 0; i < 1000; ++i)
+        ++counts[std::to_string(i % 100)];
+    EXPECT_EQ(counts.size(), 100u);
+    EXPECT_EQ(counts["42"], 10);
+}
+}
@@ -0,0 +1,172 @@
+#include "Util/Sketches.h"
+
+#include "gtest/gtest.h"
+
+#include "UserId.h"
+
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+using namespace util;
+
+namespace {
+
+// A Zipf-like stream: key k appears about n / (k + 1) times
+std::vector<std::uint64_t> skewedStream(std::size_t n, std::size_t keys) {
+    std::vector<double> weights(keys);
+    for (std::size_t k = 0; k < keys; ++k)
+        weights[k] = 1.0 / (k + 1);
+    std::discrete_distribution<std::uint64_t> dist(weights.begin(),
+                                                   weights.end());
+    std::mt19937_64 rng(3);
+    std::vector<std::uint64_t> stream(n);
+    for (auto& x : stream)
+        x = dist(rng);
+    return stream;
+}
+
+TEST(SketchesTest, CountMin) {
+    auto stream = skewedStream(200000, 10000);
+    std::unordered_map<std::uint64_t, std::uint64_t> exact;
+    auto sketch = count_min_sketch<std::uint64_t>::with_error_bounds(0.001, 0.01);
+    EXPECT_EQ(sketch.width(), 2719u);
+    EXPECT_EQ(sketch.depth(), 5u);
+    for (auto x : stream) {
+        ++exact[x];
+        sketch.add(x);
+    }
+    EXPECT_EQ(sketch.total(), stream.size());
+
+    std::size_t beyondBound = 0;
+    for (const auto& kv : exact) {
+        auto e = sketch.estimate(kv.first);
+        ASSERT_GE(e, kv.second);
+        beyondBound += e - kv.second > 0.001 * stream.size();
+    }
+    EXPECT_LE(beyondBound, exact.size() / 100);
+    EXPECT_NEAR(double(sketch.estimate(0)), double(exact[0]),
+                0.001 * stream.size());
+
+    // Two halves merged give exactly the sketch of the whole stream
+    count_min_sketch<std::uint64_t> a(2719, 5), b(2719, 5);
+    for (std::size_t i = 0; i < stream.size(); ++i)
+        (i % 2 ? a : b).add(stream[i]);
+    a.merge(b);
+    for (std::uint64_t k = 0; k < 100; ++k)
+        EXPECT_EQ(a.estimate(k), sketch.estimate(k));
+    EXPECT_THROW(a.merge(count_min_sketch<std::uint64_t>(100, 5)),
+                 std::invalid_argument);
+
+    count_min_sketch<std::string, StringHasher<>> words(100, 3);
+    words.add("the", 10);
+    words.add(std::string("cat"));
+    EXPECT_GE(words.estimate("the"), 10u);
+    EXPECT_GE(words.estimate("cat"), 1u);
+    words.clear();
+    EXPECT_EQ(words.estimate("the"), 0u);
+    EXPECT_THROW(count_min_sketch<int>(0, 3), std::invalid_argument);
+}
+
+TEST(SketchesTest, CountSketch) {
+    auto stream = skewedStream(200000, 10000);
+    std::unordered_map<std::uint64_t, std::int64_t> exact;
+    count_sketch<std::uint64_t> sketch(2000, 5);
+    for (auto x : stream) {
+        ++exact[x];
+        sketch.add(x);
+    }
+
+    // The heavy hitters come out within a small error, in both directions
+    for (std::uint64_t k = 0; k < 10; ++k)
+        EXPECT_NEAR(double(sketch.estimate(k)), double(exact[k]), 200) << k;
+    double totalError = 0;
+    for (const auto& kv : exact)
+        totalError += double(sketch.estimate(kv.first) - kv.second);
+    EXPECT_LT(std::fabs(totalError / exact.size()), 5);
+
+    count_sketch<std::uint64_t> a(2000, 5), b(2000, 5);
+    for (std::size_t i = 0; i < stream.size(); ++i)
+        (i % 2 ? a : b).add(stream[i]);
+    a.merge(b);
+    for (std::uint64_t k = 0; k < 100; ++k)
+        EXPECT_EQ(a.estimate(k), sketch.estimate(k));
+
+    // Even depths average the two middle rows
+    count_sketch<int> even(50, 4);
+    even.add(1, 7);
+    EXPECT_EQ(even.estimate(1), 7);
+    even.add(1, -7);
+    EXPECT_EQ(even.estimate(1), 0);
+}
+
+TEST(SketchesTest, HyperLogLog) {
+    hyperloglog<std::uint64_t> hll(12);
+    EXPECT_EQ(hll.estimate(), 0.0);
+    EXPECT_NEAR(hll.standard_error(), 1.04 / 64, 1e-12);
+
+    std::mt19937_64 rng(9);
+    std::size_t count = 0;
+    for (std::size_t target : {10u, 100u, 1000u, 10000u, 100000u, 1000000u}) {
+        for (; count < target; ++count) {
+            auto x = rng();
+            hll.add(x);
+            hll.add(x); // duplicates do not count
+        }
+        EXPECT_NEAR(hll.estimate(), double(count),
+                    4 * hll.standard_error() * count + 1)
+            << count;
+    }
+
+    // Sequential integers, which std::hash does not mix
+    hyperloglog<int> ints(14);
+    for (int i = 0; i < 50000; ++i)
+        ints.add(i);
+    EXPECT_NEAR(ints.estimate(), 50000, 4 * ints.standard_error() * 50000);
+
+    hyperloglog<int> a(14), b(14), both(14);
+    for (int i = 0; i < 30000; ++i) {
+        a.add(i);
+        both.add(i);
+    }
+    for (int i = 20000; i < 60000; ++i) {
+        b.add(i);
+        both.add(i);
+    }
+    a.merge(b);
+    EXPECT_EQ(a.estimate(), both.estimate());
+    EXPECT_THROW(a.merge(hyperloglog<int>(10)), std::invalid_argument);
+    EXPECT_THROW(hyperloglog<int>(3), std::invalid_argument);
+    EXPECT_THROW(hyperloglog<int>(19), std::invalid_argument);
+
+    hyperloglog<std::string, StringHasher<>> names(10);
+    names.add("alice");
+    names.add(std::string("alice"));
+    names.add("bob");
+    EXPECT_NEAR(names.estimate(), 2, 0.1);
+    names.clear();
+    EXPECT_EQ(names.estimate(), 0.0);
+}
+
+TEST(SketchesTest, HeterogeneousKeys) {
+    static_assert(!std::is_convertible<int, UserId>::value, "");
+    count_min_sketch<UserId, UserIdHasher> cms(100, 3);
+    cms.add(7, 2);
+    cms.add(UserId{7, "ann"});
+    EXPECT_EQ(cms.estimate(7), 3u);
+
+    count_sketch<UserId, UserIdHasher> cs(100, 5);
+    cs.add(7, 4);
+    EXPECT_EQ(cs.estimate(UserId{7, "ann"}), 4);
+
+    hyperloglog<UserId, UserIdHasher> hll(10);
+    hll.add(7);
+    hll.add(UserId{7, "ann"});
+    EXPECT_NEAR(hll.estimate(), 1, 0.1);
+}
+}
@@ -0,0 +1,52 @@
+#include "Util/ThreadPool.h"
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+using namespace util;
+
+namespace {
+TEST(ThreadPoolTest, Submit) {
+    ThreadPool pool(3);
+    EXPECT_EQ(pool.size(), 3u);
+
+    std::vector<std::future<int>> results;
+    for (int i = 0; i < 100; ++i)
+        results.push_back(pool.submit([i] { return i * i; }));
+    for (int i = 0; i < 100; ++i)
+        EXPECT_EQ(results[i].get(), i * i);
+}
+
+TEST(ThreadPoolTest, ParallelFor) {
+    ThreadPool pool(4);
+    std::vector<int> hits(1000, 0);
+    parallelFor(pool, hits.size(), [&](std::size_t i) { hits[i] += 1; });
+    for (auto h : hits)
+        EXPECT_EQ(h, 1);
+
+    // Nested calls from a pool thread must not deadlock
+    std::atomic<int> total{0};
+    parallelFor(pool, 8, [&](std::size_t) {
+        parallelFor(pool, 8, [&](std::size_t) { ++total; });
+    });
+    EXPECT_EQ(total.load(), 64);
+
+    ThreadPool empty(0);
+    int count = 0;
+    parallelFor(empty, 10, [&](std::size_t) { ++count; });
+    EXPECT_EQ(count, 10);
+}
+
+TEST(ThreadPoolTest, ParallelForPropagatesExceptions) {
+    ThreadPool pool(2);
+    EXPECT_THROW(parallelFor(pool, 16,
+                             [](std::size_t i) {
+                                 if (i == 5)
+                                     throw std::runtime_error("boom");
+                             }),
+                 std::runtime_error);
+}
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// A key that cannot be built from the int it is looked up by, so
+// heterogeneous lookups only compile if they pass the int through as it is
+struct UserId {
+    int id;
+    std::string name;
+};
+
+// Hashes a UserId by its id. Counts its calls in *calls when it is set.
+struct UserIdHasher {
+    using is_transparent = void;
+
+    std::size_t operator()(const UserId& u) const { return (*this)(u.id); }
+    std::size_t operator()(int id) const {
+        if (calls)
+            ++*calls;
+        return std::hash<int>()(id);
+    }
+
+    std::atomic<int>* calls = nullptr;
+};
+
+struct UserIdEq {
+    using is_transparent = void;
+
+    bool operator()(const UserId& a, const UserId& b) const {
+        return a.id == b.id;
+    }
+    bool operator()(const UserId& a, int b) const { return a.id == b; }
+    bool operator()(int a, const UserId& b) const { return a == b.id; }
+};
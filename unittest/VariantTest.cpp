@@ -3,6 +3,7 @@
 #include "gtest/gtest.h"
 
 #include <mutex>
+#include <unordered_set>
 
 using namespace util;
 
@@ -1090,4 +1091,18 @@ TEST(VariantTest, Hash) {
     static_assert(std::is_same<decltype(hm(m)), size_t>::value,
                   "hash monostate fails to work");
 }
+
+TEST(VariantTest, HashMixesIndex) {
+    using V = variant<int, long>;
+    std::hash<V> h;
+
+    EXPECT_NE(h(V(in_place<0>, 1)), h(V(in_place<1>, 1L)));
+    EXPECT_NE(h(V(0)), h(V(1)));
+
+    // Consecutive values must not map to consecutive hashes
+    std::unordered_set<size_t> lowBits;
+    for (int i = 0; i < 64; ++i)
+        lowBits.insert(h(V(i)) & 0xff);
+    EXPECT_GT(lowBits.size(), 32u);
+}
 }